@@ -4,6 +4,13 @@
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
 
+#include "led_bar.h"
+#include "i2c_capture_history.h"
+
+#ifdef I2C_RAW_IRQ
+#include "i2c_bus_edges.h"
+#endif
+
 const uint8_t i2c_address = 0x42;
 const uint8_t i2c_mosi_condition = (i2c_address << 1) & ~1; // Master out | Slave in
 const uint8_t i2c_miso_condition = (i2c_address << 1) |  1; // Master in  | Slave out
@@ -14,25 +21,11 @@ volatile bool slave_mode = false;
 #define SDA_PIN 5
 #define SCL_PIN 4
 
-// LED pins
-#define LED_PIN_0 6
-#define LED_PIN_1 7
-#define LED_PIN_2 8
-#define LED_PIN_3 9
-#define LED_PIN_4 10
-#define LED_PIN_5 11
-#define LED_PIN_6 12
-#define LED_PIN_7 13
-
-// STATE PINS
-#define LED_PIN_I2C_NULL 19
-#define LED_PIN_I2C_START 20
-#define LED_PIN_I2C_RX 21
-#define LED_PIN_I2C_TX 18
-
-#define LED_PIN_ACK_NULL 14
-#define LED_PIN_ACK_RX 15
-#define LED_PIN_ACK_TX 16
+// LED pins, bit 0 to bit 7
+using data_leds = led_bar<6, 7, 8, 9, 10, 11, 12, 13>;
+
+// STATE PINS, i2c state NULL, START, MOSI, MISO then ack state NULL, MOSI, MISO
+using state_leds = led_bar<19, 20, 18, 21, 14, 16, 15>;
 
 // State Machines
 static enum i2c_state_t {
@@ -50,84 +43,8 @@ static enum ack_state_t {
 
 void init_leds()
 {
-    gpio_init(LED_PIN_0);
-    gpio_init(LED_PIN_1);
-    gpio_init(LED_PIN_2);
-    gpio_init(LED_PIN_3);
-    gpio_init(LED_PIN_4);
-    gpio_init(LED_PIN_5);
-    gpio_init(LED_PIN_6);
-    gpio_init(LED_PIN_7);
-
-    gpio_init(LED_PIN_I2C_NULL);
-    gpio_init(LED_PIN_I2C_RX);
-    gpio_init(LED_PIN_I2C_TX);
-    gpio_init(LED_PIN_I2C_START);
-
-    gpio_init(LED_PIN_ACK_NULL);
-    gpio_init(LED_PIN_ACK_RX);
-    gpio_init(LED_PIN_ACK_TX);
-
-    gpio_set_dir(LED_PIN_0, GPIO_OUT);
-    gpio_set_dir(LED_PIN_1, GPIO_OUT);
-    gpio_set_dir(LED_PIN_2, GPIO_OUT);
-    gpio_set_dir(LED_PIN_3, GPIO_OUT);
-    gpio_set_dir(LED_PIN_4, GPIO_OUT);
-    gpio_set_dir(LED_PIN_5, GPIO_OUT);
-    gpio_set_dir(LED_PIN_6, GPIO_OUT);
-    gpio_set_dir(LED_PIN_7, GPIO_OUT);
-    
-    gpio_set_dir(LED_PIN_I2C_NULL,  GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_RX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_TX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_START, GPIO_OUT);
-
-    gpio_set_dir(LED_PIN_ACK_NULL,  GPIO_OUT);
-    gpio_set_dir(LED_PIN_ACK_RX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_ACK_TX,    GPIO_OUT);
-
-    gpio_put(LED_PIN_0, 0);
-    gpio_put(LED_PIN_1, 0);
-    gpio_put(LED_PIN_2, 0);
-    gpio_put(LED_PIN_3, 0);
-    gpio_put(LED_PIN_4, 0);
-    gpio_put(LED_PIN_5, 0);
-    gpio_put(LED_PIN_6, 0);
-    gpio_put(LED_PIN_7, 0);
-
-    gpio_put(LED_PIN_I2C_NULL,  0);
-    gpio_put(LED_PIN_I2C_RX,    0);
-    gpio_put(LED_PIN_I2C_TX,    0);
-    gpio_put(LED_PIN_I2C_START, 0);
-
-    gpio_put(LED_PIN_ACK_NULL,  0);
-    gpio_put(LED_PIN_ACK_RX,    0);
-    gpio_put(LED_PIN_ACK_TX,    0);
-}
-
-void set_leds(const uint8_t value)
-{
-    gpio_put(LED_PIN_0, (value & 0x01));
-    gpio_put(LED_PIN_1, (value & 0x02));
-    gpio_put(LED_PIN_2, (value & 0x04));
-    gpio_put(LED_PIN_3, (value & 0x08));
-    gpio_put(LED_PIN_4, (value & 0x10));
-    gpio_put(LED_PIN_5, (value & 0x20));
-    gpio_put(LED_PIN_6, (value & 0x40));
-    gpio_put(LED_PIN_7, (value & 0x80));
-}
-
-void set_state()
-{
-    // Uses global state variables
-    gpio_put(LED_PIN_I2C_NULL   , (i2c_state & I2C_STATE_NULL));
-    gpio_put(LED_PIN_I2C_START  , (i2c_state & I2C_STATE_START));
-    gpio_put(LED_PIN_I2C_RX     , (i2c_state & I2C_STATE_MISO));
-    gpio_put(LED_PIN_I2C_TX     , (i2c_state & I2C_STATE_MOSI));
-
-    gpio_put(LED_PIN_ACK_NULL   , (ack_state & ACK_STATE_NULL));
-    gpio_put(LED_PIN_ACK_RX     , (ack_state & ACK_STATE_MISO));
-    gpio_put(LED_PIN_ACK_TX     , (ack_state & ACK_STATE_MOSI));
+    data_leds::init();
+    state_leds::init();
 }
 
 struct fifo_8bit
@@ -140,8 +57,6 @@ struct fifo_8bit
         bool out = (data & 0x80);
         data = data << 1;
         data = (data & ~(0x01)) | ((uint8_t)bit);
-
-        set_leds(data);
         return out;
     }
 
@@ -152,6 +67,75 @@ struct fifo_8bit
     }
 } i2c_fifo;
 
+// How often the main loop copies the published display to the leds
+#define DISPLAY_REFRESH_MS 20
+
+// The display double buffered between the interrupt and the main loop. The interrupt packs the
+// fifo byte and the state leds into one word and stores it once per entry, the main loop shows
+// the latest word. Both halves always come from the same edge and the interrupt costs the same
+// however many leds are wired.
+static volatile uint32_t display_published = 0;
+
+static inline void publish_display()
+{
+    // The enums are one bit per state
+    display_published = i2c_fifo.data | ((uint32_t)(i2c_state | (ack_state << 4)) << 8);
+}
+
+void refresh_display()
+{
+    static uint32_t shown = ~0u;
+
+    uint32_t display = display_published;
+    if (display == shown)
+        return;
+
+    data_leds::show(display & 0xff);
+    state_leds::show(display >> 8);
+    shown = display;
+}
+
+// Records kept for replay, 16 bytes each
+#define HISTORY_SIZE 1024
+
+// Commands read from USB stdio
+#define COMMAND_HISTORY_TEXT    'h'
+#define COMMAND_HISTORY_BINARY  'b'
+#define COMMAND_HISTORY_CLEAR   'c'
+
+// Every START, STOP and byte decoded, see i2c_capture_history.h
+static i2c_capture_history<HISTORY_SIZE> history;
+
+// The address or data byte last shifted in, recorded once its acknowledge bit has been clocked
+static i2c_capture_record_type held_type;
+static uint8_t held_byte;
+static bool byte_held = false;
+
+// Between a recorded START and its STOP
+static bool in_transfer = false;
+
+static inline void hold_byte(i2c_capture_record_type type, uint8_t value)
+{
+    held_type = type;
+    held_byte = value;
+    byte_held = true;
+}
+
+static inline void record_held(bool acknowledged)
+{
+    if (byte_held)
+        history.record(held_type, time_us_64(), held_byte, acknowledged);
+    byte_held = false;
+}
+
+static inline void record_condition(i2c_capture_record_type type)
+{
+    // A byte cut short by the condition is not recorded
+    byte_held = false;
+    in_transfer = (type != I2C_CAPTURE_STOP);
+    history.record(type, time_us_64(), 0, false);
+}
+
 uint32_t bit_counter = 0;
 
 volatile bool scl_value = false;
@@ -172,6 +156,8 @@ void scl_handler(uint32_t event)
 
             if (bit_counter == 8)
             {
+                hold_byte(I2C_CAPTURE_ADDRESS, i2c_fifo.data);
+
                 if (slave_mode)
                 {
                     if (i2c_fifo.data == i2c_mosi_condition)
@@ -186,6 +172,7 @@ void scl_handler(uint32_t event)
                     }
                     else
                     {
+                        // Not for this module, the address is recorded once its acknowledge bit is in
                         i2c_state = I2C_STATE_NULL;
                         ack_state = ACK_STATE_NULL;
                     }
@@ -211,9 +198,17 @@ void scl_handler(uint32_t event)
             bit_counter++;
 
             if ((bit_counter % 9) == 8)
+            {
                 ack_state = ACK_STATE_MISO;
+                hold_byte(I2C_CAPTURE_DATA, i2c_fifo.data);
+            }
             else if ((bit_counter % 9) == 0)
+            {
                 ack_state = ACK_STATE_NULL;
+
+                // Low is an acknowledge, the first one is the address's
+                record_held(!sda_value);
+            }
         
             break;
         
@@ -222,12 +217,26 @@ void scl_handler(uint32_t event)
             bit_counter++;
 
             if ((bit_counter % 9) == 8)
+            {
                 ack_state = ACK_STATE_MOSI;
+                hold_byte(I2C_CAPTURE_DATA, i2c_fifo.data);
+            }
             else if ((bit_counter % 9) == 0)
+            {
                 ack_state = ACK_STATE_NULL;
 
+                // Low is an acknowledge, the first one is the address's
+                record_held(!sda_value);
+            }
+
 
             break;
+
+        case I2C_STATE_NULL:
+            // The acknowledge bit of an address for another device, as whoever answered drove it
+            if (byte_held && ++bit_counter == 9)
+                record_held(!sda_value);
+            break;
         
         default:
             break;
@@ -249,6 +258,9 @@ void sda_handler(uint32_t event)
         sda_value = true;
         if (scl_value)
         {
+            if (in_transfer)
+                record_condition(I2C_CAPTURE_STOP);
+
             i2c_state = I2C_STATE_NULL;
             ack_state = ACK_STATE_NULL;
             i2c_fifo.reset_fifo();
@@ -260,6 +272,8 @@ void sda_handler(uint32_t event)
         sda_value = false;
         if (scl_value)
         {
+            record_condition(in_transfer ? I2C_CAPTURE_RESTART : I2C_CAPTURE_START);
+
             i2c_state = I2C_STATE_START;
             ack_state = ACK_STATE_NULL;
             i2c_fifo.reset_fifo();
@@ -295,6 +309,129 @@ void trigger_handler(uint gpio, uint32_t event)
         sda_handler(event);
     else if (gpio == SLAVE_MASTER_SWITCH_PIN)
         slave_mode_handler(event);
+
+    publish_display();
+}
+
+#ifdef I2C_RAW_IRQ
+// Takes every pending edge of the bus and the switch in one interrupt instead of one callback each
+void raw_trigger_handler()
+{
+    const uint32_t edges_mask = GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL;
+    uint32_t sda_events = gpio_get_irq_event_mask(SDA_PIN) & edges_mask;
+    uint32_t scl_events = gpio_get_irq_event_mask(SCL_PIN) & edges_mask;
+    uint32_t switch_events = gpio_get_irq_event_mask(SLAVE_MASTER_SWITCH_PIN) & edges_mask;
+
+    gpio_acknowledge_irq(SDA_PIN, sda_events);
+    gpio_acknowledge_irq(SCL_PIN, scl_events);
+    gpio_acknowledge_irq(SLAVE_MASTER_SWITCH_PIN, switch_events);
+
+    uint32_t levels = gpio_get_all();
+
+    if (switch_events)
+        slave_mode_handler((levels >> SLAVE_MASTER_SWITCH_PIN) & 1 ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL);
+
+    i2c_bus_edge edges[I2C_BUS_EDGES_MAX];
+    uint count = i2c_order_edges(sda_events, scl_events, (levels >> SDA_PIN) & 1, (levels >> SCL_PIN) & 1, edges);
+
+    for (uint i = 0; i < count; i++)
+    {
+        if (edges[i].scl)
+            scl_handler(edges[i].event);
+        else
+            sda_handler(edges[i].event);
+    }
+
+    publish_display();
+}
+#endif
+
+// One line per transfer: the time of its START in microseconds, then S or Sr for a START,
+// the address with W or R, each data byte in hex, + for an acknowledge, - for none, and P for
+// the STOP. A line starting with ... was already under way when the history begins.
+//
+//      84211503 S 42W+ 10+ 2a+ P
+//      84263391 S 42W+ 10+ Sr 42R+ 2a- P
+void print_history()
+{
+    bool line_open = false;
+    uint32_t count = history.replay([&](const i2c_capture_record& record)
+    {
+        if (record.type == I2C_CAPTURE_START && line_open)
+        {
+            printf("\n");
+            line_open = false;
+        }
+        if (!line_open)
+        {
+            printf("%llu%s", (unsigned long long)record.time_us, record.type == I2C_CAPTURE_START ? "" : " ...");
+            line_open = true;
+        }
+
+        switch (record.type)
+        {
+        case I2C_CAPTURE_START:
+            printf(" S");
+            break;
+        case I2C_CAPTURE_RESTART:
+            printf(" Sr");
+            break;
+        case I2C_CAPTURE_STOP:
+            printf(" P\n");
+            line_open = false;
+            break;
+        case I2C_CAPTURE_ADDRESS:
+            printf(" %02x%c%c", record.value >> 1, (record.value & 1) ? 'R' : 'W', record.acknowledged ? '+' : '-');
+            break;
+        case I2C_CAPTURE_DATA:
+            printf(" %02x%c", record.value, record.acknowledged ? '+' : '-');
+            break;
+        case I2C_CAPTURE_OVERFLOW:
+            printf(" <%u lost>", (uint)record.dropped);
+            break;
+        default:
+            break;
+        }
+    });
+
+    if (line_open)
+        printf("\n");
+    printf("%u records\n", (uint)count);
+}
+
+// The history in the listener's capture format, i2c_capture_decoder and i2c_capture_daemon read it
+void send_history_binary()
+{
+    i2c_capture_encoder encoder;
+    uint8_t bytes[I2C_CAPTURE_MAX_RECORD];
+
+    history.replay([&](const i2c_capture_record& record)
+    {
+        uint32_t value = (record.type == I2C_CAPTURE_OVERFLOW) ? record.dropped : record.value;
+        uint32_t length = encoder.encode(record.type, record.time_us, value, record.acknowledged, bytes);
+        for (uint32_t i = 0; i < length; i++)
+            putchar_raw(bytes[i]);
+        encoder.written(record.time_us);
+    });
+    stdio_flush();
+}
+
+void handle_command(int command)
+{
+    switch (command)
+    {
+    case COMMAND_HISTORY_TEXT:
+        print_history();
+        break;
+    case COMMAND_HISTORY_BINARY:
+        send_history_binary();
+        break;
+    case COMMAND_HISTORY_CLEAR:
+        history.clear();
+        break;
+    default:
+        break;
+    }
 }
 
 int main()
@@ -304,6 +441,7 @@ int main()
     
     // Init LEDs
     init_leds();
+    publish_display();
 
     // Add triggers to i2c pins
     gpio_init(SDA_PIN);
@@ -326,7 +464,11 @@ int main()
     gpio_set_irq_enabled(SLAVE_MASTER_SWITCH_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
 
     // Enable all interrupts. 
+#ifdef I2C_RAW_IRQ
+    gpio_add_raw_irq_handler_masked((1u << SDA_PIN) | (1u << SCL_PIN) | (1u << SLAVE_MASTER_SWITCH_PIN), &raw_trigger_handler);
+#else
     gpio_set_irq_callback(&trigger_handler);
+#endif
     irq_set_enabled(IO_IRQ_BANK0, true);
 
 
@@ -335,9 +477,13 @@ int main()
     while (true)
     {
         // update display regularly
-        set_leds(i2c_fifo.data);
-        set_state();
-        sleep_ms(50);
+        refresh_display();
+
+        int command = getchar_timeout_us(0);
+        if (command != PICO_ERROR_TIMEOUT)
+            handle_command(command);
+
+        sleep_ms(DISPLAY_REFRESH_MS);
     }
 
 }
\ No newline at end of file
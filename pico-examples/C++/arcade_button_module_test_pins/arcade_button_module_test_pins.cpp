@@ -4,6 +4,8 @@
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
 
+#include "led_bar.h"
+
 
 #define SLAVE_MASTER_SWITCH_PIN 17
 volatile bool slave_mode = false;
@@ -11,25 +13,11 @@ volatile bool slave_mode = false;
 #define SDA_PIN 4
 #define SCL_PIN 5
 
-// LED pins
-#define LED_PIN_0 6
-#define LED_PIN_1 7
-#define LED_PIN_2 8
-#define LED_PIN_3 9
-#define LED_PIN_4 10
-#define LED_PIN_5 11
-#define LED_PIN_6 12
-#define LED_PIN_7 13
-
-// STATE PINS
-#define LED_PIN_I2C_NULL 19
-#define LED_PIN_I2C_START 20
-#define LED_PIN_I2C_RX 21
-#define LED_PIN_I2C_TX 18
-
-#define LED_PIN_ACK_NULL 14
-#define LED_PIN_ACK_RX 15
-#define LED_PIN_ACK_TX 16
+// LED pins, the data bits 0 to 7, then i2c state NULL, START, RX, TX and ack state NULL, RX, TX
+using leds = led_bar<6, 7, 8, 9, 10, 11, 12, 13, 19, 20, 21, 18, 14, 15, 16>;
+
+// State leds as set_state drives them, i2c state NULL, START, MOSI, MISO then ack state NULL, MOSI, MISO
+using state_leds = led_bar<19, 20, 21, 18, 14, 15, 16>;
 
 // State Machines
 static enum i2c_state_t {
@@ -47,92 +35,18 @@ static enum ack_state_t {
 
 void init_leds(void)
 {
-    gpio_init(LED_PIN_0);
-    gpio_init(LED_PIN_1);
-    gpio_init(LED_PIN_2);
-    gpio_init(LED_PIN_3);
-    gpio_init(LED_PIN_4);
-    gpio_init(LED_PIN_5);
-    gpio_init(LED_PIN_6);
-    gpio_init(LED_PIN_7);
-
-    gpio_init(LED_PIN_I2C_NULL);
-    gpio_init(LED_PIN_I2C_RX);
-    gpio_init(LED_PIN_I2C_TX);
-    gpio_init(LED_PIN_I2C_START);
-
-    gpio_init(LED_PIN_ACK_NULL);
-    gpio_init(LED_PIN_ACK_RX);
-    gpio_init(LED_PIN_ACK_TX);
-
-    gpio_set_dir(LED_PIN_0, GPIO_OUT);
-    gpio_set_dir(LED_PIN_1, GPIO_OUT);
-    gpio_set_dir(LED_PIN_2, GPIO_OUT);
-    gpio_set_dir(LED_PIN_3, GPIO_OUT);
-    gpio_set_dir(LED_PIN_4, GPIO_OUT);
-    gpio_set_dir(LED_PIN_5, GPIO_OUT);
-    gpio_set_dir(LED_PIN_6, GPIO_OUT);
-    gpio_set_dir(LED_PIN_7, GPIO_OUT);
-    
-    gpio_set_dir(LED_PIN_I2C_NULL,  GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_RX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_TX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_I2C_START, GPIO_OUT);
-
-    gpio_set_dir(LED_PIN_ACK_NULL,  GPIO_OUT);
-    gpio_set_dir(LED_PIN_ACK_RX,    GPIO_OUT);
-    gpio_set_dir(LED_PIN_ACK_TX,    GPIO_OUT);
-
-    gpio_put(LED_PIN_0, 0);
-    gpio_put(LED_PIN_1, 0);
-    gpio_put(LED_PIN_2, 0);
-    gpio_put(LED_PIN_3, 0);
-    gpio_put(LED_PIN_4, 0);
-    gpio_put(LED_PIN_5, 0);
-    gpio_put(LED_PIN_6, 0);
-    gpio_put(LED_PIN_7, 0);
-
-    gpio_put(LED_PIN_I2C_NULL,  0);
-    gpio_put(LED_PIN_I2C_RX,    0);
-    gpio_put(LED_PIN_I2C_TX,    0);
-    gpio_put(LED_PIN_I2C_START, 0);
-
-    gpio_put(LED_PIN_ACK_NULL,  0);
-    gpio_put(LED_PIN_ACK_RX,    0);
-    gpio_put(LED_PIN_ACK_TX,    0);
+    leds::init();
 }
 
 void set_leds(const uint32_t value)
 {
-    gpio_put(LED_PIN_0, (value & 0x01));
-    gpio_put(LED_PIN_1, (value & 0x02));
-    gpio_put(LED_PIN_2, (value & 0x04));
-    gpio_put(LED_PIN_3, (value & 0x08));
-    gpio_put(LED_PIN_4, (value & 0x10));
-    gpio_put(LED_PIN_5, (value & 0x20));
-    gpio_put(LED_PIN_6, (value & 0x40));
-    gpio_put(LED_PIN_7, (value & 0x80));
-    gpio_put(LED_PIN_I2C_NULL   , (value & 0x100));
-    gpio_put(LED_PIN_I2C_START  , (value & 0x200));
-    gpio_put(LED_PIN_I2C_RX     , (value & 0x400));
-    gpio_put(LED_PIN_I2C_TX     , (value & 0x800));
-
-    gpio_put(LED_PIN_ACK_NULL   , (value & 0x1000));
-    gpio_put(LED_PIN_ACK_RX     , (value & 0x2000));
-    gpio_put(LED_PIN_ACK_TX     , (value & 0x4000));
+    leds::show(value);
 }
 
 void set_state()
 {
-    // Uses global state variables
-    gpio_put(LED_PIN_I2C_NULL   , (i2c_state & I2C_STATE_NULL));
-    gpio_put(LED_PIN_I2C_START  , (i2c_state & I2C_STATE_START));
-    gpio_put(LED_PIN_I2C_RX     , (i2c_state & I2C_STATE_MOSI));
-    gpio_put(LED_PIN_I2C_TX     , (i2c_state & I2C_STATE_MISO));
-
-    gpio_put(LED_PIN_ACK_NULL   , (ack_state & ACK_STATE_NULL));
-    gpio_put(LED_PIN_ACK_RX     , (ack_state & ACK_STATE_MOSI));
-    gpio_put(LED_PIN_ACK_TX     , (ack_state & ACK_STATE_MISO));
+    // Uses global state variables, the enums are one bit per state
+    state_leds::show(i2c_state | (ack_state << 4));
 }
 
 void shift_state(void)
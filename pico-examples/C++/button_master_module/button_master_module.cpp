@@ -4,19 +4,14 @@
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
 
+#include "led_bar.h"
+
 #define SDA_PIN 4
 #define SCL_PIN 5
 
 
-// LED pins
-#define LED_PIN_0 17
-#define LED_PIN_1 16
-#define LED_PIN_2 15
-#define LED_PIN_3 14
-#define LED_PIN_4 21
-#define LED_PIN_5 20
-#define LED_PIN_6 19
-#define LED_PIN_7 18
+// LED pins, bit 0 to bit 7
+using leds = led_bar<17, 16, 15, 14, 21, 20, 19, 18>;
 
 static uint bit_counter = 0;
 
@@ -28,46 +23,9 @@ static enum i2c_state_t {
     I2C_STATE_STOP,
 } i2c_state;
 
-void init_leds()
-{
-    gpio_init(LED_PIN_0);
-    gpio_init(LED_PIN_1);
-    gpio_init(LED_PIN_2);
-    gpio_init(LED_PIN_3);
-    gpio_init(LED_PIN_4);
-    gpio_init(LED_PIN_5);
-    gpio_init(LED_PIN_6);
-    gpio_init(LED_PIN_7);
-
-    gpio_set_dir(LED_PIN_0, GPIO_OUT);
-    gpio_set_dir(LED_PIN_1, GPIO_OUT);
-    gpio_set_dir(LED_PIN_2, GPIO_OUT);
-    gpio_set_dir(LED_PIN_3, GPIO_OUT);
-    gpio_set_dir(LED_PIN_4, GPIO_OUT);
-    gpio_set_dir(LED_PIN_5, GPIO_OUT);
-    gpio_set_dir(LED_PIN_6, GPIO_OUT);
-    gpio_set_dir(LED_PIN_7, GPIO_OUT);
-
-    gpio_put(LED_PIN_0, 0);
-    gpio_put(LED_PIN_1, 0);
-    gpio_put(LED_PIN_2, 0);
-    gpio_put(LED_PIN_3, 0);
-    gpio_put(LED_PIN_4, 0);
-    gpio_put(LED_PIN_5, 0);
-    gpio_put(LED_PIN_6, 0);
-    gpio_put(LED_PIN_7, 0);
-}
-
 void set_leds(const uint8_t value)
 {
-    gpio_put(LED_PIN_0, (value & 0x01));
-    gpio_put(LED_PIN_1, (value & 0x02));
-    gpio_put(LED_PIN_2, (value & 0x04));
-    gpio_put(LED_PIN_3, (value & 0x08));
-    gpio_put(LED_PIN_4, (value & 0x10));
-    gpio_put(LED_PIN_5, (value & 0x20));
-    gpio_put(LED_PIN_6, (value & 0x40));
-    gpio_put(LED_PIN_7, (value & 0x80));
+    leds::show(value);
 }
 
 // 8 bit fifo
@@ -118,7 +76,7 @@ int main()
     printf("I2C Button Master\n");
     
     // Init LEDs
-    init_leds();
+    leds::init();
 
     // Add triggers to buttons
     gpio_init(SDA_PIN);
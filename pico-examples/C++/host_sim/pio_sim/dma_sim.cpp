@@ -0,0 +1,202 @@
+#include "pio_sim.h"
+#include "hardware/dma.h"
+
+#include <string.h>
+
+struct sim_dma_channel
+{
+    dma_channel_config config;
+    bool claimed = false;
+    bool busy = false;
+
+    uintptr_t write_addr = 0;
+    uintptr_t read_addr = 0;
+    uint count = 0;
+};
+
+static sim_dma_channel sim_dma_channels[NUM_DMA_CHANNELS];
+static uint sim_dma_busy = 0;
+
+// The state machine whose TX or RX FIFO register an address is, if it is one
+static bool find_fifo(uintptr_t addr, PIO* pio, uint* sm)
+{
+    for (uint index = 0; index < NUM_PIOS; index++)
+    {
+        PIO block = pio_sim_get(index);
+        for (uint i = 0; i < NUM_PIO_STATE_MACHINES; i++)
+        {
+            if (addr == (uintptr_t)&block->txf[i] || addr == (uintptr_t)&block->rxf[i])
+            {
+                *pio = block;
+                *sm = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static uint transfer_bytes(const sim_dma_channel& channel)
+{
+    return 1u << channel.config.size;
+}
+
+static uint32_t read_transfer(sim_dma_channel& channel)
+{
+    PIO pio;
+    uint sm;
+    if (find_fifo(channel.read_addr, &pio, &sm))
+        return pio_sm_get(pio, sm);
+
+    uint32_t value = 0;
+    memcpy(&value, (const void*)channel.read_addr, transfer_bytes(channel));
+    return value;
+}
+
+static void write_transfer(sim_dma_channel& channel, uint32_t value)
+{
+    PIO pio;
+    uint sm;
+    if (find_fifo(channel.write_addr, &pio, &sm))
+    {
+        // The bus replicates a narrow write across the whole register
+        if (channel.config.size == DMA_SIZE_8)
+            value = (value & 0xffu) * 0x01010101u;
+        else if (channel.config.size == DMA_SIZE_16)
+            value = (value & 0xffffu) * 0x00010001u;
+        pio_sm_put(pio, sm, value);
+        return;
+    }
+    memcpy((void*)channel.write_addr, &value, transfer_bytes(channel));
+}
+
+static void finish_transfer(sim_dma_channel& channel)
+{
+    if (channel.config.read_increment)
+        channel.read_addr += transfer_bytes(channel);
+    if (channel.config.write_increment)
+        channel.write_addr += transfer_bytes(channel);
+
+    if (--channel.count == 0)
+    {
+        channel.busy = false;
+        sim_dma_busy--;
+    }
+}
+
+// Whether the FIFO pacing a channel lets it make a transfer now
+static bool dreq_ready(const sim_dma_channel& channel, PIO pio)
+{
+    uint dreq = channel.config.dreq;
+    if (dreq >= DREQ_PIO1_RX0 + NUM_PIO_STATE_MACHINES || dreq / 8 != pio_get_index(pio))
+        return false;
+
+    uint sm = dreq % NUM_PIO_STATE_MACHINES;
+    if ((dreq % 8) < 4)
+        return !pio_sm_is_tx_fifo_full(pio, sm);
+    return !pio_sm_is_rx_fifo_empty(pio, sm);
+}
+
+
+bool sim_dma_service(PIO pio)
+{
+    if (sim_dma_busy == 0)
+        return false;
+
+    bool moved = false;
+    for (sim_dma_channel& channel : sim_dma_channels)
+    {
+        if (!channel.busy || !dreq_ready(channel, pio))
+            continue;
+
+        write_transfer(channel, read_transfer(channel));
+        finish_transfer(channel);
+        moved = true;
+    }
+    return moved;
+}
+
+void sim_dma_reset()
+{
+    for (sim_dma_channel& channel : sim_dma_channels)
+        channel = sim_dma_channel();
+    sim_dma_busy = 0;
+}
+
+
+void dma_channel_claim(uint channel)
+{
+    assert(!sim_dma_channels[channel].claimed);
+    sim_dma_channels[channel].claimed = true;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    sim_dma_channels[channel].claimed = false;
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    for (uint channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+    {
+        if (!sim_dma_channels[channel].claimed)
+        {
+            sim_dma_channels[channel].claimed = true;
+            return channel;
+        }
+    }
+    assert(!required && "no free DMA channel");
+    (void)required;
+    return -1;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+    sim_dma_channel& c = sim_dma_channels[channel];
+    assert(!c.busy);
+
+    c.config = *config;
+    c.write_addr = (uintptr_t)write_addr;
+    c.read_addr = (uintptr_t)read_addr;
+    c.count = transfer_count;
+
+    if (trigger)
+        dma_channel_start(channel);
+}
+
+void dma_channel_start(uint channel)
+{
+    sim_dma_channel& c = sim_dma_channels[channel];
+    if (c.busy || c.count == 0)
+        return;
+
+    c.busy = true;
+    sim_dma_busy++;
+
+    // Nothing paces an unpaced channel, it runs straight through
+    if (c.config.dreq == DREQ_FORCE)
+    {
+        while (c.busy)
+        {
+            write_transfer(c, read_transfer(c));
+            finish_transfer(c);
+        }
+    }
+}
+
+void dma_channel_abort(uint channel)
+{
+    sim_dma_channel& c = sim_dma_channels[channel];
+    if (c.busy)
+    {
+        c.busy = false;
+        sim_dma_busy--;
+    }
+    c.count = 0;
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    return sim_dma_channels[channel].busy;
+}
@@ -0,0 +1,76 @@
+#ifndef PIO_SIM_HARDWARE_DMA_H
+#define PIO_SIM_HARDWARE_DMA_H
+
+/*
+    Host stand in for the pico-sdk's hardware/dma.h, backed by dma_sim.cpp.
+
+    A channel paced by a PIO DREQ moves one transfer per PIO clock cycle while its FIFO has room
+    or data, the same as the emulated state machines see it. Narrow writes to a TX FIFO are
+    replicated across the word like the bus fabric does. Unpaced channels complete the moment
+    they are triggered.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef unsigned int uint;
+
+#define NUM_DMA_CHANNELS    12
+
+#define DREQ_PIO0_TX0       0
+#define DREQ_PIO0_RX0       4
+#define DREQ_PIO1_TX0       8
+#define DREQ_PIO1_RX0       12
+#define DREQ_FORCE          63
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+// Decoded form of the sdk's control register image
+typedef struct {
+    enum dma_channel_transfer_size size = DMA_SIZE_32;
+    bool read_increment = true;
+    bool write_increment = false;
+    uint dreq = DREQ_FORCE;
+} dma_channel_config;
+
+static inline dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    (void)channel;
+    return dma_channel_config();
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr)
+{
+    c->read_increment = incr;
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr)
+{
+    c->write_increment = incr;
+}
+
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq)
+{
+    c->dreq = dreq;
+}
+
+void dma_channel_claim(uint channel);
+void dma_channel_unclaim(uint channel);
+int  dma_claim_unused_channel(bool required);
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PIO_SIM_HARDWARE_IRQ_H
+#define PIO_SIM_HARDWARE_IRQ_H
+
+/*
+    Host stand in for the pico-sdk's hardware/irq.h, only the PIO interrupt lines exist.
+    Handlers are run by the simulated PIO as soon as an enabled source is raised.
+*/
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+typedef void (*irq_handler_t)(void);
+
+#define PIO0_IRQ_0  7
+#define PIO0_IRQ_1  8
+#define PIO1_IRQ_0  9
+#define PIO1_IRQ_1  10
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif
@@ -0,0 +1,204 @@
+#ifndef PIO_SIM_HARDWARE_PIO_H
+#define PIO_SIM_HARDWARE_PIO_H
+
+/*
+    Host stand in for the pico-sdk's hardware/pio.h, backed by the PIO emulator in pio_sim.cpp.
+
+    Only the part of the api the drivers in lib use is provided, with the sdk's signatures, so a
+    driver and the header pioasm generates for it compile unchanged on the host.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/pio_instructions.h"
+
+typedef unsigned int uint;
+
+#define NUM_PIOS                2
+#define NUM_PIO_STATE_MACHINES  4
+#define PIO_INSTRUCTION_COUNT   32
+
+// Only the FIFO registers a DMA channel can be pointed at, the emulator keeps the rest behind them
+typedef struct pio_hw {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+    volatile uint32_t rxf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+PIO pio_sim_get(uint index);
+
+#define pio0 pio_sim_get(0)
+#define pio1 pio_sim_get(1)
+
+typedef struct pio_program {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+enum pio_fifo_join {
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+enum pio_interrupt_source {
+    pis_sm0_rx_fifo_not_empty = 0,
+    pis_sm1_rx_fifo_not_empty,
+    pis_sm2_rx_fifo_not_empty,
+    pis_sm3_rx_fifo_not_empty,
+    pis_sm0_tx_fifo_not_full,
+    pis_sm1_tx_fifo_not_full,
+    pis_sm2_tx_fifo_not_full,
+    pis_sm3_tx_fifo_not_full,
+    pis_interrupt0,
+    pis_interrupt1,
+    pis_interrupt2,
+    pis_interrupt3,
+};
+
+// Decoded form of the sdk's register image
+typedef struct {
+    uint wrap_target = 0;
+    uint wrap = 31;
+    uint sideset_bit_count = 0;     // includes the enable bit when optional
+    bool sideset_optional = false;
+    bool sideset_pindirs = false;
+    uint sideset_base = 0;
+    uint in_base = 0;
+    uint out_base = 0;
+    uint out_count = 32;
+    uint set_base = 0;
+    uint set_count = 5;
+    uint jmp_pin = 0;
+    bool in_shift_right = true;
+    bool autopush = false;
+    uint push_threshold = 32;
+    bool out_shift_right = true;
+    bool autopull = false;
+    uint pull_threshold = 32;
+    enum pio_fifo_join fifo_join = PIO_FIFO_JOIN_NONE;
+    uint clkdiv_int = 1;
+    uint clkdiv_frac = 0;           // 1/256ths
+} pio_sm_config;
+
+static inline pio_sm_config pio_get_default_sm_config()
+{
+    return pio_sm_config();
+}
+
+static inline void sm_config_set_wrap(pio_sm_config* c, uint wrap_target, uint wrap)
+{
+    c->wrap_target = wrap_target;
+    c->wrap = wrap;
+}
+
+static inline void sm_config_set_sideset(pio_sm_config* c, uint bit_count, bool optional, bool pindirs)
+{
+    c->sideset_bit_count = bit_count;
+    c->sideset_optional = optional;
+    c->sideset_pindirs = pindirs;
+}
+
+static inline void sm_config_set_sideset_pins(pio_sm_config* c, uint sideset_base)
+{
+    c->sideset_base = sideset_base;
+}
+
+static inline void sm_config_set_in_pins(pio_sm_config* c, uint in_base)
+{
+    c->in_base = in_base;
+}
+
+static inline void sm_config_set_out_pins(pio_sm_config* c, uint out_base, uint out_count)
+{
+    c->out_base = out_base;
+    c->out_count = out_count;
+}
+
+static inline void sm_config_set_set_pins(pio_sm_config* c, uint set_base, uint set_count)
+{
+    c->set_base = set_base;
+    c->set_count = set_count;
+}
+
+static inline void sm_config_set_jmp_pin(pio_sm_config* c, uint pin)
+{
+    c->jmp_pin = pin;
+}
+
+static inline void sm_config_set_in_shift(pio_sm_config* c, bool shift_right, bool autopush, uint push_threshold)
+{
+    c->in_shift_right = shift_right;
+    c->autopush = autopush;
+    c->push_threshold = push_threshold ? push_threshold : 32;
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config* c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    c->out_shift_right = shift_right;
+    c->autopull = autopull;
+    c->pull_threshold = pull_threshold ? pull_threshold : 32;
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config* c, enum pio_fifo_join join)
+{
+    c->fifo_join = join;
+}
+
+static inline void sm_config_set_clkdiv_int_frac(pio_sm_config* c, uint16_t div_int, uint8_t div_frac)
+{
+    c->clkdiv_int = div_int;
+    c->clkdiv_frac = div_frac;
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config* c, float div)
+{
+    uint div_int = (uint)div;
+    sm_config_set_clkdiv_int_frac(c, div_int, (uint)((div - div_int) * 256));
+}
+
+uint pio_get_index(PIO pio);
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program);
+uint pio_add_program(PIO pio, const pio_program_t* program);
+
+void pio_sm_claim(PIO pio, uint sm);
+void pio_sm_unclaim(PIO pio, uint sm);
+bool pio_sm_is_claimed(PIO pio, uint sm);
+int  pio_claim_unused_sm(PIO pio, bool required);
+
+void pio_gpio_init(PIO pio, uint pin);
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_restart(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_exec(PIO pio, uint sm, uint instr);
+uint8_t pio_sm_get_pc(PIO pio, uint sm);
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask);
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask);
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_rx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get(PIO pio, uint sm);
+
+// DREQ numbers of the sdk's hardware/dma.h
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm;
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+void pio_set_irq1_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef PIO_SIM_HARDWARE_PIO_INSTRUCTIONS_H
+#define PIO_SIM_HARDWARE_PIO_INSTRUCTIONS_H
+
+/*
+    Host stand in for the pico-sdk's hardware/pio_instructions.h, the encoders needed by the
+    drivers in lib. Encodings are the RP2040 datasheet's.
+*/
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+enum pio_instr_bits {
+    pio_instr_bits_jmp  = 0x0000,
+    pio_instr_bits_wait = 0x2000,
+    pio_instr_bits_in   = 0x4000,
+    pio_instr_bits_out  = 0x6000,
+    pio_instr_bits_push = 0x8000,
+    pio_instr_bits_pull = 0x8080,
+    pio_instr_bits_mov  = 0xa000,
+    pio_instr_bits_irq  = 0xc000,
+    pio_instr_bits_set  = 0xe000,
+};
+
+// Only the 3 bit field is kept, the sdk also packs in which instructions accept each one
+enum pio_src_dest {
+    pio_pins = 0u,
+    pio_x = 1u,
+    pio_y = 2u,
+    pio_null = 3u,
+    pio_pindirs = 4u,
+    pio_exec_mov = 4u,
+    pio_status = 5u,
+    pio_pc = 5u,
+    pio_isr = 6u,
+    pio_osr = 7u,
+    pio_exec_out = 7u,
+};
+
+static inline uint pio_encode_jmp(uint addr)
+{
+    return pio_instr_bits_jmp | (addr & 0x1fu);
+}
+
+static inline uint pio_encode_in(enum pio_src_dest src, uint count)
+{
+    return pio_instr_bits_in | ((uint)src << 5) | (count & 0x1fu);
+}
+
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count)
+{
+    return pio_instr_bits_out | ((uint)dest << 5) | (count & 0x1fu);
+}
+
+static inline uint pio_encode_push(bool if_full, bool block)
+{
+    return pio_instr_bits_push | (if_full ? 0x40u : 0) | (block ? 0x20u : 0);
+}
+
+static inline uint pio_encode_pull(bool if_empty, bool block)
+{
+    return pio_instr_bits_pull | (if_empty ? 0x40u : 0) | (block ? 0x20u : 0);
+}
+
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src)
+{
+    return pio_instr_bits_mov | ((uint)dest << 5) | (uint)src;
+}
+
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value)
+{
+    return pio_instr_bits_set | ((uint)dest << 5) | (value & 0x1fu);
+}
+
+static inline uint pio_encode_wait_pin(bool polarity, uint pin)
+{
+    return pio_instr_bits_wait | (polarity ? 0x80u : 0) | (1u << 5) | (pin & 0x1fu);
+}
+
+// Delay and side set are or'ed onto an instruction, sideset_bit_count leaves out the enable bit
+static inline uint pio_encode_delay(uint cycles)
+{
+    return (cycles & 0x1fu) << 8;
+}
+
+static inline uint pio_encode_sideset(uint sideset_bit_count, uint value)
+{
+    return value << (13u - sideset_bit_count);
+}
+
+static inline uint pio_encode_sideset_opt(uint sideset_bit_count, uint value)
+{
+    return 0x1000u | (value << (12u - sideset_bit_count));
+}
+
+static inline uint pio_encode_nop()
+{
+    return pio_encode_mov(pio_y, pio_y);
+}
+
+#endif
@@ -0,0 +1,604 @@
+#include "pio_assembler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sstream>
+
+// An instruction waiting for every label of its program to be known
+struct pio_asm_statement {
+    int line;
+    std::string text;
+    std::vector<std::string> tokens;
+    int delay;
+    int side;
+};
+
+struct pio_asm_context {
+    pio_asm_file* file;
+    pio_asm_program* program;
+    std::vector<pio_asm_statement> statements;
+    int line;
+    std::string error;
+};
+
+static bool fail(pio_asm_context& ctx, int line, const std::string& message)
+{
+    ctx.error = std::to_string(line) + ": " + message;
+    return false;
+}
+
+static std::string trim(const std::string& text)
+{
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+static std::string strip_comment(const std::string& text)
+{
+    size_t end = text.size();
+    size_t semicolon = text.find(';');
+    size_t slashes = text.find("//");
+    if (semicolon != std::string::npos)
+        end = semicolon;
+    if (slashes != std::string::npos && slashes < end)
+        end = slashes;
+    return text.substr(0, end);
+}
+
+static std::vector<std::string> split(const std::string& text)
+{
+    std::string spaced = text;
+    for (char& c : spaced)
+    {
+        if (c == ',')
+            c = ' ';
+    }
+
+    std::vector<std::string> tokens;
+    std::istringstream stream(spaced);
+    std::string token;
+    while (stream >> token)
+        tokens.push_back(token);
+    return tokens;
+}
+
+static bool parse_number(const std::string& text, int& value)
+{
+    if (text.empty())
+        return false;
+
+    char* end = nullptr;
+    long parsed;
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B'))
+        parsed = strtol(text.c_str() + 2, &end, 2);
+    else
+        parsed = strtol(text.c_str(), &end, 0);
+
+    if (*end != '\0')
+        return false;
+    value = (int)parsed;
+    return true;
+}
+
+static int find_name(const char* const* names, const std::string& name)
+{
+    for (int i = 0; names[i] != nullptr; i++)
+    {
+        if (name == names[i])
+            return i;
+    }
+    return -1;
+}
+
+// Index in each table is the value of the 3 bit field, empty strings are not valid there
+static const char* const in_sources[] = {"pins", "x", "y", "null", "", "", "isr", "osr", nullptr};
+static const char* const out_destinations[] = {"pins", "x", "y", "null", "pindirs", "pc", "isr", "exec", nullptr};
+static const char* const mov_destinations[] = {"pins", "x", "y", "", "exec", "pc", "isr", "osr", nullptr};
+static const char* const mov_sources[] = {"pins", "x", "y", "null", "", "status", "isr", "osr", nullptr};
+static const char* const set_destinations[] = {"pins", "x", "y", "", "pindirs", nullptr};
+static const char* const jmp_conditions[] = {"", "!x", "x--", "!y", "y--", "x!=y", "pin", "!osre", nullptr};
+
+static bool encode(pio_asm_context& ctx, const pio_asm_statement& statement, uint16_t& instruction)
+{
+    const std::vector<std::string>& t = statement.tokens;
+    const std::string& op = t[0];
+    size_t count = t.size();
+    int line = statement.line;
+    int value;
+
+    if (op == "nop" && count == 1)
+    {
+        instruction = 0xa042;      // mov y, y
+    }
+    else if (op == "jmp" && (count == 2 || count == 3))
+    {
+        int condition = 0;
+        if (count == 3)
+        {
+            condition = find_name(jmp_conditions, t[1]);
+            if (condition <= 0)
+                return fail(ctx, line, "unknown jmp condition '" + t[1] + "'");
+        }
+
+        const std::string& target = t[count - 1];
+        int address = -1;
+        for (const pio_asm_label& label : ctx.program->labels)
+        {
+            if (label.name == target)
+                address = label.address;
+        }
+        if (address < 0 && !parse_number(target, address))
+            return fail(ctx, line, "unknown label '" + target + "'");
+
+        instruction = 0x0000 | (condition << 5) | (address & 0x1f);
+    }
+    else if (op == "wait" && (count == 4 || count == 5))
+    {
+        int polarity;
+        if (!parse_number(t[1], polarity) || polarity > 1)
+            return fail(ctx, line, "wait polarity must be 0 or 1");
+
+        int source = (t[2] == "gpio") ? 0 : (t[2] == "pin") ? 1 : (t[2] == "irq") ? 2 : -1;
+        if (source < 0)
+            return fail(ctx, line, "unknown wait source '" + t[2] + "'");
+
+        if (!parse_number(t[3], value) || value > 31)
+            return fail(ctx, line, "bad wait index");
+
+        if (count == 5)
+        {
+            if (source != 2 || t[4] != "rel" || value > 7)
+                return fail(ctx, line, "only an irq index can be rel");
+            value |= 0x10;
+        }
+        instruction = 0x2000 | (polarity << 7) | (source << 5) | value;
+    }
+    else if ((op == "in" || op == "out") && count == 3)
+    {
+        int field = find_name(op == "in" ? in_sources : out_destinations, t[1]);
+        if (field < 0 || t[1].empty())
+            return fail(ctx, line, "unknown " + op + " operand '" + t[1] + "'");
+
+        if (!parse_number(t[2], value) || value < 1 || value > 32)
+            return fail(ctx, line, "bit count must be 1 to 32");
+
+        instruction = (op == "in" ? 0x4000 : 0x6000) | (field << 5) | (value & 0x1f);
+    }
+    else if ((op == "push" || op == "pull") && count <= 3)
+    {
+        bool conditional = false;
+        bool block = true;
+        for (size_t i = 1; i < count; i++)
+        {
+            if (t[i] == (op == "push" ? "iffull" : "ifempty"))
+                conditional = true;
+            else if (t[i] == "block")
+                block = true;
+            else if (t[i] == "noblock")
+                block = false;
+            else
+                return fail(ctx, line, "unknown " + op + " option '" + t[i] + "'");
+        }
+        instruction = (op == "push" ? 0x8000 : 0x8080) | (conditional ? 0x40 : 0) | (block ? 0x20 : 0);
+    }
+    else if (op == "mov" && count == 3)
+    {
+        int destination = find_name(mov_destinations, t[1]);
+        if (destination < 0 || t[1].empty())
+            return fail(ctx, line, "unknown mov destination '" + t[1] + "'");
+
+        std::string source_name = t[2];
+        int operation = 0;
+        if (source_name[0] == '~' || source_name[0] == '!')
+        {
+            operation = 1;
+            source_name = source_name.substr(1);
+        }
+        else if (source_name.compare(0, 2, "::") == 0)
+        {
+            operation = 2;
+            source_name = source_name.substr(2);
+        }
+
+        int source = find_name(mov_sources, source_name);
+        if (source < 0 || source_name.empty())
+            return fail(ctx, line, "unknown mov source '" + source_name + "'");
+
+        instruction = 0xa000 | (destination << 5) | (operation << 3) | source;
+    }
+    else if (op == "irq" && count >= 2 && count <= 4)
+    {
+        size_t index = 1;
+        bool clear = false;
+        bool wait = false;
+        if (t[1] == "set" || t[1] == "nowait")
+            index = 2;
+        else if (t[1] == "wait")
+            wait = true, index = 2;
+        else if (t[1] == "clear")
+            clear = true, index = 2;
+
+        if (index >= count || !parse_number(t[index], value) || value > 7)
+            return fail(ctx, line, "irq index must be 0 to 7");
+
+        if (index + 1 < count)
+        {
+            if (t[index + 1] != "rel" || index + 2 != count)
+                return fail(ctx, line, "unexpected '" + t[index + 1] + "'");
+            value |= 0x10;
+        }
+        else if (index + 1 != count)
+        {
+            return fail(ctx, line, "bad irq");
+        }
+        instruction = 0xc000 | (clear ? 0x40 : 0) | (wait ? 0x20 : 0) | value;
+    }
+    else if (op == "set" && count == 3)
+    {
+        int destination = find_name(set_destinations, t[1]);
+        if (destination < 0 || t[1].empty())
+            return fail(ctx, line, "unknown set destination '" + t[1] + "'");
+
+        if (!parse_number(t[2], value) || value < 0 || value > 31)
+            return fail(ctx, line, "set value must be 0 to 31");
+
+        instruction = 0xe000 | (destination << 5) | value;
+    }
+    else
+    {
+        return fail(ctx, line, "bad instruction '" + statement.text + "'");
+    }
+
+    // Side set and delay share bits 12:8, side set at the top with its enable bit first
+    const pio_asm_program& program = *ctx.program;
+    unsigned int delay_bits = 5 - program.sideset_bits;
+    unsigned int side_field = 0;
+
+    if (statement.side >= 0)
+    {
+        if (program.sideset_bits == 0)
+            return fail(ctx, line, "side set used without .side_set");
+
+        unsigned int value_bits = program.sideset_bits - (program.sideset_optional ? 1 : 0);
+        if ((unsigned int)statement.side >= (1u << value_bits))
+            return fail(ctx, line, "side set value too large");
+
+        side_field = statement.side;
+        if (program.sideset_optional)
+            side_field |= 1u << value_bits;
+    }
+    else if (program.sideset_bits && !program.sideset_optional)
+    {
+        return fail(ctx, line, "side set is not optional");
+    }
+
+    if (statement.delay >= (1 << delay_bits))
+        return fail(ctx, line, "delay too large");
+
+    instruction |= ((side_field << delay_bits) | statement.delay) << 8;
+    return true;
+}
+
+static bool finish_program(pio_asm_context& ctx)
+{
+    if (ctx.program == nullptr)
+        return true;
+
+    for (const pio_asm_statement& statement : ctx.statements)
+    {
+        uint16_t instruction;
+        if (!encode(ctx, statement, instruction))
+            return false;
+        ctx.program->instructions.push_back(instruction);
+        ctx.program->source.push_back(statement.text);
+    }
+    ctx.statements.clear();
+
+    int length = ctx.program->instructions.size();
+    if (length == 0)
+        return fail(ctx, ctx.line, "program " + ctx.program->name + " is empty");
+    if (length > 32)
+        return fail(ctx, ctx.line, "program " + ctx.program->name + " has more than 32 instructions");
+
+    if (ctx.program->wrap_target < 0)
+        ctx.program->wrap_target = 0;
+    if (ctx.program->wrap < 0)
+        ctx.program->wrap = length - 1;
+    return true;
+}
+
+static bool directive(pio_asm_context& ctx, const std::vector<std::string>& t)
+{
+    int instruction_count = ctx.statements.size();
+
+    if (t[0] == ".program")
+    {
+        if (t.size() != 2)
+            return fail(ctx, ctx.line, ".program needs a name");
+        if (!finish_program(ctx))
+            return false;
+        ctx.file->programs.emplace_back();
+        ctx.program = &ctx.file->programs.back();
+        ctx.program->name = t[1];
+        return true;
+    }
+
+    if (ctx.program == nullptr)
+        return fail(ctx, ctx.line, t[0] + " outside a program");
+
+    if (t[0] == ".side_set")
+    {
+        int bits;
+        if (t.size() < 2 || !parse_number(t[1], bits))
+            return fail(ctx, ctx.line, ".side_set needs a bit count");
+        for (size_t i = 2; i < t.size(); i++)
+        {
+            if (t[i] == "opt")
+                ctx.program->sideset_optional = true;
+            else if (t[i] == "pindirs")
+                ctx.program->sideset_pindirs = true;
+            else
+                return fail(ctx, ctx.line, "unknown .side_set option '" + t[i] + "'");
+        }
+        ctx.program->sideset_bits = bits + (ctx.program->sideset_optional ? 1 : 0);
+        if (ctx.program->sideset_bits > 5)
+            return fail(ctx, ctx.line, "too many side set bits");
+    }
+    else if (t[0] == ".wrap_target")
+    {
+        ctx.program->wrap_target = instruction_count;
+    }
+    else if (t[0] == ".wrap")
+    {
+        if (instruction_count == 0)
+            return fail(ctx, ctx.line, ".wrap before any instruction");
+        ctx.program->wrap = instruction_count - 1;
+    }
+    else if (t[0] == ".origin")
+    {
+        if (t.size() != 2 || !parse_number(t[1], ctx.program->origin))
+            return fail(ctx, ctx.line, ".origin needs an address");
+    }
+    else
+    {
+        return fail(ctx, ctx.line, "unsupported directive " + t[0]);
+    }
+    return true;
+}
+
+static bool statement(pio_asm_context& ctx, std::string text)
+{
+    if (ctx.program == nullptr)
+        return fail(ctx, ctx.line, "instruction outside a program");
+
+    pio_asm_statement s;
+    s.line = ctx.line;
+    s.text = trim(text);
+    s.delay = 0;
+    s.side = -1;
+
+    // Delay in square brackets at the end
+    size_t open = text.find('[');
+    if (open != std::string::npos)
+    {
+        size_t close = text.find(']', open);
+        if (close == std::string::npos || !parse_number(trim(text.substr(open + 1, close - open - 1)), s.delay))
+            return fail(ctx, ctx.line, "bad delay");
+        text.erase(open, close - open + 1);
+    }
+
+    std::vector<std::string> tokens = split(text);
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        if (tokens[i] == "side")
+        {
+            if (i + 2 != tokens.size() || !parse_number(tokens[i + 1], s.side))
+                return fail(ctx, ctx.line, "side must be followed by a value at the end");
+            tokens.resize(i);
+            break;
+        }
+
+        // Allow a space between an operator and the mov source
+        if ((tokens[i] == "~" || tokens[i] == "!" || tokens[i] == "::") && i + 1 < tokens.size())
+        {
+            tokens[i] += tokens[i + 1];
+            tokens.erase(tokens.begin() + i + 1);
+        }
+    }
+
+    if (tokens.empty())
+        return fail(ctx, ctx.line, "missing instruction");
+    s.tokens = tokens;
+    ctx.statements.push_back(s);
+    return true;
+}
+
+bool pio_assemble(const std::string& source, pio_asm_file& file, std::string& error)
+{
+    pio_asm_context ctx;
+    ctx.file = &file;
+    ctx.program = nullptr;
+    ctx.line = 0;
+
+    std::istringstream stream(source);
+    std::string raw;
+    std::string* code_block = nullptr;
+    bool keep_block = false;
+    std::string discarded;
+
+    while (std::getline(stream, raw))
+    {
+        ctx.line++;
+
+        if (code_block != nullptr)
+        {
+            if (trim(raw).compare(0, 2, "%}") == 0)
+            {
+                code_block = nullptr;
+                continue;
+            }
+            if (keep_block)
+                *code_block += raw + "\n";
+            continue;
+        }
+
+        std::string text = trim(strip_comment(raw));
+        if (text.empty())
+            continue;
+
+        // % <language> { ... %}, only c-sdk blocks end up in the header
+        if (text[0] == '%')
+        {
+            std::vector<std::string> t = split(text.substr(1));
+            if (t.size() != 2 || t[1] != "{")
+            {
+                error = std::to_string(ctx.line) + ": bad code block";
+                return false;
+            }
+            keep_block = (t[0] == "c-sdk");
+            std::vector<std::string>& blocks = ctx.program ? ctx.program->code_blocks : file.code_blocks;
+            if (keep_block)
+            {
+                blocks.emplace_back();
+                code_block = &blocks.back();
+            }
+            else
+            {
+                discarded.clear();
+                code_block = &discarded;
+            }
+            continue;
+        }
+
+        if (text[0] == '.')
+        {
+            if (!directive(ctx, split(text)))
+            {
+                error = ctx.error;
+                return false;
+            }
+            continue;
+        }
+
+        // Labels, optionally public, may share a line with an instruction
+        size_t colon = text.find(':');
+        if (colon != std::string::npos && text.compare(colon, 2, "::") != 0)
+        {
+            std::vector<std::string> t = split(text.substr(0, colon));
+            bool is_public = (t.size() == 2 && t[0] == "public");
+            if (ctx.program == nullptr || !(t.size() == 1 || is_public))
+            {
+                error = std::to_string(ctx.line) + ": bad label";
+                return false;
+            }
+            ctx.program->labels.push_back({t.back(), (unsigned int)ctx.statements.size(), is_public});
+
+            text = trim(text.substr(colon + 1));
+            if (text.empty())
+                continue;
+        }
+
+        if (!statement(ctx, text))
+        {
+            error = ctx.error;
+            return false;
+        }
+    }
+
+    if (code_block != nullptr)
+    {
+        error = std::to_string(ctx.line) + ": code block is not closed";
+        return false;
+    }
+
+    if (!finish_program(ctx))
+    {
+        error = ctx.error;
+        return false;
+    }
+    return true;
+}
+
+std::string pio_asm_header(const pio_asm_file& file)
+{
+    std::string out;
+    char buffer[1024];
+
+    out += "// ------------------------------------------------------ //\n";
+    out += "// This file is autogenerated by pio_header; do not edit! //\n";
+    out += "// ------------------------------------------------------ //\n\n";
+    out += "#pragma once\n\n";
+    out += "#if !PICO_NO_HARDWARE\n#include \"hardware/pio.h\"\n#endif\n\n";
+
+    for (const std::string& block : file.code_blocks)
+        out += block + "\n";
+
+    for (const pio_asm_program& program : file.programs)
+    {
+        const char* name = program.name.c_str();
+        std::string rule(program.name.size(), '-');
+
+        out += "// " + rule + " //\n// " + program.name + " //\n// " + rule + " //\n\n";
+
+        snprintf(buffer, sizeof(buffer), "#define %s_wrap_target %d\n#define %s_wrap %d\n\n",
+                 name, program.wrap_target, name, program.wrap);
+        out += buffer;
+
+        bool any_public = false;
+        for (const pio_asm_label& label : program.labels)
+        {
+            if (!label.is_public)
+                continue;
+            snprintf(buffer, sizeof(buffer), "#define %s_offset_%s %uu\n", name, label.name.c_str(), label.address);
+            out += buffer;
+            any_public = true;
+        }
+        if (any_public)
+            out += "\n";
+
+        snprintf(buffer, sizeof(buffer), "static const uint16_t %s_program_instructions[] = {\n", name);
+        out += buffer;
+        for (size_t i = 0; i < program.instructions.size(); i++)
+        {
+            if ((int)i == program.wrap_target)
+                out += "            //     .wrap_target\n";
+            snprintf(buffer, sizeof(buffer), "    0x%04x, // %2u: ", program.instructions[i], (unsigned int)i);
+            out += buffer + program.source[i] + "\n";
+            if ((int)i == program.wrap)
+                out += "            //     .wrap\n";
+        }
+        out += "};\n\n";
+
+        out += "#if !PICO_NO_HARDWARE\n";
+        snprintf(buffer, sizeof(buffer),
+                 "static const struct pio_program %s_program = {\n"
+                 "    .instructions = %s_program_instructions,\n"
+                 "    .length = %u,\n"
+                 "    .origin = %d,\n"
+                 "};\n\n",
+                 name, name, (unsigned int)program.instructions.size(), program.origin);
+        out += buffer;
+
+        snprintf(buffer, sizeof(buffer),
+                 "static inline pio_sm_config %s_program_get_default_config(uint offset) {\n"
+                 "    pio_sm_config c = pio_get_default_sm_config();\n"
+                 "    sm_config_set_wrap(&c, offset + %s_wrap_target, offset + %s_wrap);\n",
+                 name, name, name);
+        out += buffer;
+        if (program.sideset_bits)
+        {
+            snprintf(buffer, sizeof(buffer), "    sm_config_set_sideset(&c, %u, %s, %s);\n", program.sideset_bits,
+                     program.sideset_optional ? "true" : "false", program.sideset_pindirs ? "true" : "false");
+            out += buffer;
+        }
+        out += "    return c;\n}\n";
+
+        for (const std::string& block : program.code_blocks)
+            out += "\n" + block;
+        out += "#endif\n\n";
+    }
+    return out;
+}
@@ -0,0 +1,50 @@
+#ifndef PIO_ASSEMBLER_H
+#define PIO_ASSEMBLER_H
+
+/*
+    Small PIO assembler for the host simulation.
+
+    The pico-sdk builds .pio files with pioasm, which is not available on the host. This handles
+    the subset of the language the programs in lib use: every instruction, side set and delay,
+    labels, .program, .side_set, .wrap_target, .wrap, .origin and % c-sdk blocks. The header it
+    writes has the same names and layout as pioasm's so drivers include it unchanged.
+*/
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct pio_asm_label {
+    std::string name;
+    unsigned int address;
+    bool is_public;
+};
+
+struct pio_asm_program {
+    std::string name;
+    std::vector<uint16_t> instructions;
+    std::vector<std::string> source;        // the text of each instruction, for the header
+    std::vector<pio_asm_label> labels;
+    std::vector<std::string> code_blocks;   // bodies of this program's % c-sdk blocks
+
+    int origin = -1;
+    unsigned int sideset_bits = 0;          // includes the enable bit when optional
+    bool sideset_optional = false;
+    bool sideset_pindirs = false;
+    int wrap_target = -1;
+    int wrap = -1;
+};
+
+struct pio_asm_file {
+    std::vector<pio_asm_program> programs;
+    std::vector<std::string> code_blocks;   // % c-sdk blocks before the first program
+};
+
+/// @brief assemble the text of a .pio file
+/// @param error set to "line: message" when false is returned
+bool pio_assemble(const std::string& source, pio_asm_file& file, std::string& error);
+
+// Text of the header pioasm would generate for the file
+std::string pio_asm_header(const pio_asm_file& file);
+
+#endif
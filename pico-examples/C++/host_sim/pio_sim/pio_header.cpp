@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+#include "pio_assembler.h"
+
+/*
+    Host replacement for pioasm, writes the C header for a .pio file.
+
+    usage: pio_header <input.pio> <output.pio.h>
+*/
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: pio_header <input.pio> <output.pio.h>\n");
+        return 1;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input)
+    {
+        fprintf(stderr, "%s: cannot open\n", argv[1]);
+        return 1;
+    }
+    std::stringstream source;
+    source << input.rdbuf();
+
+    pio_asm_file file;
+    std::string error;
+    if (!pio_assemble(source.str(), file, error))
+    {
+        fprintf(stderr, "%s:%s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    std::ofstream output(argv[2]);
+    output << pio_asm_header(file);
+    if (!output)
+    {
+        fprintf(stderr, "%s: cannot write\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
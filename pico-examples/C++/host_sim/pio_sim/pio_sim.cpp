@@ -0,0 +1,928 @@
+#include "pio_sim.h"
+
+#include <deque>
+#include <vector>
+
+struct sim_pio_sm
+{
+    pio_sm_config config;
+    bool claimed = false;
+    bool enabled = false;
+
+    uint pc = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t isr = 0;
+    uint32_t osr = 0;
+    uint isr_count = 0;
+    uint osr_count = 32;        // empty at power on
+
+    uint delay = 0;
+    uint32_t clock_count = 0;   // 1/256ths of a cycle towards the divider
+    bool irq_waiting = false;   // an irq wait has set its flag and waits for it to clear
+
+    // Instruction written through pio_sm_exec or by out / mov exec, run instead of the next one
+    bool exec_pending = false;
+    uint16_t exec_instruction = 0;
+
+    std::deque<uint32_t> tx;
+    std::deque<uint32_t> rx;
+};
+
+struct pio_sim_block : pio_hw_t
+{
+    uint index;
+    uint16_t instructions[PIO_INSTRUCTION_COUNT];
+    uint32_t used_instructions;
+
+    sim_pio_sm sm[NUM_PIO_STATE_MACHINES];
+    uint8_t irq_flags;
+    uint32_t irq_sources[2];
+
+    // Output latches shared by the state machines, only pins given to the block reach the device
+    uint32_t pin_values;
+    uint32_t pin_dirs;
+    uint32_t gpio_mask;
+    uint32_t device_values;
+    uint32_t device_dirs;
+
+    sim_device* device;
+    uint64_t synced_ns;
+    bool stepping;
+    bool in_irq;
+
+    // Block cycles since time 0, and how long a raised source waits for its handler
+    uint64_t clock;
+    uint64_t irq_latency_cycles;
+    uint64_t irq_raised_at;
+    bool irq_raised;
+
+    sim_pio_stats stats;
+};
+
+enum sim_pio_result {
+    SIM_PIO_NEXT,
+    SIM_PIO_JUMP,
+    SIM_PIO_STALL,
+};
+
+struct sim_irq_line
+{
+    std::vector<irq_handler_t> handlers;
+    bool enabled = false;
+};
+
+static pio_sim_block sim_pio_blocks[NUM_PIOS];
+static sim_irq_line sim_irq_lines[32];
+static bool sim_pio_hooked = false;
+
+static uint fifo_depth(const sim_pio_sm& s, bool tx)
+{
+    if (s.config.fifo_join == PIO_FIFO_JOIN_NONE)
+        return 4;
+    return (s.config.fifo_join == (tx ? PIO_FIFO_JOIN_TX : PIO_FIFO_JOIN_RX)) ? 8 : 0;
+}
+
+static bool pin_level(uint pin)
+{
+    pin %= 32;
+    if (pin >= NUM_BANK0_GPIOS)
+        return false;
+    return hal_gpio_get(pin);
+}
+
+static uint32_t read_pins(uint base, uint count)
+{
+    uint32_t value = 0;
+    for (uint i = 0; i < count; i++)
+        value |= (uint32_t)pin_level(base + i) << i;
+    return value;
+}
+
+static void write_latch(uint32_t& latch, uint base, uint count, uint32_t value)
+{
+    for (uint i = 0; i < count; i++)
+    {
+        uint pin = (base + i) % 32;
+        latch = (latch & ~(1u << pin)) | (((value >> i) & 1u) << pin);
+    }
+}
+
+// Push changed output latches onto the device pins
+static void sync_pins(pio_sim_block& block)
+{
+    uint32_t values = block.pin_values & block.gpio_mask;
+    uint32_t dirs = block.pin_dirs & block.gpio_mask;
+    uint32_t changed = (values ^ block.device_values) | (dirs ^ block.device_dirs);
+    if (!changed)
+        return;
+
+    block.device_values = values;
+    block.device_dirs = dirs;
+
+    sim_device_scope scope(block.device);
+    while (changed)
+    {
+        uint pin = __builtin_ctz(changed);
+        changed &= changed - 1;
+        hal_gpio_put(pin, (values >> pin) & 1u);
+        hal_gpio_set_dir(pin, (dirs >> pin) & 1u);
+    }
+}
+
+static uint irq_index(uint index, uint sm)
+{
+    // rel adds the state machine number to the bottom two bits
+    if (index & 0x10)
+        return (index & 0x4) | ((index + sm) & 0x3);
+    return index & 0x7;
+}
+
+static uint32_t bit_reverse(uint32_t value)
+{
+    uint32_t reversed = 0;
+    for (uint i = 0; i < 32; i++)
+        reversed |= ((value >> i) & 1u) << (31 - i);
+    return reversed;
+}
+
+static void apply_sideset(pio_sim_block& block, sim_pio_sm& s, uint16_t instruction)
+{
+    uint bits = s.config.sideset_bit_count;
+    if (bits == 0)
+        return;
+
+    uint field = (instruction >> 8) & 0x1f;
+    uint value = field >> (5 - bits);
+    uint value_bits = bits;
+
+    if (s.config.sideset_optional)
+    {
+        if (!(value & (1u << (bits - 1))))
+            return;
+        value_bits = bits - 1;
+        value &= (1u << value_bits) - 1;
+    }
+
+    if (s.config.sideset_pindirs)
+        write_latch(block.pin_dirs, s.config.sideset_base, value_bits, value);
+    else
+        write_latch(block.pin_values, s.config.sideset_base, value_bits, value);
+}
+
+static sim_pio_result execute(pio_sim_block& block, uint sm_index, uint16_t instruction)
+{
+    sim_pio_sm& s = block.sm[sm_index];
+    const pio_sm_config& c = s.config;
+
+    uint opcode = instruction >> 13;
+    uint field_a = (instruction >> 5) & 0x7;
+    uint field_b = instruction & 0x1f;
+
+    switch (opcode)
+    {
+    case 0: // jmp
+    {
+        bool take = false;
+        switch (field_a)
+        {
+        case 0: take = true; break;
+        case 1: take = (s.x == 0); break;
+        case 2: take = (s.x != 0); s.x--; break;
+        case 3: take = (s.y == 0); break;
+        case 4: take = (s.y != 0); s.y--; break;
+        case 5: take = (s.x != s.y); break;
+        case 6: take = pin_level(c.jmp_pin); break;
+        case 7: take = (s.osr_count < c.pull_threshold); break;
+        }
+        if (!take)
+            return SIM_PIO_NEXT;
+        s.pc = field_b;
+        return SIM_PIO_JUMP;
+    }
+
+    case 1: // wait
+    {
+        bool polarity = (instruction >> 7) & 1;
+        uint source = (instruction >> 5) & 0x3;
+        bool level = false;
+
+        if (source == 0)
+            level = pin_level(field_b);
+        else if (source == 1)
+            level = pin_level(c.in_base + field_b);
+        else if (source == 2)
+            level = (block.irq_flags >> irq_index(field_b, sm_index)) & 1;
+
+        if (level != polarity)
+            return SIM_PIO_STALL;
+
+        // Waiting for an irq flag to be set also clears it
+        if (source == 2 && polarity)
+            block.irq_flags &= ~(1u << irq_index(field_b, sm_index));
+        return SIM_PIO_NEXT;
+    }
+
+    case 2: // in
+    {
+        uint count = field_b ? field_b : 32;
+        if (c.autopush && s.isr_count + count >= c.push_threshold && s.rx.size() >= fifo_depth(s, false))
+            return SIM_PIO_STALL;
+
+        uint32_t data = 0;
+        switch (field_a)
+        {
+        case 0: data = read_pins(c.in_base, count); break;
+        case 1: data = s.x; break;
+        case 2: data = s.y; break;
+        case 6: data = s.isr; break;
+        case 7: data = s.osr; break;
+        default: break;
+        }
+
+        if (count == 32)
+            s.isr = data;
+        else if (c.in_shift_right)
+            s.isr = (s.isr >> count) | (data << (32 - count));
+        else
+            s.isr = (s.isr << count) | (data & ((1u << count) - 1));
+        s.isr_count = MIN(32u, s.isr_count + count);
+
+        if (c.autopush && s.isr_count >= c.push_threshold)
+        {
+            s.rx.push_back(s.isr);
+            s.isr = 0;
+            s.isr_count = 0;
+        }
+        return SIM_PIO_NEXT;
+    }
+
+    case 3: // out
+    {
+        uint count = field_b ? field_b : 32;
+        if (c.autopull && s.osr_count >= c.pull_threshold)
+        {
+            if (s.tx.empty())
+                return SIM_PIO_STALL;
+            s.osr = s.tx.front();
+            s.tx.pop_front();
+            s.osr_count = 0;
+        }
+
+        uint32_t data;
+        if (count == 32)
+        {
+            data = s.osr;
+            s.osr = 0;
+        }
+        else if (c.out_shift_right)
+        {
+            data = s.osr & ((1u << count) - 1);
+            s.osr >>= count;
+        }
+        else
+        {
+            data = s.osr >> (32 - count);
+            s.osr <<= count;
+        }
+        s.osr_count = MIN(32u, s.osr_count + count);
+
+        switch (field_a)
+        {
+        case 0: write_latch(block.pin_values, c.out_base, count, data); break;
+        case 1: s.x = data; break;
+        case 2: s.y = data; break;
+        case 4: write_latch(block.pin_dirs, c.out_base, count, data); break;
+        case 5: s.pc = data & 0x1f; return SIM_PIO_JUMP;
+        case 6: s.isr = data; s.isr_count = count; break;
+        case 7: s.exec_pending = true; s.exec_instruction = data; break;
+        default: break;
+        }
+        return SIM_PIO_NEXT;
+    }
+
+    case 4: // push / pull
+    {
+        bool conditional = instruction & 0x40;
+        bool block_on_fifo = instruction & 0x20;
+
+        if (instruction & 0x80)
+        {
+            if (conditional && s.osr_count < c.pull_threshold)
+                return SIM_PIO_NEXT;
+            if (s.tx.empty())
+            {
+                if (block_on_fifo)
+                    return SIM_PIO_STALL;
+                s.osr = s.x;
+            }
+            else
+            {
+                s.osr = s.tx.front();
+                s.tx.pop_front();
+            }
+            s.osr_count = 0;
+        }
+        else
+        {
+            if (conditional && s.isr_count < c.push_threshold)
+                return SIM_PIO_NEXT;
+            if (s.rx.size() >= fifo_depth(s, false))
+            {
+                if (block_on_fifo)
+                    return SIM_PIO_STALL;
+            }
+            else
+            {
+                s.rx.push_back(s.isr);
+            }
+            s.isr = 0;
+            s.isr_count = 0;
+        }
+        return SIM_PIO_NEXT;
+    }
+
+    case 5: // mov
+    {
+        uint operation = (instruction >> 3) & 0x3;
+        uint32_t value = 0;
+        switch (instruction & 0x7)
+        {
+        case 0: value = read_pins(c.in_base, 32); break;
+        case 1: value = s.x; break;
+        case 2: value = s.y; break;
+        case 6: value = s.isr; break;
+        case 7: value = s.osr; break;
+        default: break;     // null, status is never set
+        }
+
+        if (operation == 1)
+            value = ~value;
+        else if (operation == 2)
+            value = bit_reverse(value);
+
+        switch (field_a)
+        {
+        case 0: write_latch(block.pin_values, c.out_base, c.out_count, value); break;
+        case 1: s.x = value; break;
+        case 2: s.y = value; break;
+        case 4: s.exec_pending = true; s.exec_instruction = value; break;
+        case 5: s.pc = value & 0x1f; return SIM_PIO_JUMP;
+        case 6: s.isr = value; s.isr_count = 0; break;
+        case 7: s.osr = value; s.osr_count = 0; break;
+        default: break;
+        }
+        return SIM_PIO_NEXT;
+    }
+
+    case 6: // irq
+    {
+        uint flag = 1u << irq_index(field_b, sm_index);
+        bool clear = instruction & 0x40;
+        bool wait = instruction & 0x20;
+
+        if (clear)
+        {
+            block.irq_flags &= ~flag;
+            return SIM_PIO_NEXT;
+        }
+        if (!s.irq_waiting)
+        {
+            block.irq_flags |= flag;
+            if (!wait)
+                return SIM_PIO_NEXT;
+            s.irq_waiting = true;
+            return SIM_PIO_STALL;
+        }
+        if (block.irq_flags & flag)
+            return SIM_PIO_STALL;
+        s.irq_waiting = false;
+        return SIM_PIO_NEXT;
+    }
+
+    case 7: // set
+        switch (field_a)
+        {
+        case 0: write_latch(block.pin_values, c.set_base, c.set_count, field_b); break;
+        case 1: s.x = field_b; break;
+        case 2: s.y = field_b; break;
+        case 4: write_latch(block.pin_dirs, c.set_base, c.set_count, field_b); break;
+        default: break;
+        }
+        return SIM_PIO_NEXT;
+    }
+    return SIM_PIO_NEXT;
+}
+
+// Run one instruction, returns false if the state machine stalled
+static bool run_instruction(pio_sim_block& block, uint sm_index, uint16_t instruction, bool from_exec)
+{
+    sim_pio_sm& s = block.sm[sm_index];
+
+    if (from_exec)
+        s.exec_pending = false;
+
+    // Side set happens even when the instruction stalls
+    apply_sideset(block, s, instruction);
+    sim_pio_result result = execute(block, sm_index, instruction);
+    sync_pins(block);
+
+    if (result == SIM_PIO_STALL)
+    {
+        if (from_exec)
+        {
+            s.exec_pending = true;
+            s.exec_instruction = instruction;
+        }
+        return false;
+    }
+
+    // An executed instruction leaves the program counter alone unless it jumps
+    if (result == SIM_PIO_NEXT && !from_exec)
+        s.pc = (s.pc == s.config.wrap) ? s.config.wrap_target : (s.pc + 1) % PIO_INSTRUCTION_COUNT;
+
+    uint delay_bits = 5 - s.config.sideset_bit_count;
+    s.delay = ((instruction >> 8) & 0x1f) & ((1u << delay_bits) - 1);
+
+    block.stats.instructions++;
+    return true;
+}
+
+static uint32_t clock_divider(const sim_pio_sm& s)
+{
+    uint32_t div_int = s.config.clkdiv_int ? s.config.clkdiv_int : 65536;
+    return div_int * 256 + s.config.clkdiv_frac;
+}
+
+static bool step_sm(pio_sim_block& block, uint sm_index)
+{
+    sim_pio_sm& s = block.sm[sm_index];
+    if (!s.enabled)
+        return false;
+
+    // A divided state machine only moves on some cycles, it is still busy on the others
+    uint32_t divider = clock_divider(s);
+    s.clock_count += 256;
+    if (s.clock_count < divider)
+        return true;
+    s.clock_count -= divider;
+
+    if (s.delay)
+    {
+        s.delay--;
+        return true;
+    }
+
+    bool ran = s.exec_pending ? run_instruction(block, sm_index, s.exec_instruction, true)
+                              : run_instruction(block, sm_index, block.instructions[s.pc], false);
+
+    // A stalled state machine looks again on the next cycle it is stepped, stepping stops
+    // while everything is stalled so a divided one would otherwise never get its turn
+    if (!ran)
+        s.clock_count = divider - 256;
+    return ran;
+}
+
+static uint32_t raw_interrupts(const pio_sim_block& block)
+{
+    uint32_t raw = (uint32_t)(block.irq_flags & 0xf) << 8;
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+    {
+        const sim_pio_sm& s = block.sm[sm];
+        if (!s.rx.empty())
+            raw |= 1u << sm;
+        if (s.tx.size() < fifo_depth(s, true))
+            raw |= 1u << (sm + 4);
+    }
+    return raw;
+}
+
+// Whether one of a block's enabled sources is raised on a line with handlers
+static bool irq_raised(const pio_sim_block& block)
+{
+    for (uint line = 0; line < 2; line++)
+    {
+        const sim_irq_line& irq = sim_irq_lines[PIO0_IRQ_0 + block.index * 2 + line];
+        if (irq.enabled && !irq.handlers.empty() && (raw_interrupts(block) & block.irq_sources[line]))
+            return true;
+    }
+    return false;
+}
+
+// Enter the interrupt handlers of a block while one of its enabled sources is raised, once it
+// has been raised for the block's latency. waiting is set while one is raised but not yet due.
+static bool run_interrupts(pio_sim_block& block, bool& waiting)
+{
+    if (block.in_irq)
+        return false;
+
+    if (block.irq_latency_cycles)
+    {
+        if (!irq_raised(block))
+        {
+            block.irq_raised = false;
+            return false;
+        }
+        if (!block.irq_raised)
+        {
+            block.irq_raised = true;
+            block.irq_raised_at = block.clock;
+        }
+        if (block.clock - block.irq_raised_at < block.irq_latency_cycles)
+        {
+            waiting = true;
+            return false;
+        }
+    }
+
+    bool ran = false;
+    block.in_irq = true;
+    for (uint line = 0; line < 2; line++)
+    {
+        sim_irq_line& irq = sim_irq_lines[PIO0_IRQ_0 + block.index * 2 + line];
+        if (!irq.enabled || irq.handlers.empty())
+            continue;
+
+        // A handler that never clears its source would hang the simulation
+        for (uint guard = 0; guard < 1000 && (raw_interrupts(block) & block.irq_sources[line]); guard++)
+        {
+            for (irq_handler_t handler : irq.handlers)
+                handler();
+            block.stats.irq_calls++;
+            ran = true;
+        }
+    }
+    block.in_irq = false;
+
+    // The next source raised waits out the latency again
+    block.irq_raised = false;
+    return ran;
+}
+
+static void run(pio_sim_block& block, uint64_t cycles)
+{
+    if (block.device == nullptr || block.stepping)
+        return;
+
+    block.stepping = true;
+    sim_device_scope scope(block.device);
+
+    for (uint64_t cycle = 0; cycle < cycles; cycle++)
+    {
+        bool progress = sim_dma_service(&block);
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+            progress |= step_sm(block, sm);
+        block.stats.cycles++;
+
+        block.clock++;
+
+        bool waiting = false;
+        progress |= run_interrupts(block, waiting);
+
+        // Every state machine is stalled, nothing changes until a pin or the CPU does
+        if (!progress && !waiting)
+            break;
+    }
+
+    block.stepping = false;
+}
+
+static uint64_t cycles_at(uint64_t ns)
+{
+    return ns * (SIM_PIO_CLOCK_HZ / 1000000) / 1000;
+}
+
+static void sim_pio_time_hook(uint64_t now_ns)
+{
+    for (pio_sim_block& block : sim_pio_blocks)
+    {
+        if (block.device == nullptr)
+            continue;
+        uint64_t cycles = cycles_at(now_ns) - cycles_at(block.synced_ns);
+        block.clock = MAX(block.clock, cycles_at(block.synced_ns));
+        block.synced_ns = now_ns;
+        run(block, cycles);
+    }
+}
+
+static void sim_pio_edge(uint gpio, uint32_t events)
+{
+    (void)gpio;
+    (void)events;
+    for (pio_sim_block& block : sim_pio_blocks)
+    {
+        if (block.device == sim_device_current())
+            run(block, SIM_PIO_EDGE_CYCLES);
+    }
+}
+
+static pio_sim_block* as_block(PIO pio)
+{
+    return static_cast<pio_sim_block*>(pio);
+}
+
+static pio_sim_block& get_block(PIO pio)
+{
+    assert(as_block(pio)->device != nullptr && "attach the PIO to a device with sim_pio_attach first");
+    return *as_block(pio);
+}
+
+
+PIO pio_sim_get(uint index)
+{
+    assert(index < NUM_PIOS);
+    sim_pio_blocks[index].index = index;
+    return &sim_pio_blocks[index];
+}
+
+uint pio_get_index(PIO pio)
+{
+    return as_block(pio)->index;
+}
+
+static int find_offset(PIO pio, const pio_program_t* program)
+{
+    uint32_t mask = (1u << program->length) - 1;
+    if (program->origin >= 0)
+        return (as_block(pio)->used_instructions & (mask << program->origin)) ? -1 : program->origin;
+
+    // Highest free space first, like the sdk
+    for (int offset = PIO_INSTRUCTION_COUNT - program->length; offset >= 0; offset--)
+    {
+        if (!(as_block(pio)->used_instructions & (mask << offset)))
+            return offset;
+    }
+    return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program)
+{
+    return find_offset(pio, program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program)
+{
+    int offset = find_offset(pio, program);
+    assert(offset >= 0 && "no room for the program");
+
+    for (uint i = 0; i < program->length; i++)
+    {
+        uint16_t instruction = program->instructions[i];
+        // Jump targets are relative to the start of the program
+        if ((instruction >> 13) == 0)
+            instruction += offset;
+        as_block(pio)->instructions[offset + i] = instruction;
+    }
+    as_block(pio)->used_instructions |= ((1u << program->length) - 1) << offset;
+    return offset;
+}
+
+void pio_sm_claim(PIO pio, uint sm)
+{
+    assert(!as_block(pio)->sm[sm].claimed);
+    as_block(pio)->sm[sm].claimed = true;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm)
+{
+    as_block(pio)->sm[sm].claimed = false;
+}
+
+bool pio_sm_is_claimed(PIO pio, uint sm)
+{
+    return as_block(pio)->sm[sm].claimed;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+    {
+        if (!as_block(pio)->sm[sm].claimed)
+        {
+            as_block(pio)->sm[sm].claimed = true;
+            return sm;
+        }
+    }
+    assert(!required && "no free state machine");
+    (void)required;
+    return -1;
+}
+
+void pio_gpio_init(PIO pio, uint pin)
+{
+    pio_sim_block& block = get_block(pio);
+    {
+        sim_device_scope scope(block.device);
+        hal_gpio_init(pin);
+    }
+    block.gpio_mask |= 1u << pin;
+    block.device_values &= ~(1u << pin);
+    block.device_dirs &= ~(1u << pin);
+    sync_pins(block);
+}
+
+void pio_sm_set_config(PIO pio, uint sm, const pio_sm_config* config)
+{
+    as_block(pio)->sm[sm].config = *config;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config)
+{
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_set_config(pio, sm, config);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    as_block(pio)->sm[sm].pc = initial_pc;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    as_block(pio)->sm[sm].enabled = enabled;
+}
+
+void pio_sm_restart(PIO pio, uint sm)
+{
+    sim_pio_sm& s = as_block(pio)->sm[sm];
+    s.isr = 0;
+    s.isr_count = 0;
+    s.osr_count = 0;
+    s.delay = 0;
+    s.clock_count = 0;
+    s.irq_waiting = false;
+    s.exec_pending = false;
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm)
+{
+    as_block(pio)->sm[sm].tx.clear();
+    as_block(pio)->sm[sm].rx.clear();
+}
+
+void pio_sm_exec(PIO pio, uint sm, uint instr)
+{
+    sim_pio_sm& s = as_block(pio)->sm[sm];
+    s.exec_pending = true;
+    s.exec_instruction = instr;
+
+    // A disabled state machine runs it straight away
+    if (!s.enabled)
+    {
+        sim_device_scope scope(get_block(pio).device);
+        run_instruction(*as_block(pio), sm, instr, true);
+        s.delay = 0;
+    }
+}
+
+uint8_t pio_sm_get_pc(PIO pio, uint sm)
+{
+    return as_block(pio)->sm[sm].pc;
+}
+
+void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask)
+{
+    (void)sm;
+    pio_sim_block& block = *as_block(pio);
+    block.pin_values = (block.pin_values & ~pin_mask) | (pin_values & pin_mask);
+    if (block.device)
+        sync_pins(block);
+}
+
+void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask)
+{
+    (void)sm;
+    pio_sim_block& block = *as_block(pio);
+    block.pin_dirs = (block.pin_dirs & ~pin_mask) | (pin_dirs & pin_mask);
+    if (block.device)
+        sync_pins(block);
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm)
+{
+    return as_block(pio)->sm[sm].rx.empty();
+}
+
+bool pio_sm_is_rx_fifo_full(PIO pio, uint sm)
+{
+    const sim_pio_sm& s = as_block(pio)->sm[sm];
+    return s.rx.size() >= fifo_depth(s, false);
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm)
+{
+    return as_block(pio)->sm[sm].tx.empty();
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm)
+{
+    const sim_pio_sm& s = as_block(pio)->sm[sm];
+    return s.tx.size() >= fifo_depth(s, true);
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data)
+{
+    // Like the hardware a write to a full FIFO is lost
+    if (!pio_sm_is_tx_fifo_full(pio, sm))
+        as_block(pio)->sm[sm].tx.push_back(data);
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm)
+{
+    sim_pio_sm& s = as_block(pio)->sm[sm];
+    if (s.rx.empty())
+        return 0xffffffff;
+    uint32_t data = s.rx.front();
+    s.rx.pop_front();
+    return data;
+}
+
+bool pio_interrupt_get(PIO pio, uint pio_interrupt_num)
+{
+    return (as_block(pio)->irq_flags >> pio_interrupt_num) & 1;
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num)
+{
+    as_block(pio)->irq_flags &= ~(1u << pio_interrupt_num);
+}
+
+void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled)
+{
+    if (enabled)
+        as_block(pio)->irq_sources[0] |= 1u << source;
+    else
+        as_block(pio)->irq_sources[0] &= ~(1u << source);
+}
+
+void pio_set_irq1_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled)
+{
+    if (enabled)
+        as_block(pio)->irq_sources[1] |= 1u << source;
+    else
+        as_block(pio)->irq_sources[1] &= ~(1u << source);
+}
+
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void)order_priority;
+    sim_irq_lines[num].handlers.push_back(handler);
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    assert(sim_irq_lines[num].handlers.empty());
+    sim_irq_lines[num].handlers.push_back(handler);
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    sim_irq_lines[num].enabled = enabled;
+}
+
+
+void sim_pio_attach(PIO pio, sim_device* device)
+{
+    as_block(pio)->device = device;
+    as_block(pio)->synced_ns = sim_time_ns();
+
+    // Step the block whenever one of its pins changes
+    sim_device_scope scope(device);
+    hal_gpio_set_irq_callback(&sim_pio_edge);
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        hal_gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    hal_gpio_irq_bank_enable();
+
+    if (!sim_pio_hooked)
+    {
+        sim_add_time_hook(&sim_pio_time_hook);
+        sim_pio_hooked = true;
+    }
+}
+
+void sim_pio_set_irq_latency_ns(PIO pio, uint64_t ns)
+{
+    as_block(pio)->irq_latency_cycles = cycles_at(ns);
+}
+
+sim_pio_stats sim_pio_get_stats(PIO pio)
+{
+    return as_block(pio)->stats;
+}
+
+void sim_pio_step(PIO pio, uint64_t cycles)
+{
+    run(get_block(pio), cycles);
+}
+
+void sim_pio_reset()
+{
+    for (uint i = 0; i < NUM_PIOS; i++)
+    {
+        sim_pio_blocks[i] = pio_sim_block();
+        sim_pio_blocks[i].index = i;
+    }
+    for (sim_irq_line& line : sim_irq_lines)
+        line = sim_irq_line();
+    sim_pio_hooked = false;
+    sim_dma_reset();
+}
@@ -0,0 +1,52 @@
+#ifndef PIO_SIM_H
+#define PIO_SIM_H
+
+/*
+    Cycle stepped emulator of the two RP2040 PIO blocks for the host simulation.
+
+    A PIO block is attached to a sim_device from io_hal_sim.h, its pins are that device's pins so
+    the state machines see and drive the same simulated bus as the GPIO engines. The blocks run
+    at a fixed clock whenever simulated time moves forward, and for a few extra cycles after
+    every edge on the device's pins. That stands in for the handful of cycles between two
+    gpio_put calls on real hardware, without it a master setting SDA and SCL back to back would
+    look to the PIO as if both lines changed at once.
+
+    PIO interrupt handlers registered through hardware/irq.h run the moment an enabled source is
+    raised, the CPU is infinitely fast just like the GPIO handlers in io_hal_sim, unless the block
+    is given a latency to stand in for a CPU that is busy elsewhere. DMA channels
+    from hardware/dma.h paced by a block's FIFOs are moved on with the block's cycles.
+*/
+
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "io_hal.h"
+
+#define SIM_PIO_CLOCK_HZ        125000000ull
+#define SIM_PIO_EDGE_CYCLES     8
+
+// Counters for one PIO block
+struct sim_pio_stats {
+    uint64_t cycles = 0;            // cycles actually stepped, stalled stretches are skipped
+    uint64_t instructions = 0;      // instructions completed by all state machines
+    uint64_t irq_calls = 0;         // times the interrupt handlers were entered
+};
+
+/// @brief give a PIO block the pins of a simulated device, this must be done before the block is used
+void sim_pio_attach(PIO pio, sim_device* device);
+
+sim_pio_stats sim_pio_get_stats(PIO pio);
+
+// Enter a block's interrupt handlers only once a source has been raised for this long, 0 for at once
+void sim_pio_set_irq_latency_ns(PIO pio, uint64_t ns);
+
+// Run a block for a number of cycles without moving simulated time
+void sim_pio_step(PIO pio, uint64_t cycles);
+
+// Clear both blocks and every DMA channel back to power on, sim_reset does not do this
+void sim_pio_reset();
+
+// Make one transfer on each DMA channel a block's FIFOs are ready for, true if any moved
+bool sim_dma_service(PIO pio);
+void sim_dma_reset();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+#include <stdio.h>
+
+/*
+    Checks shared by the host simulation tests. A failed check prints where it is and is counted,
+    the test carries on and main returns 1 at the end if any failed.
+*/
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); failures++; } } while (0)
+
+#endif
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+
+/*
+    Runs write transfers from the software master to the software slave with the listener sniffing,
+    then reports how many bus bits the simulator got through per second of host time and how long
+    each device's interrupt handler took per edge.
+
+    usage: sim_i2c_bench [transfers]
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static volatile uint8_t received;
+static uint64_t sniffed = 0;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        received = data;
+}
+
+static void message_handler(uint32_t message)
+{
+    (void)message;
+    sniffed++;
+}
+
+static void print_irq_stats(const char* name, const sim_device* device)
+{
+    sim_irq_stats stats = sim_device_irq_stats(device);
+    printf("%-10s %10llu edges  %8.1f ns/edge  %8llu ns max\n", name,
+           (unsigned long long)stats.calls,
+           stats.calls ? double(stats.total_ns) / double(stats.calls) : 0.0,
+           (unsigned long long)stats.max_ns);
+}
+
+int main(int argc, char** argv)
+{
+    uint transfers = (argc > 1) ? atoi(argv[1]) : 100000;
+
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* slave_device    = sim_device_create("slave");
+    sim_device* listener_device = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, &message_handler);
+        init_interrupts(listener);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 1000000);
+
+    sim_device_reset_irq_stats(slave_device);
+    sim_device_reset_irq_stats(listener_device);
+
+    auto start = std::chrono::steady_clock::now();
+
+    uint errors = 0;
+    for (uint i = 0; i < transfers; i++)
+    {
+        uint8_t number = i;
+        i2c.write_bytes(I2C_ADDRESS, &number, 1);
+        if (received != number)
+            errors++;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Start bit, address byte and data byte each with an acknowledge
+    double bits = double(transfers) * 19;
+
+    printf("%u transfers in %.3f s host time, %u errors\n", transfers, seconds, errors);
+    printf("%.2f M simulated bits per second\n", bits / seconds / 1e6);
+    print_irq_stats("slave", slave_device);
+    print_irq_stats("listener", listener_device);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+#include "sim_check.h"
+
+/*
+    Master, slave and listener running on three simulated devices wired onto one bus.
+    The master writes a number to the slave, reads back the slave's reply and checks both ends
+    saw the same bytes, the listener must report every byte it sniffed.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static uint8_t received;
+static uint starts = 0;
+static uint stops = 0;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        received = data;
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = received + 1;
+        break;
+
+    case I2C_SLAVE_STOP:
+        stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static std::vector<uint32_t> sniffed;
+
+static void message_handler(uint32_t message)
+{
+    sniffed.push_back(message);
+}
+
+int main()
+{
+    // Set SIM_TRACE to print every bus edge
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* slave_device    = sim_device_create("slave");
+    sim_device* listener_device = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, &message_handler);
+        init_interrupts(listener);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 100000);
+
+    // The master only ends a read with a start, not a stop, so the slave is still transmitting
+    // once a read finishes. Do every write first and a single read at the end.
+    for (uint i = 0; i < 100; i++)
+    {
+        uint8_t number = i * 7;
+        i2c.write_bytes(I2C_ADDRESS, &number, 1);
+        CHECK(received == number);
+    }
+
+    uint8_t read_number = 0;
+    i2c.read_bytes(I2C_ADDRESS, &read_number, 1);
+    CHECK(read_number == uint8_t(received + 1));
+
+    // The master starts with both lines released, so every start is a transfer
+    CHECK(starts == 101);
+
+    // Every transfer is an address byte and a data byte
+    CHECK(sniffed.size() == 202);
+    for (uint32_t message : sniffed)
+        CHECK((message >> 24) == 0xF0);
+
+    printf("%u transfers, %zu sniffed messages, %llu us simulated, %llu contentions\n",
+           starts, sniffed.size(), (unsigned long long)hal_time_us_64(), (unsigned long long)sim_contention_count());
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
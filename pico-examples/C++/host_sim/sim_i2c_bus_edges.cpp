@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_bus_edges.h"
+#include "sim_check.h"
+
+/*
+    Checks i2c_order_edges puts edges latched together back in bus order, on its own and for a
+    raw handler on a simulated device whose interrupt was held back while the bus moved.
+*/
+
+#define SDA_PIN     4u
+#define SCL_PIN     5u
+
+#define SDA_NET     0u
+#define SCL_NET     1u
+
+#define RISE        GPIO_IRQ_EDGE_RISE
+#define FALL        GPIO_IRQ_EDGE_FALL
+
+static bool same(const i2c_bus_edge& edge, bool scl, uint32_t event, bool sda_level, bool scl_level)
+{
+    return edge.scl == scl && edge.event == event && edge.sda_level == sda_level && edge.scl_level == scl_level;
+}
+
+static void check_ordering()
+{
+    i2c_bus_edge edges[I2C_BUS_EDGES_MAX];
+
+    // Clock falls, then the next data bit is set up
+    CHECK(i2c_order_edges(RISE, FALL, true, false, edges) == 2);
+    CHECK(same(edges[0], true, FALL, false, false));
+    CHECK(same(edges[1], false, RISE, true, false));
+
+    // Data set up, then the clock rises to sample it
+    CHECK(i2c_order_edges(FALL, RISE, false, true, edges) == 2);
+    CHECK(same(edges[0], false, FALL, false, false));
+    CHECK(same(edges[1], true, RISE, false, true));
+
+    // A whole clock pulse after the data changed
+    CHECK(i2c_order_edges(FALL, RISE | FALL, false, false, edges) == 3);
+    CHECK(same(edges[0], false, FALL, false, false));
+    CHECK(same(edges[1], true, RISE, false, true));
+    CHECK(same(edges[2], true, FALL, false, false));
+
+    // Clock low, data changed, clock high again
+    CHECK(i2c_order_edges(RISE, RISE | FALL, true, true, edges) == 3);
+    CHECK(same(edges[0], true, FALL, false, false));
+    CHECK(same(edges[1], false, RISE, true, false));
+    CHECK(same(edges[2], true, RISE, true, true));
+
+    // A start on its own keeps the clock level
+    CHECK(i2c_order_edges(FALL, 0, false, true, edges) == 1);
+    CHECK(same(edges[0], false, FALL, false, true));
+
+    CHECK(i2c_order_edges(0, 0, true, true, edges) == 0);
+}
+
+static i2c_bus_edge seen[16];
+static uint seen_count = 0;
+static uint raw_entries = 0;
+
+static void raw_handler()
+{
+    raw_entries++;
+
+    uint32_t sda_events = hal_gpio_get_irq_events(SDA_PIN);
+    uint32_t scl_events = hal_gpio_get_irq_events(SCL_PIN);
+    hal_gpio_acknowledge_irq(SDA_PIN, sda_events);
+    hal_gpio_acknowledge_irq(SCL_PIN, scl_events);
+
+    uint32_t levels = hal_gpio_get_all();
+    seen_count += i2c_order_edges(sda_events, scl_events, (levels >> SDA_PIN) & 1, (levels >> SCL_PIN) & 1, &seen[seen_count]);
+}
+
+static void check_held_interrupt()
+{
+    sim_device* master = sim_device_create("master");
+    sim_device* watcher = sim_device_create("watcher");
+
+    for (sim_device* device : {master, watcher})
+    {
+        sim_device_wire(device, SDA_PIN, SDA_NET);
+        sim_device_wire(device, SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(watcher);
+        hal_gpio_add_raw_irq_handler_masked((1u << SDA_PIN) | (1u << SCL_PIN), &raw_handler);
+        hal_gpio_set_irq_enabled(SDA_PIN, RISE | FALL, true);
+        hal_gpio_set_irq_enabled(SCL_PIN, RISE | FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    sim_device_scope scope(master);
+    hal_gpio_init(SDA_PIN);
+    hal_gpio_init(SCL_PIN);
+    hal_gpio_set_dir(SCL_PIN, GPIO_OUT);
+    hal_gpio_set_dir(SDA_PIN, GPIO_OUT);
+
+    // Clock low then data low, seen straight away
+    CHECK(raw_entries == 2);
+    seen_count = 0;
+    raw_entries = 0;
+
+    // Data released then a full clock pulse while the watcher is late
+    sim_device_hold_irq(watcher, true);
+    hal_gpio_set_dir(SDA_PIN, GPIO_IN);
+    hal_gpio_set_dir(SCL_PIN, GPIO_IN);
+    hal_gpio_set_dir(SCL_PIN, GPIO_OUT);
+    sim_device_hold_irq(watcher, false);
+
+    CHECK(raw_entries == 1);
+    CHECK(seen_count == 3);
+    CHECK(same(seen[0], false, RISE, true, false));
+    CHECK(same(seen[1], true, RISE, true, true));
+    CHECK(same(seen[2], true, FALL, true, false));
+}
+
+int main()
+{
+    check_ordering();
+    check_held_interrupt();
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+#include "i2c_listener_stream.h"
+#include "sim_check.h"
+
+/*
+    The listener's capture stream decoded on the host must give back every event the listener
+    saw, with the same time to the microsecond. Runs writes of 1 to 4 bytes, a transfer to an address
+    nobody answers and a long idle gap, then checks the size against the old 4 byte messages and
+    that a reader starting part way through the stream picks it up at the next SYNC record.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define DRAIN_NS        1000000ull
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint8_t MISSING_ADDRESS = 0x17;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    (void)event;
+}
+
+// Every event as the listener reported it, and the stream it was encoded into
+static i2c_listener_stream stream;
+static std::vector<i2c_capture_record> expected;
+static std::vector<uint8_t> captured;
+
+static void capture_event(i2c_capture_record_type event, uint8_t data, bool acknowledged)
+{
+    uint64_t now_us = hal_time_us_64();
+    stream.write_event(event, now_us, data, acknowledged);
+
+    bool has_byte = (event == I2C_CAPTURE_ADDRESS || event == I2C_CAPTURE_DATA);
+    expected.push_back({event, now_us, has_byte ? data : (uint8_t)0, has_byte && acknowledged, 0});
+}
+
+static void drain()
+{
+    uint8_t bytes[I2C_LISTENER_PACKET_SIZE];
+    while (uint32_t length = stream.pop(bytes, sizeof(bytes)))
+        captured.insert(captured.end(), bytes, bytes + length);
+}
+
+static uint64_t next_drain_ns = DRAIN_NS;
+
+static void drain_time_hook(uint64_t now_ns)
+{
+    if (now_ns >= next_drain_ns)
+    {
+        drain();
+        next_drain_ns = now_ns + DRAIN_NS;
+    }
+}
+
+static bool same(const i2c_capture_record& a, const i2c_capture_record& b)
+{
+    return a.type == b.type && a.time_us == b.time_us && a.value == b.value && a.acknowledged == b.acknowledged;
+}
+
+static void check_encoding()
+{
+    // Deltas either side of the inline limit and a large overflow count survive the round trip
+    i2c_capture_encoder encoder;
+    std::vector<uint8_t> bytes;
+    uint64_t times[] = {5, 5 + I2C_CAPTURE_DELTA_INLINE_MAX, 6 + 2 * I2C_CAPTURE_DELTA_INLINE_MAX, 1ull << 40};
+
+    for (uint64_t time : times)
+    {
+        uint8_t record[I2C_CAPTURE_MAX_RECORD];
+        uint length = encoder.encode(I2C_CAPTURE_DATA, time, 0xA5, true, record);
+        bytes.insert(bytes.end(), record, record + length);
+        encoder.written(time);
+    }
+    uint8_t record[I2C_CAPTURE_MAX_RECORD];
+    uint length = encoder.encode(I2C_CAPTURE_OVERFLOW, times[3], 0x12345678, false, record);
+    bytes.insert(bytes.end(), record, record + length);
+
+    std::vector<i2c_capture_record> decoded;
+    i2c_capture_decoder decoder;
+    decoder.feed(bytes.data(), bytes.size(), [&](const i2c_capture_record& r) { decoded.push_back(r); });
+
+    CHECK(decoded.size() == 5);
+    for (uint i = 0; i < 4 && i < decoded.size(); i++)
+    {
+        CHECK(decoded[i].type == I2C_CAPTURE_DATA);
+        CHECK(decoded[i].time_us == times[i]);
+        CHECK(decoded[i].value == 0xA5);
+        CHECK(decoded[i].acknowledged);
+    }
+    if (decoded.size() == 5)
+    {
+        CHECK(decoded[4].type == I2C_CAPTURE_OVERFLOW);
+        CHECK(decoded[4].dropped == 0x12345678);
+    }
+    CHECK(decoder.get_skipped() == 0);
+}
+
+int main()
+{
+    check_encoding();
+
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* slave_device    = sim_device_create("slave");
+    sim_device* listener_device = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, nullptr);
+        listener.set_event_handler(&capture_event);
+        init_interrupts(listener);
+    }
+
+    sim_add_time_hook(&drain_time_hook);
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 100000);
+
+    uint transfers = 300;
+    for (uint i = 0; i < transfers; i++)
+    {
+        uint8_t data[4] = {(uint8_t)i, (uint8_t)(i + 1), (uint8_t)(i + 2), (uint8_t)(i + 3)};
+        i2c.write_bytes(I2C_ADDRESS, data, 1 + i % 4);
+
+        if (i == transfers / 2)
+        {
+            i2c.write_bytes(MISSING_ADDRESS, data, 1);
+            hal_sleep_ms(20);
+        }
+    }
+    hal_sleep_ms(2);
+    drain();
+
+    std::vector<i2c_capture_record> decoded;
+    i2c_capture_decoder decoder;
+    decoder.feed(captured.data(), captured.size(), [&](const i2c_capture_record& r) { decoded.push_back(r); });
+
+    CHECK(stream.get_dropped() == 0);
+    CHECK(decoder.get_skipped() == 0);
+    CHECK(decoded.size() == expected.size());
+
+    uint mismatches = 0;
+    uint bus_bytes = 0;
+    uint conditions = 0;
+    uint missing_addresses = 0;
+    for (size_t i = 0; i < decoded.size() && i < expected.size(); i++)
+    {
+        if (!same(decoded[i], expected[i]))
+            mismatches++;
+
+        if (decoded[i].type == I2C_CAPTURE_ADDRESS || decoded[i].type == I2C_CAPTURE_DATA)
+            bus_bytes++;
+        else if (decoded[i].type != I2C_CAPTURE_SYNC && decoded[i].type != I2C_CAPTURE_OVERFLOW)
+            conditions++;
+
+        if (decoded[i].type == I2C_CAPTURE_ADDRESS)
+        {
+            uint8_t address = decoded[i].value >> 1;
+
+            CHECK(decoded[i].acknowledged == (address == I2C_ADDRESS));
+            missing_addresses += (address == MISSING_ADDRESS);
+        }
+    }
+    CHECK(mismatches == 0);
+    // The master addresses a missing device once and gives up
+    CHECK(missing_addresses == 1);
+    CHECK(decoded.size() && decoded[0].type == I2C_CAPTURE_START);
+
+    // The old format spent 4 bytes on every address and data byte and had no START or STOP, leave
+    // out the 2 bytes of each condition record
+    double bytes_per_bus_byte = double(captured.size() - 2 * conditions) / bus_bytes;
+    CHECK(bytes_per_bus_byte < 4.0);
+    printf("%zu records, %u bus bytes in %zu bytes, %.2f bytes per bus byte against 4.00\n",
+           decoded.size(), bus_bytes, captured.size(), bytes_per_bus_byte);
+
+    // A reader starting part way through skips to the next SYNC and agrees from there on
+    std::vector<i2c_capture_record> late;
+    i2c_capture_decoder late_decoder;
+    size_t join = captured.size() / 3;
+    late_decoder.feed(captured.data() + join, captured.size() - join, [&](const i2c_capture_record& r) { late.push_back(r); });
+
+    CHECK(late_decoder.get_skipped() > 0);
+    CHECK(late.size() > 0 && late.size() < expected.size());
+    size_t offset = expected.size() - late.size();
+    uint late_mismatches = 0;
+    for (size_t i = 0; i < late.size(); i++)
+    {
+        if (!same(late[i], expected[offset + i]))
+            late_mismatches++;
+    }
+    CHECK(late_mismatches == 0);
+    printf("joined at byte %zu, skipped %llu bytes and resumed %zu records later\n",
+           join, (unsigned long long)late_decoder.get_skipped(), offset);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
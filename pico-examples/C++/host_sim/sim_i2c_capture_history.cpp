@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "i2c_capture_history.h"
+#include "sim_check.h"
+
+/*
+    The history ring behind the arcade button module's replay. A ring that has not filled must
+    give back every record in order, a full one only the newest SIZE - 1, records the interrupt
+    overwrites while a replay is reading must come out as one OVERFLOW record with their count
+    instead of torn or repeated ones, and a replay sent in the capture format must decode to the
+    same records.
+*/
+
+#define HISTORY_SIZE    64
+
+// Record n of a made up bus: START, an address, data and a STOP over and over, 7 us apart
+static i2c_capture_record made_up(uint32_t n)
+{
+    static const i2c_capture_record_type types[] = {
+        I2C_CAPTURE_START, I2C_CAPTURE_ADDRESS, I2C_CAPTURE_DATA, I2C_CAPTURE_DATA, I2C_CAPTURE_STOP,
+    };
+    i2c_capture_record_type type = types[n % 5];
+    bool byte = type == I2C_CAPTURE_ADDRESS || type == I2C_CAPTURE_DATA;
+    return {type, 1000 + 7ull * n, byte ? (uint8_t)(n * 13) : (uint8_t)0, byte && (n % 3) != 0, 0};
+}
+
+static void record(i2c_capture_history<HISTORY_SIZE>& history, uint32_t n)
+{
+    i2c_capture_record r = made_up(n);
+    history.record(r.type, r.time_us, r.value, r.acknowledged);
+}
+
+static bool same(const i2c_capture_record& a, const i2c_capture_record& b)
+{
+    return a.type == b.type && a.time_us == b.time_us && a.value == b.value
+        && a.acknowledged == b.acknowledged && a.dropped == b.dropped;
+}
+
+// Whether the replay is made_up(first) to made_up(first + count - 1)
+static bool replays(const std::vector<i2c_capture_record>& replayed, uint32_t first, uint32_t count)
+{
+    if (replayed.size() != count)
+        return false;
+    for (uint32_t i = 0; i < count; i++)
+        if (!same(replayed[i], made_up(first + i)))
+            return false;
+    return true;
+}
+
+int main()
+{
+    static i2c_capture_history<HISTORY_SIZE> history;
+    std::vector<i2c_capture_record> replayed;
+    auto collect = [&](const i2c_capture_record& r) { replayed.push_back(r); };
+
+    // Part full, everything in order
+    CHECK(history.replay(collect) == 0);
+    for (uint32_t n = 0; n < 10; n++)
+        record(history, n);
+    CHECK(history.size() == 10);
+    CHECK(history.replay(collect) == 10);
+    CHECK(replays(replayed, 0, 10));
+
+    // Wrapped several times, only the newest
+    for (uint32_t n = 10; n < 3 * HISTORY_SIZE + 5; n++)
+        record(history, n);
+    replayed.clear();
+    CHECK(history.size() == HISTORY_SIZE - 1);
+    CHECK(history.replay(collect) == HISTORY_SIZE - 1);
+    CHECK(replays(replayed, 2 * HISTORY_SIZE + 6, HISTORY_SIZE - 1));
+
+    // Cleared, then only what came after
+    history.clear();
+    CHECK(history.size() == 0);
+    uint32_t next = 3 * HISTORY_SIZE + 5;
+    for (uint32_t n = next; n < next + 4; n++)
+        record(history, n);
+    replayed.clear();
+    CHECK(history.replay(collect) == 4);
+    CHECK(replays(replayed, next, 4));
+    next += 4;
+
+    // The interrupt records 20 while the replay is at its fifth record, the slots it overwrote are
+    // reported lost and the replay carries on with the first one still held
+    for (uint32_t n = next; n < next + HISTORY_SIZE - 1; n++)
+        record(history, n);
+    uint32_t oldest = next;
+    next += HISTORY_SIZE - 1;
+
+    replayed.clear();
+    uint32_t count = history.replay([&](const i2c_capture_record& r)
+    {
+        replayed.push_back(r);
+        if (replayed.size() == 5)
+            for (uint32_t i = 0; i < 20; i++)
+                record(history, next++);
+    });
+
+    CHECK(count == HISTORY_SIZE - 1 - 15);
+    CHECK(replayed.size() == count + 1);
+    if (replayed.size() == count + 1)
+    {
+        bool before = true;
+        for (uint32_t i = 0; i < 5; i++)
+            before &= same(replayed[i], made_up(oldest + i));
+        CHECK(before);
+
+        // The 20 overwritten were the oldest, 5 of them had been read already
+        const i2c_capture_record& overflow = replayed[5];
+        CHECK(overflow.type == I2C_CAPTURE_OVERFLOW);
+        CHECK(overflow.dropped == 15);
+        CHECK(overflow.time_us == made_up(oldest + 20).time_us);
+
+        bool after = true;
+        for (uint32_t i = 6; i < replayed.size(); i++)
+            after &= same(replayed[i], made_up(oldest + 20 + (i - 6)));
+        CHECK(after);
+    }
+
+    // Sent in the capture format, decoded back
+    i2c_capture_encoder encoder;
+    std::vector<uint8_t> stream;
+    replayed.clear();
+    history.replay([&](const i2c_capture_record& r)
+    {
+        replayed.push_back(r);
+        uint8_t bytes[I2C_CAPTURE_MAX_RECORD];
+        uint32_t length = encoder.encode(r.type, r.time_us, r.value, r.acknowledged, bytes);
+        stream.insert(stream.end(), bytes, bytes + length);
+        encoder.written(r.time_us);
+    });
+
+    i2c_capture_decoder decoder;
+    std::vector<i2c_capture_record> decoded;
+    decoder.feed(stream.data(), stream.size(), [&](const i2c_capture_record& r) { decoded.push_back(r); });
+    CHECK(decoded.size() == replayed.size());
+    bool decoded_same = decoded.size() == replayed.size();
+    for (size_t i = 0; decoded_same && i < decoded.size(); i++)
+        decoded_same &= same(decoded[i], replayed[i]);
+    CHECK(decoded_same);
+
+    printf("%u records held, %zu bytes replayed in the capture format\n", history.size(), stream.size());
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <vector>
+
+#include "i2c_capture_format.h"
+#include "i2c_capture_host.h"
+#include "sim_check.h"
+
+/*
+    The capture daemon's library against a pty standing in for the listener's tty. The stream is
+    written in chunks that ignore record boundaries, starts with noise and is damaged part way
+    through. Every record must reach the capture file the same as decoding the bytes in one go,
+    the damage costs the records up to the next SYNC only, and a second process mapping the file
+    sees the same entries. Then a second process keeps reading the newest entries while this one
+    stores batches several times the capacity, none of what it is given may be torn.
+*/
+
+#define CAPACITY    1024
+#define EVENTS      3000
+
+#define CONTENDED_BATCH     (4 * CAPACITY)
+#define CONTENDED_BATCHES   50
+
+static bool same(const i2c_capture_entry& entry, const i2c_capture_record& record)
+{
+    return entry.type == record.type && entry.time_us == record.time_us && entry.value == record.value &&
+           entry.acknowledged == record.acknowledged && entry.dropped == record.dropped;
+}
+
+int main()
+{
+    // What a listener would send: transfers of an address and three data bytes, then an overflow
+    i2c_capture_encoder encoder;
+    std::vector<uint8_t> stream = {'n', 'o', 'i', 's', 'e', 0x00, 'I'};
+    std::vector<i2c_capture_record> events;
+    uint64_t time_us = 1000;
+
+    auto add = [&](i2c_capture_record_type type, uint32_t value, bool acknowledged) {
+        uint8_t bytes[I2C_CAPTURE_MAX_RECORD];
+        uint32_t length = encoder.encode(type, time_us, value, acknowledged, bytes);
+        stream.insert(stream.end(), bytes, bytes + length);
+        encoder.written(time_us);
+
+        bool has_byte = (type == I2C_CAPTURE_ADDRESS || type == I2C_CAPTURE_DATA);
+        events.push_back({type, time_us, has_byte ? (uint8_t)value : (uint8_t)0, has_byte && acknowledged,
+                          (type == I2C_CAPTURE_OVERFLOW) ? value : 0});
+        time_us += 90 + (events.size() % 7) * 1000;
+    };
+
+    while (events.size() < EVENTS - 1)
+    {
+        add(events.empty() ? I2C_CAPTURE_START : I2C_CAPTURE_RESTART, 0, false);
+        add(I2C_CAPTURE_ADDRESS, 0x42 << 1, true);
+        for (uint32_t i = 0; i < 3; i++)
+            add(I2C_CAPTURE_DATA, events.size(), i != 2);
+    }
+    add(I2C_CAPTURE_OVERFLOW, 77, false);
+
+    // Damage a stretch in the middle, records there are lost up to the next SYNC
+    size_t damage = stream.size() / 2;
+    for (size_t i = damage; i < damage + 5; i++)
+        stream[i] = 0xFF;
+
+    std::vector<i2c_capture_record> reference;
+    i2c_capture_decoder decoder;
+    decoder.feed(stream.data(), stream.size(), [&](const i2c_capture_record& record) { reference.push_back(record); });
+
+    // A device end and a tty end
+    int device = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(device >= 0 && grantpt(device) == 0 && unlockpt(device) == 0);
+
+    char capture_path[] = "/tmp/i2c_capture_XXXXXX";
+    int temporary = mkstemp(capture_path);
+    CHECK(temporary >= 0);
+    close(temporary);
+
+    i2c_capture* capture = i2c_capture_open(ptsname(device), capture_path, CAPACITY);
+    CHECK(capture != nullptr);
+    if (capture == nullptr)
+        return 1;
+
+    // Odd sized writes, each read back as soon as it arrives
+    size_t written = 0;
+    size_t chunk = 1;
+    while (written < stream.size())
+    {
+        size_t length = (chunk < stream.size() - written) ? chunk : stream.size() - written;
+        CHECK(write(device, &stream[written], length) == (ssize_t)length);
+        written += length;
+        chunk = chunk % 97 + 13;
+
+        while (i2c_capture_poll(capture, 0) > 0)
+            ;
+    }
+    for (int i = 0; i < 10 && i2c_capture_count(capture) < reference.size(); i++)
+        i2c_capture_poll(capture, 10);
+
+    CHECK(i2c_capture_count(capture) == reference.size());
+    CHECK(reference.size() < events.size());
+    CHECK(i2c_capture_skipped(capture) == decoder.get_skipped());
+    CHECK(i2c_capture_skipped(capture) > 5);
+    CHECK(i2c_capture_dropped(capture) == 77);
+
+    // Only the newest CAPACITY entries are kept
+    std::vector<i2c_capture_entry> entries(CAPACITY);
+    uint64_t count = i2c_capture_count(capture);
+    CHECK(i2c_capture_read(capture, count - CAPACITY - 1, entries.data(), CAPACITY) == 0);
+    CHECK(i2c_capture_read(capture, count - CAPACITY, entries.data(), CAPACITY) == CAPACITY);
+
+    uint mismatches = 0;
+    for (uint i = 0; i < CAPACITY; i++)
+    {
+        if (!same(entries[i], reference[reference.size() - CAPACITY + i]))
+            mismatches++;
+    }
+    CHECK(mismatches == 0);
+
+    // Recovered after the damage, the last records are exactly the ones sent
+    CHECK(same(entries[CAPACITY - 1], events.back()));
+    CHECK(same(entries[CAPACITY - 2], events[events.size() - 2]));
+
+    // Another process maps the file
+    int file = open(capture_path, O_RDONLY);
+    size_t size = sizeof(i2c_capture_file_header) + (CAPACITY + 1) * sizeof(i2c_capture_entry);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    CHECK(mapped != MAP_FAILED);
+    if (mapped != MAP_FAILED)
+    {
+        const i2c_capture_file_header* header = (const i2c_capture_file_header*)mapped;
+        const i2c_capture_entry* file_entries = (const i2c_capture_entry*)(header + 1);
+
+        CHECK(memcmp(header->magic, I2C_CAPTURE_FILE_MAGIC, 8) == 0);
+        CHECK(header->version == I2C_CAPTURE_FILE_VERSION);
+        CHECK(header->entry_size == sizeof(i2c_capture_entry));
+        CHECK(header->capacity == CAPACITY + 1);
+        CHECK(header->count == count);
+        CHECK(same(file_entries[(count - 1) % (CAPACITY + 1)], events.back()));
+        munmap(mapped, size);
+    }
+    close(file);
+
+    // Unplugging the device ends the capture
+    close(device);
+    int result = i2c_capture_poll(capture, 100);
+    CHECK(result < 0);
+
+    printf("%zu bytes in, %llu records, %llu bytes skipped, %llu dropped by the device\n",
+           stream.size(), (unsigned long long)count,
+           (unsigned long long)i2c_capture_skipped(capture), (unsigned long long)i2c_capture_dropped(capture));
+
+    i2c_capture_close(capture);
+    unlink(capture_path);
+
+    // Entry n is DATA n & 0xff at time n, so a torn or stale entry shows
+    std::vector<uint8_t> batches;
+    i2c_capture_encoder contended_encoder;
+    for (uint64_t n = 0; n < CONTENDED_BATCH * CONTENDED_BATCHES; n++)
+    {
+        uint8_t bytes[I2C_CAPTURE_MAX_RECORD];
+        uint32_t length = contended_encoder.encode(I2C_CAPTURE_DATA, n, (uint8_t)n, true, bytes);
+        batches.insert(batches.end(), bytes, bytes + length);
+        contended_encoder.written(n);
+    }
+
+    capture = i2c_capture_open(nullptr, capture_path, CAPACITY);
+    CHECK(capture != nullptr);
+    if (capture == nullptr)
+        return 1;
+
+    // The reader shares the mapping through the handle it inherits, and says through the pipe
+    // whenever it has read something so every batch is stored while it is reading
+    int progress[2];
+    CHECK(pipe(progress) == 0);
+    fcntl(progress[1], F_SETFL, O_NONBLOCK);
+    fflush(stdout);
+
+    pid_t reader = fork();
+    if (reader == 0)
+    {
+        close(progress[0]);
+        uint64_t reads = 0;
+        uint64_t torn = 0;
+        while (i2c_capture_count(capture) < CONTENDED_BATCH * CONTENDED_BATCHES)
+        {
+            uint64_t newest = i2c_capture_count(capture);
+            uint64_t first = (newest > CAPACITY) ? newest - CAPACITY : 0;
+            uint64_t copied = i2c_capture_read(capture, first, entries.data(), CAPACITY);
+            for (uint64_t i = 0; i < copied; i++)
+            {
+                if (entries[i].time_us != first + i || entries[i].value != (uint8_t)(first + i))
+                    torn++;
+            }
+            if (copied > 0)
+            {
+                reads++;
+                uint8_t tick = 1;
+                (void)!write(progress[1], &tick, 1);
+            }
+        }
+        printf("reader: %llu reads, %llu torn entries\n", (unsigned long long)reads, (unsigned long long)torn);
+        fflush(stdout);
+        _exit(torn == 0 && reads > 0 ? 0 : 1);
+    }
+    CHECK(reader > 0);
+    close(progress[1]);
+
+    // Each batch is one store, overwriting the whole file four times
+    size_t batch_bytes = batches.size() / CONTENDED_BATCHES;
+    for (size_t offset = 0; offset < batches.size(); offset += batch_bytes)
+    {
+        uint8_t tick;
+        if (offset > 0)
+            CHECK(read(progress[0], &tick, 1) == 1);
+        i2c_capture_feed(capture, &batches[offset], (batches.size() - offset < batch_bytes) ? batches.size() - offset : batch_bytes);
+    }
+    CHECK(i2c_capture_count(capture) == CONTENDED_BATCH * CONTENDED_BATCHES);
+
+    // Open until the reader is done with it, a write to a closed pipe would kill the reader
+    int status = 0;
+    CHECK(waitpid(reader, &status, 0) == reader);
+    close(progress[0]);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    i2c_capture_close(capture);
+    unlink(capture_path);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+
+/*
+    Cost of dispatching an edge to the right slave with several slaves on one device.
+
+    Slave i sits on pins 2i and 2i + 1, the master talks to the last one so a search over the
+    instances would be at its worst. Reports the host time per edge spent in the slave's
+    interrupt handler while the bus runs, then the cycles per call of the trigger handler on its
+    own for an edge that changes nothing.
+
+    usage: sim_i2c_dispatch_bench [slaves]
+*/
+
+#define MASTER_SDA_PIN  0u
+#define MASTER_SCL_PIN  1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint TRANSFERS = 2000;
+const uint CALLS = 1000000;
+
+static volatile uint8_t received;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        received = data;
+}
+
+// Time stamp counter where there is one, nanoseconds otherwise
+static uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    uint slaves = (argc > 1) ? atoi(argv[1]) : 1;
+
+    // Two pins per slave, the bank only has 30
+    if (slaves < 1 || 2 * slaves > NUM_BANK0_GPIOS || slaves > MAX_NUMBER_OF_SLAVES)
+    {
+        printf("between 1 and %u slaves\n", MIN(NUM_BANK0_GPIOS / 2, MAX_NUMBER_OF_SLAVES));
+        return 1;
+    }
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slaves");
+
+    uint last_sda = 2 * (slaves - 1);
+    uint last_scl = last_sda + 1;
+
+    {
+        sim_device_scope scope(slave_device);
+        for (uint i = 0; i < slaves; i++)
+        {
+            sim_device_wire(slave_device, 2 * i, 2 * i);
+            sim_device_wire(slave_device, 2 * i + 1, 2 * i + 1);
+            i2c_software_slave_init(2 * i, 2 * i + 1, I2C_ADDRESS, &event_handler);
+        }
+    }
+
+    sim_device_wire(master_device, MASTER_SDA_PIN, last_sda);
+    sim_device_wire(master_device, MASTER_SCL_PIN, last_scl);
+
+    {
+        sim_device_scope scope(master_device);
+        i2c_software i2c(MASTER_SDA_PIN, MASTER_SCL_PIN, 400000);
+
+        for (uint i = 0; i < TRANSFERS; i++)
+        {
+            uint8_t number = i;
+            i2c.write_bytes(I2C_ADDRESS, &number, 1);
+            if (received != number)
+            {
+                printf("FAIL slave on pins %u and %u received %u instead of %u\n", last_sda, last_scl, received, number);
+                return 1;
+            }
+        }
+    }
+
+    sim_irq_stats stats = sim_device_irq_stats(slave_device);
+
+    // A rising SDA edge while SCL is low only costs the lookup and one pin read
+    uint64_t cycles;
+    {
+        sim_device_scope scope(slave_device);
+        uint64_t begin = read_cycles();
+        for (uint i = 0; i < CALLS; i++)
+            i2c_software_slave_trigger_handler(last_sda, GPIO_IRQ_EDGE_RISE);
+        cycles = read_cycles() - begin;
+    }
+
+    printf("%2u slaves: %8.1f ns per bus edge, %6.1f cycles per dispatch\n", slaves,
+           stats.calls ? double(stats.total_ns) / double(stats.calls) : 0.0, double(cycles) / double(CALLS));
+    return 0;
+}
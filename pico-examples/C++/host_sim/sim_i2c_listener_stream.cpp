@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+#include "i2c_listener_stream.h"
+#include "sim_check.h"
+
+/*
+    The listener streaming a continuous 100 kHz bus through i2c_listener_stream to a stand in for
+    USB that takes a few 64 byte packets every 1 ms frame. Nothing may be lost while the host
+    keeps up. With the host stalled the ring fills, and the OVERFLOW record sent once it drains
+    must account for every dropped record.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define USB_FRAME_NS        1000000ull
+#define PACKETS_PER_FRAME   2
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    (void)event;
+}
+
+static i2c_listener_stream stream;
+
+static uint64_t sent = 0;
+
+static void capture_event(i2c_capture_record_type event, uint8_t data, bool acknowledged)
+{
+    stream.write_event(event, hal_time_us_64(), data, acknowledged);
+    sent++;
+}
+
+// What the host received, split back into records
+static i2c_capture_decoder decoder;
+static uint64_t records = 0;
+static uint64_t reported_dropped = 0;
+static bool host_stalled = false;
+static uint64_t next_frame_ns = USB_FRAME_NS;
+
+static void usb_frame()
+{
+    uint8_t packet[I2C_LISTENER_PACKET_SIZE];
+    for (uint i = 0; i < PACKETS_PER_FRAME; i++)
+    {
+        uint32_t length = stream.pop(packet, sizeof(packet));
+        decoder.feed(packet, length, [](const i2c_capture_record& record) {
+            if (record.type == I2C_CAPTURE_OVERFLOW)
+                reported_dropped += record.dropped;
+            else
+                records++;
+        });
+    }
+}
+
+static void usb_time_hook(uint64_t now_ns)
+{
+    while (now_ns >= next_frame_ns)
+    {
+        if (!host_stalled)
+            usb_frame();
+        next_frame_ns += USB_FRAME_NS;
+    }
+}
+
+int main()
+{
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* slave_device    = sim_device_create("slave");
+    sim_device* listener_device = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, nullptr);
+        listener.set_event_handler(&capture_event);
+        init_interrupts(listener);
+    }
+
+    sim_add_time_hook(&usb_time_hook);
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 100000);
+
+    // Back to back writes, a START or RESTART, the address and one data byte each
+    auto run = [&](uint transfers) {
+        for (uint i = 0; i < transfers; i++)
+        {
+            uint8_t number = i;
+            i2c.write_bytes(I2C_ADDRESS, &number, 1);
+        }
+    };
+
+    run(2000);
+    hal_sleep_ms(10);
+    CHECK(sent >= 2000 * 3);
+    CHECK(records == sent);
+    CHECK(stream.get_dropped() == 0);
+    printf("%llu records over %llu us with the host keeping up, %u dropped\n",
+           (unsigned long long)records, (unsigned long long)hal_time_us_64(), stream.get_dropped());
+
+    // The ring holds about 1500 records, the rest are dropped while the host is away
+    host_stalled = true;
+    run(1000);
+    host_stalled = false;
+    uint32_t dropped = stream.get_dropped();
+    CHECK(dropped > 0);
+
+    run(100);
+    while (stream.size())
+        hal_sleep_ms(1);
+
+    // A few more go while the host works through the full ring
+    CHECK(stream.get_dropped() >= dropped);
+    CHECK(reported_dropped == stream.get_dropped());
+    CHECK(records + reported_dropped == sent);
+    CHECK(decoder.get_skipped() == 0);
+    printf("%u dropped, %llu reported in band\n", stream.get_dropped(), (unsigned long long)reported_dropped);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
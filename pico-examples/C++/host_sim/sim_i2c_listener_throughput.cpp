@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+#include "i2c_listener_stream.h"
+#include "sim_check.h"
+
+/*
+    Fastest bus the listener captures without losing or garbling a byte, with USB on the same core
+    as the capture interrupt or on the other one. Both must keep up with a 100 kHz bus.
+
+    Handlers are instant in the simulator, so what the pico spends is modelled and either mode
+    can fail:
+
+      - every capture interrupt entry keeps the core for CAPTURE_ENTRY_CYCLES, edges arriving
+        meanwhile are latched together for the next entry as on the pico. The figures are
+        estimates of the SDK dispatch plus the listener and encoder, not measured on a board.
+      - with USB on the capture core the USB interrupt runs below the capture interrupt, which
+        the firmware puts at the highest priority, so it only holds capture off where TinyUSB
+        masks all interrupts. That is modelled as one masked stretch each 1 ms USB frame.
+
+    Both modes drain the stream to the host at full speed bulk rate, 19 packets a frame, so a
+    bus faster than USB drops records too.
+
+    Built against both the callback and the raw bank handler engines.
+
+    usage: sim_i2c_listener_throughput single|dual [usb masked us]
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define USB_FRAME_NS        1000000ull
+#define PACKETS_PER_FRAME   19
+#define USB_MASKED_US       2
+
+#ifdef I2C_RAW_IRQ
+#define CAPTURE_ENTRY_CYCLES    150
+#else
+#define CAPTURE_ENTRY_CYCLES    250
+#endif
+
+#define REQUIRED_HZ         100000
+
+#define TRANSFERS           200
+#define TRANSFER_BYTES      4
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    (void)event;
+}
+
+static i2c_listener_stream stream;
+
+static void capture_event(i2c_capture_record_type event, uint8_t data, bool acknowledged)
+{
+    stream.write_event(event, hal_time_us_64(), data, acknowledged);
+}
+
+// Host side, the bytes of every ADDRESS and DATA record in order
+static i2c_capture_decoder decoder;
+static std::vector<uint8_t> sniffed;
+
+static void usb_frame()
+{
+    uint8_t packet[I2C_LISTENER_PACKET_SIZE];
+    for (uint i = 0; i < PACKETS_PER_FRAME; i++)
+    {
+        uint32_t length = stream.pop(packet, sizeof(packet));
+        decoder.feed(packet, length, [](const i2c_capture_record& record) {
+            if (record.type == I2C_CAPTURE_ADDRESS || record.type == I2C_CAPTURE_DATA)
+                sniffed.push_back(record.value);
+        });
+    }
+}
+
+static sim_device* listener_device;
+static bool single_core = true;
+static uint64_t usb_masked_ns = USB_MASKED_US * 1000ull;
+static uint64_t next_frame_ns = USB_FRAME_NS;
+
+static void usb_time_hook(uint64_t now_ns)
+{
+    while (now_ns >= next_frame_ns)
+    {
+        usb_frame();
+        if (single_core)
+            sim_device_mask_irq_ns(listener_device, usb_masked_ns);
+        next_frame_ns += USB_FRAME_NS;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || (strcmp(argv[1], "single") && strcmp(argv[1], "dual")))
+    {
+        printf("usage: %s single|dual [usb masked us]\n", argv[0]);
+        return 2;
+    }
+    single_core = !strcmp(argv[1], "single");
+    if (argc > 2)
+        usb_masked_ns = strtoull(argv[2], nullptr, 0) * 1000;
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+    listener_device           = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, nullptr);
+        listener.set_event_handler(&capture_event);
+        init_interrupts(listener);
+    }
+    sim_device_set_irq_cost_ns(listener_device, CAPTURE_ENTRY_CYCLES * 1000000000ull / hal_clock_sys_hz());
+
+    sim_add_time_hook(&usb_time_hook);
+
+    sim_device_scope scope(master_device);
+
+    if (single_core)
+        printf("capture and USB on one core, USB masks the capture for %llu us a frame\n", (unsigned long long)usb_masked_ns / 1000);
+    else
+        printf("capture on core 0, USB on core 1\n");
+    printf("%u cycles a capture interrupt entry\n", CAPTURE_ENTRY_CYCLES);
+
+    const uint frequencies_hz[] = {10000, 20000, 50000, 100000, 200000, 400000, 1000000};
+    uint max_clean_hz = 0;
+    bool all_clean = true;
+
+    for (uint frequency_hz : frequencies_hz)
+    {
+        i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, frequency_hz);
+
+        std::vector<uint8_t> expected;
+        sniffed.clear();
+        uint32_t dropped = stream.get_dropped();
+
+        for (uint i = 0; i < TRANSFERS; i++)
+        {
+            uint8_t data[TRANSFER_BYTES];
+            for (uint j = 0; j < TRANSFER_BYTES; j++)
+                data[j] = (uint8_t)(i * 7 + j * 31);
+
+            i2c.write_bytes(I2C_ADDRESS, data, TRANSFER_BYTES);
+
+            expected.push_back(I2C_ADDRESS << 1);
+            expected.insert(expected.end(), data, data + TRANSFER_BYTES);
+        }
+
+        // Let the host catch up before the next speed
+        hal_sleep_ms(20);
+
+        bool clean = (sniffed == expected) && stream.get_dropped() == dropped;
+        printf("%7u Hz  %-8s %zu of %zu bytes\n", frequency_hz, clean ? "clean" : "garbled", sniffed.size(), expected.size());
+
+        if (clean && all_clean)
+            max_clean_hz = frequency_hz;
+        all_clean &= clean;
+    }
+
+    printf("%s core: %u Hz sustained\n", single_core ? "single" : "dual", max_clean_hz);
+
+    CHECK(max_clean_hz >= REQUIRED_HZ);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_loopback_lib.h"
+#include "sim_check.h"
+
+#if defined(I2C_SOFTWARE_SLAVE_PIO) || defined(I2C_SOFTWARE_MASTER_PIO)
+#include "pio_sim.h"
+#endif
+
+/*
+    The loopback benchmark's sweep on the simulated bus. The simulator takes no time inside an
+    interrupt, so every speed from 10 kHz to 1 MHz must pass without a NACK and the throughput
+    must follow the clock, the same table the firmware prints is printed here.
+
+    Built three times, with the GPIO interrupt slave, with the PIO slave and with the PIO master,
+    which is built again for every speed on the same PIO block.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static volatile uint8_t registers[I2C_LOOPBACK_REGISTERS];
+static i2c_register_bank bank(registers, I2C_LOOPBACK_REGISTERS);
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    sim_pio_attach(pio0, slave_device);
+    const char* backend = "pio";
+#elif defined(I2C_SOFTWARE_MASTER_PIO)
+    sim_pio_attach(pio1, master_device);
+    const char* backend = "pio master";
+#else
+    const char* backend = "irq";
+#endif
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init_register_bank(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &bank);
+    }
+
+    sim_device_scope scope(master_device);
+
+    i2c_loopback_result results[I2C_LOOPBACK_SPEEDS];
+    uint first_failure = i2c_loopback_sweep(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, results);
+    i2c_loopback_print(backend, results);
+
+    CHECK(first_failure == I2C_LOOPBACK_SPEEDS);
+    for (uint i = 0; i < I2C_LOOPBACK_SPEEDS; i++)
+    {
+        CHECK(results[i].transfers == I2C_LOOPBACK_TRANSFERS);
+        CHECK(results[i].nacks == 0);
+        CHECK(results[i].retries == 0);
+        if (i > 0)
+            CHECK(results[i].bytes_per_second() > results[i - 1].bytes_per_second());
+    }
+
+    // Roughly 9 bits on the wire for each byte, with the address and register bytes on top
+    uint32_t slowest = results[0].bytes_per_second();
+    CHECK(slowest > i2c_loopback_speeds_hz[0] / 9 / 2 && slowest < i2c_loopback_speeds_hz[0] / 9);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    The bit banged master on a bus it does not have to itself. A device holding SCL low for good
+    must fail the transfer after the stretch timeout instead of hanging the caller. A second
+    master sending a 0 where this one sends a 1 takes the bus: the transfer must fail at that
+    bit, with no more clocks and no STOP, and leave both lines released. A transfer afterwards
+    must reach the slave as usual.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define FREQUENCY_HZ    100000
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+// 1010101, the other master sends 100... and wins at the third address bit
+const uint8_t CONTESTED_ADDRESS = 0x55;
+#define CONTEST_AT_FALL 3
+
+static std::vector<uint8_t> received;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        received.push_back((uint8_t)data);
+}
+
+// The other master, seen only through the SCL falls it counts and the SDA it pulls down
+static uint scl_falls = 0;
+static bool contending = false;
+
+static void contender_handler(uint gpio, uint32_t event)
+{
+    if (gpio != I2C_SCL_PIN || !(event & GPIO_IRQ_EDGE_FALL))
+        return;
+    if (++scl_falls == CONTEST_AT_FALL && contending)
+        hal_gpio_set_dir(I2C_SDA_PIN, GPIO_OUT);
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device = sim_device_create("slave");
+    sim_device* contender_device = sim_device_create("contender");
+
+    for (sim_device* device : {master_device, slave_device, contender_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(contender_device);
+        hal_gpio_init(I2C_SDA_PIN);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_put(I2C_SDA_PIN, false);
+        hal_gpio_put(I2C_SCL_PIN, false);
+        hal_gpio_set_irq_callback(&contender_handler);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, FREQUENCY_HZ);
+
+    uint8_t data[2] = {0x12, 0x34};
+
+    // SCL stuck low from before the START
+    {
+        sim_device_scope contender(contender_device);
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_OUT);
+    }
+    uint64_t started_us = hal_time_us_64();
+    CHECK(!i2c.write_bytes(I2C_ADDRESS, data, 2));
+    uint64_t elapsed_us = hal_time_us_64() - started_us;
+    CHECK(i2c.get_error() == I2C_SOFTWARE_STRETCH_TIMEOUT);
+    printf("stuck SCL given up after %llu us\n", (unsigned long long)elapsed_us);
+    CHECK(elapsed_us >= I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US && elapsed_us <= I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US + 50);
+    {
+        sim_device_scope contender(contender_device);
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_IN);
+    }
+    CHECK(hal_gpio_get(I2C_SDA_PIN) && hal_gpio_get(I2C_SCL_PIN));
+    CHECK(received.empty());
+
+    // Arbitration lost in the address, the other master keeps SDA for the rest of the bit
+    scl_falls = 0;
+    contending = true;
+    CHECK(!i2c.write_bytes(CONTESTED_ADDRESS, data, 2));
+    CHECK(i2c.get_error() == I2C_SOFTWARE_ARBITRATION_LOST);
+    hal_sleep_us(100);
+    printf("arbitration lost after %u SCL falls\n", scl_falls);
+    CHECK(scl_falls == CONTEST_AT_FALL);
+    CHECK(hal_gpio_get(I2C_SCL_PIN));
+    contending = false;
+    {
+        sim_device_scope contender(contender_device);
+        hal_gpio_set_dir(I2C_SDA_PIN, GPIO_IN);
+    }
+    CHECK(hal_gpio_get(I2C_SDA_PIN));
+
+    // The bus is free again
+    CHECK(i2c.write_bytes(I2C_ADDRESS, data, 2));
+    CHECK(i2c.get_error() == I2C_SOFTWARE_OK);
+    CHECK(received == std::vector<uint8_t>(data, data + 2));
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_queue.h"
+#include "sim_check.h"
+
+/*
+    The queued master running a write, a read and a write to an address nobody answers, all
+    submitted at once. The caller keeps working while the alarm runs them, each must finish with
+    the right status in order, and the three must follow each other without a gap on the bus.
+    Then a third device stretches the clock in the middle of a write, which must only take
+    longer.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define FREQUENCY_HZ    100000
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint8_t MISSING_ADDRESS = 0x43;
+
+// The stretcher holds SCL low this long after the SCL fall it waits for
+#define STRETCH_US      40
+#define STRETCH_AT_FALL 14
+
+static std::vector<uint8_t> received;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    if (event == I2C_SLAVE_RECEIVE)
+        received.push_back((uint8_t)data);
+    else if (event == I2C_SLAVE_REQUEST)
+        data = 0xa0 + byte_number;
+}
+
+// Counts SCL falls and holds the line low once, as a slave that needs time for a byte would
+static uint scl_falls = 0;
+static bool stretching = false;
+
+static int64_t release_scl(alarm_id_t id, void* user_data)
+{
+    (void)id;
+    (void)user_data;
+    hal_gpio_set_dir(I2C_SCL_PIN, GPIO_IN);
+    return 0;
+}
+
+static void stretch_handler(uint gpio, uint32_t event)
+{
+    if (!stretching || gpio != I2C_SCL_PIN || !(event & GPIO_IRQ_EDGE_FALL))
+        return;
+    if (++scl_falls == STRETCH_AT_FALL)
+    {
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_OUT);
+        hal_add_alarm_in_us(STRETCH_US, &release_scl, nullptr);
+    }
+}
+
+static std::vector<i2c_transaction*> completed;
+static uint64_t last_completed_us = 0;
+
+static void transaction_callback(i2c_transaction* transaction)
+{
+    completed.push_back(transaction);
+    last_completed_us = hal_time_us_64();
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+    sim_device* stretch_device = sim_device_create("stretcher");
+
+    for (sim_device* device : {master_device, slave_device, stretch_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(stretch_device);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_put(I2C_SCL_PIN, false);
+        hal_gpio_set_irq_callback(&stretch_handler);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software_queue i2c(I2C_SDA_PIN, I2C_SCL_PIN, FREQUENCY_HZ);
+
+    uint8_t write_data[4] = {0x11, 0x22, 0x33, 0x44};
+    uint8_t read_data[2] = {0, 0};
+    uint8_t missing_data[1] = {0x55};
+
+    i2c_transaction write = {I2C_ADDRESS, false, write_data, 4, &transaction_callback};
+    i2c_transaction read = {I2C_ADDRESS, true, read_data, 2, &transaction_callback};
+    i2c_transaction missing = {MISSING_ADDRESS, false, missing_data, 1, &transaction_callback};
+
+    uint64_t submitted_us = hal_time_us_64();
+    CHECK(i2c.submit(&write));
+    CHECK(i2c.submit(&read));
+    CHECK(i2c.submit(&missing));
+    CHECK(!i2c.idle());
+
+    // The caller is free until the last one completes
+    uint work = 0;
+    while (missing.status < I2C_TRANSACTION_DONE)
+    {
+        hal_sleep_us(1);
+        work++;
+    }
+    CHECK(i2c.idle());
+    CHECK(work > 0);
+
+    CHECK(write.status == I2C_TRANSACTION_DONE);
+    CHECK(write.transferred == 4);
+    CHECK(read.status == I2C_TRANSACTION_DONE);
+    CHECK(read.transferred == 2);
+    CHECK(missing.status == I2C_TRANSACTION_ADDRESS_NACK);
+    CHECK(missing.transferred == 0);
+
+    CHECK(received == std::vector<uint8_t>(write_data, write_data + 4));
+    CHECK(read_data[0] == 0xa0 && read_data[1] == 0xa1);
+    CHECK(completed == std::vector<i2c_transaction*>({&write, &read, &missing}));
+
+    // START, nine bits a byte and STOP for each, one period per symbol
+    uint symbols = (2 + 9 * 5) + (2 + 9 * 3) + (2 + 9 * 1);
+    uint64_t expected_us = symbols * 1000000ull / FREQUENCY_HZ;
+    uint64_t elapsed_us = last_completed_us - submitted_us;
+    printf("%u symbols in %llu us, %llu us expected, %u us of work done alongside\n",
+           symbols, (unsigned long long)elapsed_us, (unsigned long long)expected_us, work);
+    CHECK(elapsed_us + 5 >= expected_us && elapsed_us <= expected_us + 5);
+
+    // A full queue turns submissions away until it drains
+    std::vector<i2c_transaction> flood(I2C_SOFTWARE_QUEUE_SIZE + 2, missing);
+    uint accepted = 0;
+    for (i2c_transaction& transaction : flood)
+        accepted += i2c.submit(&transaction);
+    CHECK(accepted == I2C_SOFTWARE_QUEUE_SIZE + 1);
+    while (!i2c.idle())
+        hal_sleep_us(10);
+
+    // Stretched during the second byte, every byte must still arrive and the write take the
+    // stretch longer, less the low phase of the bit it started in
+    received.clear();
+    completed.clear();
+    stretching = true;
+    submitted_us = hal_time_us_64();
+    CHECK(i2c.submit(&write));
+    while (!i2c.idle())
+        hal_sleep_us(1);
+    stretching = false;
+
+    CHECK(scl_falls >= STRETCH_AT_FALL);
+    CHECK(write.status == I2C_TRANSACTION_DONE);
+    CHECK(received == std::vector<uint8_t>(write_data, write_data + 4));
+    uint64_t write_us = (2 + 9 * 5) * 1000000ull / FREQUENCY_HZ;
+    elapsed_us = last_completed_us - submitted_us;
+    printf("stretched write in %llu us, %llu us unstretched\n", (unsigned long long)elapsed_us, (unsigned long long)write_us);
+    CHECK(elapsed_us + 10 >= write_us + STRETCH_US && elapsed_us <= write_us + STRETCH_US + 5);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    Measures the clock the software master puts on SCL with a probe device timing every edge.
+    The frequency over the whole run and the share of each bit SCL spends high must be within
+    a few percent of what was asked for. The master drives open drain, so it may never drive a
+    line high against the slave, and it must wait out a device stretching the clock.
+
+    usage: sim_i2c_master_timing <scl frequency hz>
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define TOLERANCE       0.03
+#define TRANSFERS       50
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static uint received = 0;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        received++;
+}
+
+// Holds SCL low for a while after every falling edge while stretching is on
+static bool stretching = false;
+static uint stretch_us = 0;
+
+static int64_t release_scl(alarm_id_t id, void* user_data)
+{
+    (void)id;
+    (void)user_data;
+    hal_gpio_set_dir(I2C_SCL_PIN, GPIO_IN);
+    return 0;
+}
+
+static void stretcher_callback(uint gpio, uint32_t events)
+{
+    (void)gpio;
+    if (stretching && (events & GPIO_IRQ_EDGE_FALL))
+    {
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_OUT);
+        hal_add_alarm_in_us(stretch_us, &release_scl, nullptr);
+    }
+}
+
+static std::vector<uint64_t> rises;
+static std::vector<uint64_t> falls;
+
+static void probe_callback(uint gpio, uint32_t events)
+{
+    (void)gpio;
+    if (events & GPIO_IRQ_EDGE_RISE)
+        rises.push_back(sim_time_ns());
+    if (events & GPIO_IRQ_EDGE_FALL)
+        falls.push_back(sim_time_ns());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <scl frequency hz>\n", argv[0]);
+        return 2;
+    }
+    int frequency_hz = atoi(argv[1]);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+    sim_device* probe_device  = sim_device_create("probe");
+    sim_device* stretcher_device = sim_device_create("stretcher");
+
+    for (sim_device* device : {master_device, slave_device, probe_device, stretcher_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    {
+        sim_device_scope scope(probe_device);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_IN);
+        hal_gpio_set_irq_callback(&probe_callback);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    {
+        sim_device_scope scope(stretcher_device);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_put(I2C_SCL_PIN, false);
+        hal_gpio_set_irq_callback(&stretcher_callback);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, frequency_hz);
+
+    for (uint i = 0; i < TRANSFERS; i++)
+    {
+        uint8_t data[2] = {(uint8_t)i, (uint8_t)~i};
+        i2c.write_bytes(I2C_ADDRESS, data, 2);
+    }
+
+    CHECK(received == 2 * TRANSFERS);
+    CHECK(rises.size() >= 27 * TRANSFERS);
+    if (rises.size() < 2)
+        return 1;
+
+    // Every bit, START and acknowledge included, is one period from rise to rise
+    double period_ns = double(rises.back() - rises.front()) / (rises.size() - 1);
+    double measured_hz = 1e9 / period_ns;
+
+    // High time of each clock pulse, a rise is followed by the next fall
+    uint64_t high_ns = 0;
+    uint pulses = 0;
+    size_t f = 0;
+    for (uint64_t rise : rises)
+    {
+        while (f < falls.size() && falls[f] < rise)
+            f++;
+        if (f == falls.size())
+            break;
+        high_ns += falls[f] - rise;
+        pulses++;
+    }
+    double duty = double(high_ns) / pulses / period_ns;
+
+    double error = measured_hz / frequency_hz - 1.0;
+    printf("requested %d Hz, measured %.0f Hz (%+.2f%%), high %.1f%% of each bit\n",
+           frequency_hz, measured_hz, error * 100, duty * 100);
+
+    CHECK(error < TOLERANCE && error > -TOLERANCE);
+    CHECK(duty > 0.5 - TOLERANCE && duty < 0.5 + TOLERANCE);
+    CHECK(sim_contention_count() == 0);
+
+    // Held low for a whole bit after every fall, the master waits and nothing is lost
+    stretch_us = 1000000 / frequency_hz + 1;
+    stretching = true;
+    size_t first_rise = rises.size();
+    uint64_t start_ns = sim_time_ns();
+    for (uint i = 0; i < TRANSFERS; i++)
+    {
+        uint8_t data[2] = {(uint8_t)i, (uint8_t)~i};
+        i2c.write_bytes(I2C_ADDRESS, data, 2);
+    }
+    stretching = false;
+
+    CHECK(received == 4 * TRANSFERS);
+    CHECK(rises.size() - first_rise >= 27 * TRANSFERS);
+    double stretched_period_ns = double(sim_time_ns() - start_ns) / (rises.size() - first_rise);
+    CHECK(stretched_period_ns > stretch_us * 1000.0);
+    CHECK(sim_contention_count() == 0);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "pio_sim.h"
+#include "i2c_pio_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    i2c_software built with I2C_SOFTWARE_MASTER_PIO, so every transfer runs on the PIO master with
+    DMA moving the payload, against the PIO slave on the other block. A 256 byte write and read must get
+    through intact at the requested SCL frequency, a device stretching the clock must slow the
+    bus down without losing anything, and a missing address must be reported with the bus left
+    free for the next transfer.
+
+    usage: sim_i2c_pio_master <scl frequency hz>
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define TOLERANCE       0.03
+#define PAYLOAD         256
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint8_t MISSING_ADDRESS = 0x43;
+
+static std::vector<uint8_t> received;
+static uint starts = 0;
+static uint stops = 0;
+
+static uint8_t reply(uint byte_number)
+{
+    return byte_number * 7 + 3;
+}
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        received.push_back((uint8_t)data);
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = reply(byte_number);
+        break;
+
+    case I2C_SLAVE_STOP:
+        stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// SCL rising edges, one per bit
+static std::vector<uint64_t> rises;
+
+static void probe_callback(uint gpio, uint32_t events)
+{
+    (void)gpio;
+    if (events & GPIO_IRQ_EDGE_RISE)
+        rises.push_back(sim_time_ns());
+}
+
+// Holds SCL low for a while after every falling edge while stretching is on
+static bool stretching = false;
+static uint stretch_us = 0;
+
+static int64_t release_scl(alarm_id_t id, void* user_data)
+{
+    (void)id;
+    (void)user_data;
+    hal_gpio_set_dir(I2C_SCL_PIN, GPIO_IN);
+    return 0;
+}
+
+static void stretcher_callback(uint gpio, uint32_t events)
+{
+    (void)gpio;
+    if (stretching && (events & GPIO_IRQ_EDGE_FALL))
+    {
+        hal_gpio_set_dir(I2C_SCL_PIN, GPIO_OUT);
+        hal_add_alarm_in_us(stretch_us, &release_scl, nullptr);
+    }
+}
+
+// Bit rate from the rising edges of SCL since the given one
+static double measured_hz(size_t first_rise)
+{
+    double period_ns = double(rises.back() - rises[first_rise]) / (rises.size() - 1 - first_rise);
+    return 1e9 / period_ns;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <scl frequency hz>\n", argv[0]);
+        return 2;
+    }
+    int frequency_hz = atoi(argv[1]);
+
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device    = sim_device_create("pio master");
+    sim_device* slave_device     = sim_device_create("slave");
+    sim_device* probe_device     = sim_device_create("probe");
+    sim_device* stretcher_device = sim_device_create("stretcher");
+
+    for (sim_device* device : {master_device, slave_device, probe_device, stretcher_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    sim_pio_attach(pio0, slave_device);
+    i2c_pio_slave_init(pio0, I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+
+    {
+        sim_device_scope scope(probe_device);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_set_irq_callback(&probe_callback);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_RISE, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    {
+        sim_device_scope scope(stretcher_device);
+        hal_gpio_init(I2C_SCL_PIN);
+        hal_gpio_put(I2C_SCL_PIN, false);
+        hal_gpio_set_irq_callback(&stretcher_callback);
+        hal_gpio_set_irq_enabled(I2C_SCL_PIN, GPIO_IRQ_EDGE_FALL, true);
+        hal_gpio_irq_bank_enable();
+    }
+
+    sim_pio_attach(pio1, master_device);
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, frequency_hz);
+
+    uint8_t payload[PAYLOAD];
+    for (uint i = 0; i < PAYLOAD; i++)
+        payload[i] = i ^ 0x5a;
+
+    // Write: START, address, the payload and a STOP
+    size_t first_rise = rises.size();
+    i2c.write_bytes(I2C_ADDRESS, payload, PAYLOAD);
+    CHECK(received == std::vector<uint8_t>(payload, payload + PAYLOAD));
+    CHECK(starts == 1);
+    CHECK(stops == 1);
+    CHECK(rises.size() - first_rise == 9 * (PAYLOAD + 1) + 1);
+
+    double write_hz = measured_hz(first_rise);
+    double error = write_hz / frequency_hz - 1.0;
+    CHECK(error < TOLERANCE && error > -TOLERANCE);
+
+    // Read: the master acknowledges every byte but the last
+    uint8_t reply_data[PAYLOAD] = {0};
+    i2c.read_bytes(I2C_ADDRESS, reply_data, PAYLOAD);
+    bool replied = true;
+    for (uint i = 0; i < PAYLOAD; i++)
+        replied &= reply_data[i] == reply(i);
+    CHECK(replied);
+    CHECK(starts == 2);
+    CHECK(stops == 2);
+
+    // A slow device holding SCL for a whole bit after every falling edge, nothing may be lost
+    stretch_us = 1000000 / frequency_hz + 1;
+    stretching = true;
+    received.clear();
+    first_rise = rises.size();
+    i2c.write_bytes(I2C_ADDRESS, payload, 16);
+    stretching = false;
+    CHECK(received == std::vector<uint8_t>(payload, payload + 16));
+    double stretched_hz = measured_hz(first_rise);
+    CHECK(stretched_hz < frequency_hz * (1.0 - TOLERANCE));
+
+    // Nobody answers, the engine stops and the bus is released for the next transfer
+    i2c_pio_master* engine = i2c.pio_master;
+    received.clear();
+    CHECK(!engine->write_bytes(MISSING_ADDRESS, payload, 4));
+    CHECK(received.empty());
+    CHECK(hal_gpio_get(I2C_SDA_PIN) && hal_gpio_get(I2C_SCL_PIN));
+    CHECK(engine->write_bytes(I2C_ADDRESS, payload, 4));
+    CHECK(received == std::vector<uint8_t>(payload, payload + 4));
+
+    printf("requested %d Hz, measured %.0f Hz (%+.2f%%), %.0f Hz while stretched by %u us\n",
+           frequency_hz, write_hz, error * 100, stretched_hz, stretch_us);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "pio_sim.h"
+#include "pio_assembler.h"
+#include "i2c_pio_slave_lib.h"
+#include "i2c_pio_slave.pio.h"
+#include "i2c_software_master_lib.h"
+#include "i2c_listener_lib.h"
+#include "sim_check.h"
+
+/*
+    The PIO slave from lib/i2c_pio_slave running on the emulated PIO, with the software master
+    and the listener on the same simulated bus, then again with the CPU a bit time late to the
+    PIO interrupt. Also checks the host assembler against encodings from the RP2040 datasheet.
+
+    usage: sim_i2c_pio_slave [bus frequency in Hz]
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint WRITES = 50;
+const uint LATE_PAIRS = 20;
+
+static uint8_t received;
+static uint starts = 0;
+static uint stops = 0;
+static uint bytes = 0;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        received = data;
+        bytes++;
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = received + 1;
+        bytes++;
+        break;
+
+    case I2C_SLAVE_STOP:
+        stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static std::vector<uint32_t> sniffed;
+
+static void message_handler(uint32_t message)
+{
+    sniffed.push_back(message);
+}
+
+static uint16_t assemble_one(const char* program, const char* instruction)
+{
+    pio_asm_file file;
+    std::string error;
+    std::string source = std::string(".program test\n") + program + "\n" + instruction + "\n";
+    if (!pio_assemble(source, file, error))
+    {
+        printf("'%s': %s\n", instruction, error.c_str());
+        return 0;
+    }
+    return file.programs[0].instructions[0];
+}
+
+static void check_assembler()
+{
+    struct {
+        const char* program;
+        const char* instruction;
+        uint16_t encoding;
+    } cases[] = {
+        {"", "nop", 0xa042},
+        {"", "jmp x!=y 5", 0x00a5},
+        {"", "jmp y-- 3", 0x0083},
+        {"", "wait 1 irq 5 rel", 0x20d5},
+        {"", "wait 0 pin 1", 0x2021},
+        {"", "wait 1 pin 1", 0x20a1},
+        {"", "in pins, 1", 0x4001},
+        {"", "out pindirs, 1", 0x6081},
+        {"", "out null, 32", 0x6060},
+        {"", "push block", 0x8020},
+        {"", "pull block", 0x80a0},
+        {"", "mov isr, ~null", 0xa0cb},
+        {"", "mov y, isr", 0xa046},
+        {"", "set pindirs, 1", 0xe081},
+        {"", "irq nowait 4 rel", 0xc014},
+        {"", "set x, 3 [2]", 0xe223},
+        {".side_set 1 opt pindirs", "out pindirs, 1 side 1", 0x7881},
+        {".side_set 1 opt pindirs", "wait 1 pin 1 side 0", 0x30a1},
+        {".side_set 2", "nop side 2 [3]", 0xb342},
+    };
+
+    for (auto& c : cases)
+    {
+        uint16_t encoding = assemble_one(c.program, c.instruction);
+        if (encoding != c.encoding)
+        {
+            printf("FAIL '%s' assembled to 0x%04x, expected 0x%04x\n", c.instruction, encoding, c.encoding);
+            failures++;
+        }
+    }
+
+    // The sdk's encoders must agree with the assembler, the driver uses both
+    CHECK(pio_encode_pull(false, true) == 0x80a0);
+    CHECK(pio_encode_mov(pio_x, pio_osr) == 0xa027);
+    CHECK(pio_encode_out(pio_null, 32) == 0x6060);
+
+    // Both programs share one PIO block, with room for nothing much else
+    CHECK(i2c_pio_slave_program.length + i2c_pio_slave_condition_program.length <= PIO_INSTRUCTION_COUNT);
+}
+
+int main(int argc, char** argv)
+{
+    uint frequency = (argc > 1) ? atoi(argv[1]) : 100000;
+
+    check_assembler();
+
+    // Set SIM_TRACE to print every bus edge
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* slave_device    = sim_device_create("pio slave");
+    sim_device* listener_device = sim_device_create("listener");
+
+    for (sim_device* device : {master_device, slave_device, listener_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    sim_pio_attach(pio0, slave_device);
+    i2c_pio_slave_init(pio0, I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+
+    {
+        sim_device_scope scope(listener_device);
+        static i2c_listener listener(I2C_SDA_PIN, I2C_SCL_PIN, &message_handler);
+        init_interrupts(listener);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, frequency);
+
+    // Every write first and a single read of the byte after the last one at the end
+    for (uint i = 0; i < WRITES; i++)
+    {
+        uint8_t number = i * 7;
+        i2c.write_bytes(I2C_ADDRESS, &number, 1);
+        CHECK(received == number);
+    }
+
+    uint8_t read_number = 0;
+    i2c.read_bytes(I2C_ADDRESS, &read_number, 1);
+    CHECK(read_number == uint8_t(received + 1));
+
+    // Every transfer ends in a STOP, so every start is a transfer
+    uint transfers = WRITES + 1;
+    CHECK(starts == transfers);
+    CHECK(stops == transfers);
+    CHECK(sniffed.size() == 2 * transfers);
+
+    // The master does not acknowledge the read's only byte, so no next one is requested
+    CHECK(bytes == transfers);
+
+    sim_pio_stats stats = sim_pio_get_stats(pio0);
+
+    // A CPU that gets to the PIO interrupt a bit time late services each STOP after the START
+    // straight behind it. After a read the engine has already taken that START by itself and
+    // must be left in it, after a write it is still in the old transfer and must be restarted.
+    sim_pio_set_irq_latency_ns(pio0, 1000000000ull / frequency);
+    uint late_starts = starts;
+    uint late_stops = stops;
+    uint late_bytes = bytes;
+    for (uint i = 0; i < LATE_PAIRS; i++)
+    {
+        uint8_t number = i * 13 + 1;
+        CHECK(i2c.write_bytes(I2C_ADDRESS, &number, 1));
+        uint8_t next = 0;
+        CHECK(i2c.read_bytes(I2C_ADDRESS, &next, 1));
+        CHECK(next == uint8_t(number + 1));
+
+        // A repeated START is serviced well inside the address after it, the engine must not
+        // have acknowledged anything of its own by then
+        number += 2;
+        CHECK(i2c.write_read(I2C_ADDRESS, &number, 1, &next, 1));
+        CHECK(next == uint8_t(number + 1));
+    }
+    hal_sleep_us(100);
+    CHECK(starts - late_starts == 4 * LATE_PAIRS);
+    CHECK(stops - late_stops == 3 * LATE_PAIRS);
+    CHECK(bytes - late_bytes == 4 * LATE_PAIRS);
+
+    printf("%u Hz: %u transfers, %llu PIO instructions, %.2f CPU interrupts per byte, %llu contentions\n",
+           frequency, transfers, (unsigned long long)stats.instructions,
+           double(stats.irq_calls) / double(2 * transfers), (unsigned long long)sim_contention_count());
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
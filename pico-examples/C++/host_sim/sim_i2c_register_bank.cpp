@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+#include "pio_sim.h"
+#endif
+
+/*
+    A slave in register bank mode: writes land in the bank from the selected register on, reads
+    come out of it, the pointer wraps at the end of the bank and carries over a repeated START.
+    The application hears about each transaction once, at its STOP.
+
+    Built twice, with the GPIO interrupt slave and with the PIO slave.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define REGISTERS       16
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static volatile uint8_t registers[REGISTERS];
+
+static uint stops = 0;
+static uint8_t last_first;
+static uint last_written;
+static uint last_read;
+
+static void on_stop(uint8_t first_register, uint n_written, uint n_read)
+{
+    stops++;
+    last_first = first_register;
+    last_written = n_written;
+    last_read = n_read;
+}
+
+static i2c_register_bank bank(registers, REGISTERS, &on_stop);
+
+static bool bank_holds(uint first, const uint8_t* data, uint n)
+{
+    for (uint i = 0; i < n; i++)
+    {
+        if (registers[(first + i) % REGISTERS] != data[i])
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    for (uint i = 0; i < REGISTERS; i++)
+        registers[i] = 0x80 + i;
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    sim_pio_attach(pio0, slave_device);
+#endif
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init_register_bank(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &bank);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    // Register read, the pointer write and the read joined by a repeated START
+    uint8_t reg = 3;
+    uint8_t rx[4] = {0};
+    CHECK(i2c.write_read(I2C_ADDRESS, &reg, 1, rx, sizeof(rx)));
+    CHECK(bank_holds(3, rx, sizeof(rx)));
+    CHECK(stops == 1);
+    CHECK(last_first == 3 && last_written == 0 && last_read == 4);
+
+    // Write from register 14 on, wrapping round to 0 and 1
+    uint8_t tx[5] = {14, 0x11, 0x22, 0x33, 0x44};
+    i2c_segment write[1] = {{tx, sizeof(tx), false}};
+    CHECK(i2c.transfer(I2C_ADDRESS, write, 1));
+    CHECK(bank_holds(14, &tx[1], 4));
+    CHECK(stops == 2);
+    CHECK(last_first == 14 && last_written == 4 && last_read == 0);
+
+    // A read on its own carries on from the pointer, which the last write left at 2
+    uint8_t next[2] = {0};
+    i2c_segment read[1] = {{next, sizeof(next), true}};
+    CHECK(i2c.transfer(I2C_ADDRESS, read, 1));
+    CHECK(bank_holds(2, next, sizeof(next)));
+    CHECK(stops == 3);
+    CHECK(last_first == 2 && last_read == 2);
+
+    // Registers the application changes are what the master reads next
+    registers[9] = 0x5a;
+    reg = 9;
+    CHECK(i2c.write_read(I2C_ADDRESS, &reg, 1, rx, 1));
+    CHECK(rx[0] == 0x5a);
+    CHECK(stops == 4);
+
+    printf("%u transactions, %llu us simulated\n", stops, (unsigned long long)(sim_time_ns() / 1000));
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+#include "pio_sim.h"
+#endif
+
+/*
+    Scans a bus with slaves at a few addresses, one of them reserved. Exactly the others must be
+    found, each address probed with a single address byte, and the whole scan must take no more
+    than a few milliseconds at 400 kHz.
+
+    Built twice, bit banged and with the PIO master.
+*/
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define MASTER_SDA_PIN  20u
+#define MASTER_SCL_PIN  21u
+
+#define SCAN_HZ         400000
+#define SCAN_LIMIT_US   5000
+
+const uint8_t SLAVE_ADDRESSES[] = {0x03, 0x10, 0x42, 0x77};
+
+static uint starts = 0;
+static uint received = 0;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_START)
+        starts++;
+    if (event == I2C_SLAVE_RECEIVE)
+        received++;
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slaves");
+
+    sim_device_wire(master_device, MASTER_SDA_PIN, SDA_NET);
+    sim_device_wire(master_device, MASTER_SCL_PIN, SCL_NET);
+
+    // Slave i sits on pins 2i and 2i + 1 of the one device, all on the same bus
+    {
+        sim_device_scope scope(slave_device);
+        for (uint i = 0; i < sizeof(SLAVE_ADDRESSES); i++)
+        {
+            sim_device_wire(slave_device, 2 * i, SDA_NET);
+            sim_device_wire(slave_device, 2 * i + 1, SCL_NET);
+            i2c_software_slave_init(2 * i, 2 * i + 1, SLAVE_ADDRESSES[i], &event_handler);
+        }
+    }
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+    sim_pio_attach(pio1, master_device);
+#endif
+
+    sim_device_scope scope(master_device);
+
+    // The PIO master needs SCL right after SDA
+    i2c_software i2c(MASTER_SDA_PIN, MASTER_SCL_PIN, SCAN_HZ);
+
+    uint64_t begin_ns = sim_time_ns();
+    i2c_scan_result result = i2c.scan();
+    uint64_t scan_us = (sim_time_ns() - begin_ns) / 1000;
+
+    uint found = 0;
+    for (uint address = 0; address < 0x80; address++)
+    {
+        if (!i2c_scan_found(&result, address))
+            continue;
+        found++;
+        CHECK(!i2c_scan_reserved(address));
+    }
+    CHECK(found == 3);
+    CHECK(i2c_scan_found(&result, 0x10));
+    CHECK(i2c_scan_found(&result, 0x42));
+    CHECK(i2c_scan_found(&result, 0x77));
+    CHECK(!i2c_scan_found(&result, 0x03));
+
+    // Every slave sees one START per probe and nothing is written
+    uint probes = I2C_SCAN_LAST_ADDRESS - I2C_SCAN_FIRST_ADDRESS + 1;
+    CHECK(starts == probes * sizeof(SLAVE_ADDRESSES));
+    CHECK(received == 0);
+    CHECK(scan_us < SCAN_LIMIT_US);
+    CHECK(hal_gpio_get(MASTER_SDA_PIN) && hal_gpio_get(MASTER_SCL_PIN));
+
+    i2c_scan_print(&result);
+    printf("%u probes in %llu us at %u Hz\n", probes, (unsigned long long)scan_us, SCAN_HZ);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
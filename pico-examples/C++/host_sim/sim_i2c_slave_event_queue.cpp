@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+#include "pio_sim.h"
+#endif
+
+/*
+    A slave started with a deferred event queue. Nothing but the request handler may run in the
+    interrupt, every event must come out of dispatch in bus order with the bytes that went over
+    the bus, and a queue left undrained must count what it drops instead of blocking.
+
+    Built twice, with the GPIO interrupt slave and with the PIO slave.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+struct seen_event {
+    i2c_software_slave_event event;
+    uint8_t data;
+    uint byte_number;
+};
+
+static std::vector<seen_event> dispatched;
+static uint requests_in_interrupt = 0;
+
+static uint8_t reply(uint byte_number)
+{
+    return 0xc0 + byte_number;
+}
+
+static void request_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)event;
+    requests_in_interrupt++;
+    data = reply(byte_number);
+}
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    dispatched.push_back({event, data, byte_number});
+}
+
+static i2c_slave_event_queue events(&event_handler, &request_handler);
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    sim_pio_attach(pio0, slave_device);
+#endif
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init_deferred(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &events);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    // Write two bytes then read three, nothing reaches the handler until dispatch
+    uint8_t tx[2] = {0x11, 0x22};
+    uint8_t rx[3] = {0};
+    CHECK(i2c.write_read(I2C_ADDRESS, tx, sizeof(tx), rx, sizeof(rx)));
+    CHECK(dispatched.empty());
+    CHECK(requests_in_interrupt == 3);
+    CHECK(rx[0] == reply(0) && rx[1] == reply(1) && rx[2] == reply(2));
+
+    // START, RECEIVE x2, repeated START, REQUEST x3, STOP
+    CHECK(events.dispatch() == 8);
+    CHECK(dispatched.size() == 8);
+    if (dispatched.size() == 8)
+    {
+        CHECK(dispatched[0].event == I2C_SLAVE_START);
+        CHECK(dispatched[1].event == I2C_SLAVE_RECEIVE && dispatched[1].data == 0x11 && dispatched[1].byte_number == 1);
+        CHECK(dispatched[2].event == I2C_SLAVE_RECEIVE && dispatched[2].data == 0x22 && dispatched[2].byte_number == 2);
+        CHECK(dispatched[3].event == I2C_SLAVE_START);
+        for (uint i = 0; i < 3; i++)
+            CHECK(dispatched[4 + i].event == I2C_SLAVE_REQUEST && dispatched[4 + i].data == reply(i));
+        CHECK(dispatched[7].event == I2C_SLAVE_STOP);
+    }
+    CHECK(events.overflows() == 0);
+    CHECK(events.dispatch() == 0);
+
+    // Left undrained, the ring keeps the oldest events and counts the rest
+    uint8_t payload[20] = {0};
+    i2c_segment write[1] = {{payload, sizeof(payload), false}};
+    for (uint i = 0; i < 4; i++)
+        i2c.transfer(I2C_ADDRESS, write, 1);
+
+    uint total = 4 * (sizeof(payload) + 2);
+    dispatched.clear();
+    CHECK(events.dispatch() == I2C_SLAVE_EVENT_QUEUE_SIZE);
+    CHECK(events.overflows() == total - I2C_SLAVE_EVENT_QUEUE_SIZE);
+    CHECK(dispatched.size() && dispatched[0].event == I2C_SLAVE_START);
+
+    printf("%u events dispatched, %u lost\n", 8 + I2C_SLAVE_EVENT_QUEUE_SIZE, events.overflows());
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+
+/*
+    Differential fuzzing of the software slave against a reference model written straight from
+    the I2C specification.
+
+    A hand driven master plays random transactions, to the slave's address and to others, reads
+    and writes of random length, ACKs and NACKs, clocks after a NACKed read, repeated STARTs, and with a small chance per
+    step an illegal toggle of either line: a START or STOP in the middle of a byte, a byte cut
+    short, a clock the slave does not expect. After every step the level of SDA and the slave's
+    events must be exactly what the model expects and no pin may ever drive against another.
+    The first divergence is printed with its seed and step, rerun it with SIM_TRACE=1.
+
+    usage: sim_i2c_slave_fuzz [seeds] [first seed]
+
+    Built twice, with the sdk's per pin callback and with the raw bank handler.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define TRANSACTIONS    12
+#define GLITCH_PERCENT  2
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+struct logged_event {
+    i2c_software_slave_event event;
+    uint byte_number;
+    uint8_t data;
+
+    bool operator==(const logged_event& other) const
+    {
+        return event == other.event && byte_number == other.byte_number && data == other.data;
+    }
+};
+
+static uint8_t reply(uint byte_number)
+{
+    return 0xa5 ^ (byte_number * 13);
+}
+
+// What the slave did
+static std::vector<logged_event> slave_log;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_RECEIVE:
+        slave_log.push_back({event, byte_number, (uint8_t)data});
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = reply(byte_number);
+        slave_log.push_back({event, byte_number, 0});
+        break;
+
+    default:
+        slave_log.push_back({event, 0, 0});
+        break;
+    }
+}
+
+// A 7 bit address slave as the specification describes it, fed the levels of both lines
+class reference_slave
+{
+    public:
+        bool drive_low = false;
+        std::vector<logged_event> log;
+
+        // Reads of this slave the master ended with a NACK
+        uint nacked_reads = 0;
+
+        void start()
+        {
+            phase = ADDRESS;
+            bits = 0;
+            shift = 0;
+            log.push_back({I2C_SLAVE_START, 0, 0});
+        }
+
+        void stop()
+        {
+            phase = IDLE;
+            log.push_back({I2C_SLAVE_STOP, 0, 0});
+        }
+
+        // Data is sampled while SCL is high
+        void scl_rise(bool sda)
+        {
+            switch (phase)
+            {
+            case ADDRESS:
+                shift = (shift << 1) | sda;
+                if (++bits < 8)
+                    break;
+                if ((shift >> 1) != I2C_ADDRESS)
+                {
+                    phase = IDLE;
+                    break;
+                }
+                reading = shift & 1;
+                byte_number = 0;
+                phase = ACKNOWLEDGE_DUE;
+                break;
+
+            case WRITE:
+                shift = (shift << 1) | sda;
+                if (++bits < 8)
+                    break;
+                log.push_back({I2C_SLAVE_RECEIVE, ++byte_number, shift});
+                phase = ACKNOWLEDGE_DUE;
+                break;
+
+            case MASTER_ACKNOWLEDGE:
+                // A NACK ends the read, SDA is left to the master
+                phase = sda ? IDLE : NEXT_BYTE;
+                nacked_reads += sda;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        // SDA only changes while SCL is low
+        void scl_fall()
+        {
+            switch (phase)
+            {
+            case ACKNOWLEDGE_DUE:
+                drive_low = true;
+                phase = ACKNOWLEDGE;
+                break;
+
+            case ACKNOWLEDGE:
+                drive_low = false;
+                bits = 0;
+                shift = 0;
+                if (reading)
+                    load_byte();
+                else
+                    phase = WRITE;
+                break;
+
+            case READ:
+                if (bits < 8)
+                    send_bit();
+                else
+                {
+                    drive_low = false;
+                    phase = MASTER_ACKNOWLEDGE;
+                }
+                break;
+
+            case NEXT_BYTE:
+                load_byte();
+                break;
+
+            default:
+                break;
+            }
+        }
+
+    private:
+        enum phase_t { IDLE, ADDRESS, ACKNOWLEDGE_DUE, ACKNOWLEDGE, WRITE, READ, MASTER_ACKNOWLEDGE, NEXT_BYTE };
+
+        phase_t phase = IDLE;
+        uint bits = 0;
+        uint8_t shift = 0;
+        bool reading = false;
+        uint byte_number = 0;
+
+        void load_byte()
+        {
+            log.push_back({I2C_SLAVE_REQUEST, byte_number, 0});
+            shift = reply(byte_number++);
+            bits = 0;
+            phase = READ;
+            send_bit();
+        }
+
+        void send_bit()
+        {
+            drive_low = !((shift >> (7 - bits)) & 1);
+            bits++;
+        }
+};
+
+// Small deterministic generator so a seed replays the same run
+static uint32_t random_state;
+
+static uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static bool chance(uint percent)
+{
+    return next_random() % 100 < percent;
+}
+
+// The model and the master's lines carry over from one seed to the next, as the slave does
+static reference_slave model;
+static bool master_sda = true;
+static bool master_scl = true;
+static bool sda = true;
+
+// The hand driven master and the checks after every step
+class fuzz_run
+{
+    public:
+        bool diverged = false;
+
+        fuzz_run(uint32_t run_seed)
+        {
+            seed = run_seed;
+            random_state = seed * 2654435761u + 1;
+            slave_log.clear();
+            model.log.clear();
+            step_count = 0;
+        }
+
+        void transaction()
+        {
+            start();
+            bool ours = chance(70);
+            uint8_t address = ours ? I2C_ADDRESS : (next_random() & 0x7f);
+            bool read = next_random() & 1;
+            write_byte((address << 1) | read);
+            if (diverged)
+                return;
+
+            uint n_bytes = next_random() % 5;
+            bool nacked = false;
+            for (uint i = 0; i < n_bytes && !diverged; i++)
+            {
+                if (read)
+                {
+                    bool acknowledge = i + 1 < n_bytes || chance(10);
+                    read_byte(acknowledge);
+                    nacked = !acknowledge;
+                }
+                else
+                    write_byte(next_random());
+            }
+
+            // A master that keeps clocking after its NACK must find SDA let go
+            if (nacked && chance(30))
+            {
+                uint clocks = 1 + next_random() % 9;
+                for (uint i = 0; i < clocks && !diverged; i++)
+                    clock(true);
+            }
+
+            // Otherwise the next transaction follows with a repeated START
+            if (chance(70))
+                stop();
+        }
+
+        void finish()
+        {
+            stop();
+        }
+
+    private:
+        uint32_t seed;
+        uint step_count;
+
+        // One line changed by the master, then everything compared
+        void set_line(bool scl_line, bool high)
+        {
+            if (diverged)
+                return;
+            step_count++;
+
+            uint64_t contentions = sim_contention_count();
+            hal_gpio_set_dir(scl_line ? I2C_SCL_PIN : I2C_SDA_PIN, high ? GPIO_IN : GPIO_OUT);
+            hal_sleep_us(1);
+
+            if (scl_line && high != master_scl)
+            {
+                master_scl = high;
+                if (high)
+                    model.scl_rise(sda);
+                else
+                    model.scl_fall();
+            }
+            else if (!scl_line)
+            {
+                master_sda = high;
+            }
+
+            bool was = sda;
+            sda = master_sda && !model.drive_low;
+            if (sda != was && master_scl)
+            {
+                if (sda)
+                    model.stop();
+                else
+                    model.start();
+            }
+
+            if (sim_net_get(SDA_NET) != sda)
+                report("SDA is %s, the model has it %s", sim_net_get(SDA_NET) ? "high" : "low", sda ? "high" : "low");
+            else if (sim_contention_count() != contentions)
+                report("a pin drove SDA high against a low");
+            else if (!(slave_log == model.log))
+                report("the slave's events differ from the model's");
+        }
+
+        // Now and then a line does something it should not
+        void line(bool scl_line, bool high)
+        {
+            if (chance(GLITCH_PERCENT))
+                set_line(next_random() & 1, next_random() & 1);
+            set_line(scl_line, high);
+        }
+
+        void start()
+        {
+            line(false, true);
+            line(true, true);
+            line(false, false);
+            line(true, false);
+        }
+
+        void stop()
+        {
+            line(false, false);
+            line(true, true);
+            line(false, true);
+        }
+
+        void clock(bool bit)
+        {
+            line(false, bit);
+            line(true, true);
+            line(true, false);
+        }
+
+        // SDA is let go for the slave's acknowledge
+        void write_byte(uint8_t byte)
+        {
+            for (int i = 7; i >= 0; i--)
+                clock((byte >> i) & 1);
+            clock(true);
+        }
+
+        void read_byte(bool acknowledge)
+        {
+            for (uint i = 0; i < 8; i++)
+                clock(true);
+            clock(!acknowledge);
+        }
+
+        void report(const char* format, const char* a = "", const char* b = "")
+        {
+            diverged = true;
+            printf("seed %lu step %u: ", (unsigned long)seed, step_count);
+            printf(format, a, b);
+            printf("\n");
+
+            size_t n = MAX(slave_log.size(), model.log.size());
+            for (size_t i = (n > 6) ? n - 6 : 0; i < n; i++)
+            {
+                auto print = [](const std::vector<logged_event>& log, size_t i) {
+                    if (i < log.size())
+                        printf("  %u/%u/%02x", log[i].event, log[i].byte_number, log[i].data);
+                    else
+                        printf("  -      ");
+                };
+                printf("  event %zu slave", i);
+                print(slave_log, i);
+                printf("  model");
+                print(model.log, i);
+                printf("\n");
+            }
+        }
+};
+
+int main(int argc, char** argv)
+{
+    uint seeds = (argc > 1) ? atoi(argv[1]) : 2000;
+    uint first_seed = (argc > 2) ? atoi(argv[2]) : 1;
+
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    sim_device_scope scope(master_device);
+    hal_gpio_init(I2C_SDA_PIN);
+    hal_gpio_init(I2C_SCL_PIN);
+    hal_gpio_put(I2C_SDA_PIN, false);
+    hal_gpio_put(I2C_SCL_PIN, false);
+
+    uint failures = 0;
+    for (uint seed = first_seed; seed < first_seed + seeds; seed++)
+    {
+        fuzz_run run(seed);
+        for (uint i = 0; i < TRANSACTIONS && !run.diverged; i++)
+            run.transaction();
+        run.finish();
+
+        // A diverged slave cannot be trusted to be back in step, stop at the first one
+        if (run.diverged)
+        {
+            failures++;
+            break;
+        }
+    }
+
+    if (failures)
+    {
+        printf("diverged from the model\n");
+        return 1;
+    }
+    printf("%u seeds of %u transactions without a divergence, %u reads ended by a NACK\n", seeds, TRANSACTIONS, model.nacked_reads);
+
+    // The slave leaves a NACKed read by going back to I2C_STATE_NULL, it must have been taken
+    if (model.nacked_reads == 0)
+    {
+        printf("no read was NACKed\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_slave_stats.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    The slave built with I2C_SOFTWARE_SLAVE_STATS. Every interrupt entry must be counted and land
+    in the histogram without a missed edge while the slave keeps up, and holding its interrupts
+    back for a whole byte must show up as missed edges. The counts are printed for 100 kHz.
+
+    Built twice, with the sdk's per pin callback and with the raw bank handler.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define TRANSFERS       200
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static uint received = 0;
+
+static void event_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        received++;
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 100000);
+
+    i2c_software_slave_reset_stats();
+    CHECK(i2c_software_slave_get_stats().calls == 0);
+
+    for (uint i = 0; i < TRANSFERS; i++)
+    {
+        uint8_t number = i;
+        i2c.write_bytes(I2C_ADDRESS, &number, 1);
+    }
+    CHECK(received == TRANSFERS);
+
+    i2c_software_slave_stats stats = i2c_software_slave_get_stats();
+    // The device also counts the slave's timeout alarm, which is not an edge
+    CHECK(stats.calls <= sim_device_irq_stats(slave_device).calls);
+    CHECK(stats.calls >= TRANSFERS * 18);
+    CHECK(stats.min_cycles <= stats.max_cycles);
+    CHECK(stats.total_cycles >= (uint64_t)stats.min_cycles * stats.calls);
+    CHECK(stats.missed_edges == 0);
+
+    uint32_t histogram_total = 0;
+    for (uint i = 0; i < I2C_SOFTWARE_SLAVE_STATS_BUCKETS; i++)
+        histogram_total += stats.histogram[i];
+    CHECK(histogram_total == stats.calls);
+
+    i2c_software_slave_print_stats(100000);
+
+    // The slave's interrupts held off for a whole byte, every pin ends up with both edges latched
+    i2c_software_slave_reset_stats();
+    sim_device_hold_irq(slave_device, true);
+    uint8_t number = 0x55;
+    i2c.write_bytes(I2C_ADDRESS, &number, 1);
+    sim_device_hold_irq(slave_device, false);
+
+    stats = i2c_software_slave_get_stats();
+    CHECK(stats.missed_edges > 0);
+    printf("%lu missed edges with the interrupt held for a byte\n", (unsigned long)stats.missed_edges);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+#include <vector>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_slave_t.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    The compile time slave template next to the runtime slave, both with raw bank interrupt
+    handlers on the same bus at different addresses. Each must take writes and answer reads
+    exactly like the other, then the host time their handlers took per edge is reported side
+    by side over the same traffic. That time is mostly the simulator's own and says little
+    about the pico, i2c_software/slave_template measures the cycles of both on the board.
+
+    usage: sim_i2c_slave_template [transfers]
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define PAYLOAD         32
+
+const uint8_t RUNTIME_ADDRESS = 0x42;
+const uint8_t TEMPLATE_ADDRESS = 0x43;
+
+struct slave_record {
+    std::vector<uint8_t> received;
+    uint starts = 0;
+    uint stops = 0;
+};
+
+static slave_record runtime_record;
+static slave_record template_record;
+
+static uint8_t reply(uint byte_number)
+{
+    return byte_number * 7 + 3;
+}
+
+static void record(slave_record& r, volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        r.starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        r.received.push_back((uint8_t)data);
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = reply(byte_number);
+        break;
+
+    case I2C_SLAVE_STOP:
+        r.stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void runtime_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    record(runtime_record, data, byte_number, event);
+}
+
+static void template_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    record(template_record, data, byte_number, event);
+}
+
+typedef i2c_software_slave_t<I2C_SDA_PIN, I2C_SCL_PIN, TEMPLATE_ADDRESS, &template_handler> template_slave;
+
+static double ns_per_edge(const sim_device* device)
+{
+    sim_irq_stats stats = sim_device_irq_stats(device);
+    return stats.calls ? double(stats.total_ns) / double(stats.calls) : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    uint transfers = (argc > 1) ? atoi(argv[1]) : 2000;
+
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device   = sim_device_create("master");
+    sim_device* runtime_device  = sim_device_create("runtime slave");
+    sim_device* template_device = sim_device_create("template slave");
+
+    for (sim_device* device : {master_device, runtime_device, template_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(runtime_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, RUNTIME_ADDRESS, &runtime_handler);
+    }
+
+    {
+        sim_device_scope scope(template_device);
+        template_slave::init();
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    uint8_t payload[PAYLOAD];
+    for (uint i = 0; i < PAYLOAD; i++)
+        payload[i] = i ^ 0x5a;
+
+    // The same write and read to each, only the addressed one may see the data
+    for (uint8_t address : {RUNTIME_ADDRESS, TEMPLATE_ADDRESS})
+    {
+        slave_record& addressed = (address == RUNTIME_ADDRESS) ? runtime_record : template_record;
+        slave_record& other = (address == RUNTIME_ADDRESS) ? template_record : runtime_record;
+
+        addressed.received.clear();
+        other.received.clear();
+        i2c_segment write[1] = {{payload, PAYLOAD, false}};
+        CHECK(i2c.transfer(address, write, 1));
+        CHECK(addressed.received == std::vector<uint8_t>(payload, payload + PAYLOAD));
+        CHECK(other.received.empty());
+
+        uint8_t reply_data[PAYLOAD] = {0};
+        i2c_segment read[1] = {{reply_data, PAYLOAD, true}};
+        CHECK(i2c.transfer(address, read, 1));
+        bool replied = true;
+        for (uint i = 0; i < PAYLOAD; i++)
+            replied &= reply_data[i] == reply(i);
+        CHECK(replied);
+    }
+
+    // Both see every START and STOP on the bus
+    CHECK(runtime_record.starts == 4 && template_record.starts == 4);
+    CHECK(runtime_record.stops == 4 && template_record.stops == 4);
+
+    // Both handle every edge of the same traffic, whichever is addressed
+    sim_device_reset_irq_stats(runtime_device);
+    sim_device_reset_irq_stats(template_device);
+    runtime_record.received.clear();
+    template_record.received.clear();
+
+    for (uint i = 0; i < transfers; i++)
+    {
+        uint8_t number = i;
+        i2c.write_bytes((i & 1) ? TEMPLATE_ADDRESS : RUNTIME_ADDRESS, &number, 1);
+    }
+    CHECK(runtime_record.received.size() == transfers / 2);
+    CHECK(template_record.received.size() == transfers - transfers / 2);
+
+    double runtime_ns = ns_per_edge(runtime_device);
+    double template_ns = ns_per_edge(template_device);
+    printf("runtime slave  %8.1f ns/edge\n", runtime_ns);
+    printf("template slave %8.1f ns/edge (%.0f%% of the runtime slave)\n", template_ns,
+           runtime_ns > 0 ? template_ns / runtime_ns * 100 : 0.0);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    A master that goes away in the middle of a transfer, once while the slave is sending a 0 and
+    once while it acknowledges, both times leaving the slave holding SDA low. The slave's timeout
+    must let go of the bus within two periods, end the transfer with a STOP for the application
+    and count a recovery, after which a normal transfer must work. A slow transfer that keeps
+    moving and an idle bus must never be timed out.
+
+    Built twice, with the sdk's per pin callback and with the raw bank handler.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define HALF_BIT_US     5
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static uint starts = 0;
+static uint stops = 0;
+static uint received = 0;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        received++;
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = 0x00;
+        break;
+
+    case I2C_SLAVE_STOP:
+        stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// A master bit banged by hand so it can stop anywhere, high lets go of the line and low pulls it
+static void line(uint pin, bool high)
+{
+    hal_gpio_set_dir(pin, high ? GPIO_IN : GPIO_OUT);
+    hal_sleep_us(HALF_BIT_US);
+}
+
+static void clock_bit(bool bit)
+{
+    line(I2C_SDA_PIN, bit);
+    line(I2C_SCL_PIN, true);
+    line(I2C_SCL_PIN, false);
+}
+
+// START and the address byte, SCL is left low after the last address bit
+static void start_address(bool read)
+{
+    line(I2C_SDA_PIN, true);
+    line(I2C_SCL_PIN, true);
+    line(I2C_SDA_PIN, false);
+    line(I2C_SCL_PIN, false);
+    uint8_t byte = (I2C_ADDRESS << 1) | read;
+    for (int i = 7; i >= 0; i--)
+        clock_bit((byte >> i) & 1);
+    line(I2C_SDA_PIN, true);
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    sim_device_scope scope(master_device);
+    hal_gpio_init(I2C_SDA_PIN);
+    hal_gpio_init(I2C_SCL_PIN);
+    hal_gpio_put(I2C_SDA_PIN, false);
+    hal_gpio_put(I2C_SCL_PIN, false);
+
+    // Gone while the slave sends a 0: the acknowledge and two bits of the byte, then SCL stays low
+    start_address(true);
+    clock_bit(true);
+    clock_bit(true);
+    clock_bit(true);
+    CHECK(!sim_net_get(SDA_NET));
+    CHECK(starts == 1);
+
+    hal_sleep_us(I2C_SOFTWARE_SLAVE_TIMEOUT_US / 2);
+    CHECK(!sim_net_get(SDA_NET));
+    CHECK(i2c_software_slave_get_recoveries() == 0);
+
+    hal_sleep_us(2 * I2C_SOFTWARE_SLAVE_TIMEOUT_US);
+    CHECK(sim_net_get(SDA_NET));
+    CHECK(i2c_software_slave_get_recoveries() == 1);
+    CHECK(stops == 1);
+
+    // Gone with the slave acknowledging the address of a write
+    start_address(false);
+    CHECK(!sim_net_get(SDA_NET));
+    CHECK(starts == 2);
+
+    hal_sleep_us(2 * I2C_SOFTWARE_SLAVE_TIMEOUT_US);
+    CHECK(sim_net_get(SDA_NET));
+    CHECK(i2c_software_slave_get_recoveries() == 2);
+    CHECK(stops == 2);
+
+    // The master is back, SCL released first so the engine below starts from an idle bus
+    line(I2C_SCL_PIN, true);
+    line(I2C_SDA_PIN, true);
+
+    // 10 kHz and 64 bytes is longer than the timeout, it must not be cut short while it moves
+    {
+        i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 10000);
+        uint8_t payload[64] = {0};
+        i2c_segment write[1] = {{payload, sizeof(payload), false}};
+        uint64_t begin_us = hal_time_us_64();
+        CHECK(i2c.transfer(I2C_ADDRESS, write, 1));
+        CHECK(hal_time_us_64() - begin_us > I2C_SOFTWARE_SLAVE_TIMEOUT_US);
+    }
+    CHECK(received == 64);
+    CHECK(stops == 3);
+
+    // Idle after a STOP
+    hal_sleep_us(4 * I2C_SOFTWARE_SLAVE_TIMEOUT_US);
+    CHECK(i2c_software_slave_get_recoveries() == 2);
+    CHECK(stops == 3);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+/*
+    One slave answering to 24 addresses on a single pair of pins, each address with its own
+    register bank. Every address must take its writes and answer its reads without touching the
+    others, the scan must find all of them and nothing else, and the decoder must take exactly
+    as many interrupts as a slave with one address on the same bus.
+
+    Built twice, with the sdk's per pin callback and with the raw bank handler.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+// The single address slave is a different decoder, so on its own pins wired to the same bus
+#define SINGLE_SDA_PIN  6u
+#define SINGLE_SCL_PIN  7u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define FIRST_ADDRESS   0x10
+#define VIRTUAL_SLAVES  24
+#define SINGLE_ADDRESS  0x50
+#define REGISTERS       8
+#define TRANSFERS       200
+
+static volatile uint8_t registers[VIRTUAL_SLAVES][REGISTERS];
+static i2c_register_bank* banks[VIRTUAL_SLAVES];
+
+static uint single_received = 0;
+
+static void single_handler(volatile uint8_t& /* data */, const uint byte_number, const i2c_software_slave_event event)
+{
+    (void)byte_number;
+    if (event == I2C_SLAVE_RECEIVE)
+        single_received++;
+}
+
+static uint8_t pattern(uint slave, uint i)
+{
+    return (slave << 4) ^ (i * 3 + 1);
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device  = sim_device_create("master");
+    sim_device* virtual_device = sim_device_create("virtual slaves");
+    sim_device* single_device  = sim_device_create("single slave");
+
+    sim_device_wire(master_device, I2C_SDA_PIN, SDA_NET);
+    sim_device_wire(master_device, I2C_SCL_PIN, SCL_NET);
+    sim_device_wire(virtual_device, I2C_SDA_PIN, SDA_NET);
+    sim_device_wire(virtual_device, I2C_SCL_PIN, SCL_NET);
+    sim_device_wire(single_device, SINGLE_SDA_PIN, SDA_NET);
+    sim_device_wire(single_device, SINGLE_SCL_PIN, SCL_NET);
+
+    {
+        sim_device_scope scope(virtual_device);
+        for (uint i = 0; i < VIRTUAL_SLAVES; i++)
+        {
+            banks[i] = new i2c_register_bank(registers[i], REGISTERS);
+            i2c_software_slave_init_register_bank(I2C_SDA_PIN, I2C_SCL_PIN, FIRST_ADDRESS + i, banks[i]);
+        }
+    }
+
+    {
+        sim_device_scope scope(single_device);
+        i2c_software_slave_init(SINGLE_SDA_PIN, SINGLE_SCL_PIN, SINGLE_ADDRESS, &single_handler);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    // Register 0 on, a different pattern for every address
+    for (uint slave = 0; slave < VIRTUAL_SLAVES; slave++)
+    {
+        uint8_t message[REGISTERS + 1] = {0};
+        for (uint i = 0; i < REGISTERS; i++)
+            message[i + 1] = pattern(slave, i);
+        i2c_segment write[1] = {{message, REGISTERS + 1, false}};
+        CHECK(i2c.transfer(FIRST_ADDRESS + slave, write, 1));
+    }
+
+    bool stored = true;
+    for (uint slave = 0; slave < VIRTUAL_SLAVES; slave++)
+    {
+        for (uint i = 0; i < REGISTERS; i++)
+            stored &= registers[slave][i] == pattern(slave, i);
+    }
+    CHECK(stored);
+
+    // Read back from the middle of each bank
+    bool replied = true;
+    for (uint slave = 0; slave < VIRTUAL_SLAVES; slave++)
+    {
+        uint8_t select = 4;
+        uint8_t reply[4] = {0};
+        CHECK(i2c.write_read(FIRST_ADDRESS + slave, &select, 1, reply, 4));
+        for (uint i = 0; i < 4; i++)
+            replied &= reply[i] == pattern(slave, 4 + i);
+    }
+    CHECK(replied);
+
+    i2c_scan_result result = i2c.scan();
+    bool scanned = true;
+    for (uint address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++)
+    {
+        bool expected = (address >= FIRST_ADDRESS && address < FIRST_ADDRESS + VIRTUAL_SLAVES) || address == SINGLE_ADDRESS;
+        scanned &= i2c_scan_found(&result, address) == expected;
+    }
+    CHECK(scanned);
+
+    // The same traffic costs the 24 address decoder as many interrupts as the one address slave
+    sim_device_reset_irq_stats(virtual_device);
+    sim_device_reset_irq_stats(single_device);
+    single_received = 0;
+
+    for (uint i = 0; i < TRANSFERS; i++)
+    {
+        uint8_t message[2] = {0, (uint8_t)i};
+        uint8_t address = (i % 2) ? SINGLE_ADDRESS : FIRST_ADDRESS + (i / 2) % VIRTUAL_SLAVES;
+        i2c_segment write[1] = {{message, 2, false}};
+        CHECK(i2c.transfer(address, write, 1));
+    }
+    CHECK(single_received == TRANSFERS);
+
+    sim_irq_stats virtual_stats = sim_device_irq_stats(virtual_device);
+    sim_irq_stats single_stats = sim_device_irq_stats(single_device);
+    CHECK(virtual_stats.calls == single_stats.calls);
+
+    printf("%d addresses %8.1f ns/edge, 1 address %8.1f ns/edge\n", VIRTUAL_SLAVES,
+           double(virtual_stats.total_ns) / virtual_stats.calls, double(single_stats.total_ns) / single_stats.calls);
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
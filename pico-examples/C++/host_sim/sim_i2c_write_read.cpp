@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <initializer_list>
+
+#include "io_hal.h"
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_master_lib.h"
+#include "sim_check.h"
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+#include "pio_sim.h"
+#endif
+
+/*
+    Combined transactions against a register map slave: the first byte written sets the register
+    pointer, later bytes are written from it and reads carry on from it. A register read is one
+    transaction, the pointer write then a repeated START into the read, and scattered buffers
+    go out and come back as if they were one.
+
+    Built twice, bit banged against the GPIO interrupt slave and with the PIO master against the
+    PIO slave.
+*/
+
+#define I2C_SDA_PIN     4u
+#define I2C_SCL_PIN     5u
+
+#define SDA_NET         0u
+#define SCL_NET         1u
+
+#define REGISTERS       32
+
+const uint8_t I2C_ADDRESS = 0x42;
+const uint8_t MISSING_ADDRESS = 0x43;
+
+static uint8_t registers[REGISTERS];
+static uint8_t pointer = 0;
+static uint starts = 0;
+static uint stops = 0;
+
+static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_START:
+        starts++;
+        break;
+
+    case I2C_SLAVE_RECEIVE:
+        if (byte_number == 1)
+            pointer = data % REGISTERS;
+        else
+            registers[pointer++ % REGISTERS] = data;
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = registers[pointer++ % REGISTERS];
+        break;
+
+    case I2C_SLAVE_STOP:
+        stops++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static bool bus_free()
+{
+    return hal_gpio_get(I2C_SDA_PIN) && hal_gpio_get(I2C_SCL_PIN);
+}
+
+int main()
+{
+    sim_set_trace(getenv("SIM_TRACE") != nullptr);
+
+    sim_device* master_device = sim_device_create("master");
+    sim_device* slave_device  = sim_device_create("slave");
+
+    for (sim_device* device : {master_device, slave_device})
+    {
+        sim_device_wire(device, I2C_SDA_PIN, SDA_NET);
+        sim_device_wire(device, I2C_SCL_PIN, SCL_NET);
+    }
+
+    for (uint i = 0; i < REGISTERS; i++)
+        registers[i] = i * 3 + 1;
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+    sim_pio_attach(pio0, slave_device);
+    sim_pio_attach(pio1, master_device);
+#endif
+
+    {
+        sim_device_scope scope(slave_device);
+        i2c_software_slave_init(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &event_handler);
+    }
+
+    sim_device_scope scope(master_device);
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    // Register read: START, pointer, repeated START, four bytes, STOP
+    uint8_t reg = 5;
+    uint8_t rx[4] = {0};
+    CHECK(i2c.write_read(I2C_ADDRESS, &reg, 1, rx, sizeof(rx)));
+    CHECK(memcmp(rx, &registers[5], sizeof(rx)) == 0);
+    CHECK(starts == 2);
+    CHECK(stops == 1);
+    CHECK(bus_free());
+
+    // Gathered write, the pointer and two payload buffers in one phase
+    uint8_t a[3] = {0xa0, 0xa1, 0xa2};
+    uint8_t b[2] = {0xb0, 0xb1};
+    reg = 10;
+    i2c_segment write[3] = {
+        {&reg, 1, false},
+        {a, sizeof(a), false},
+        {b, sizeof(b), false},
+    };
+    CHECK(i2c.transfer(I2C_ADDRESS, write, 3));
+    CHECK(memcmp(&registers[10], a, sizeof(a)) == 0);
+    CHECK(memcmp(&registers[13], b, sizeof(b)) == 0);
+    CHECK(starts == 3);
+    CHECK(stops == 2);
+
+    // Scattered read of the same registers, only the last byte of the phase is not acknowledged
+    uint8_t x[2] = {0};
+    uint8_t y[3] = {0};
+    i2c_segment read[3] = {
+        {&reg, 1, false},
+        {x, sizeof(x), true},
+        {y, sizeof(y), true},
+    };
+    CHECK(i2c.transfer(I2C_ADDRESS, read, 3));
+    CHECK(x[0] == a[0] && x[1] == a[1]);
+    CHECK(y[0] == a[2] && y[1] == b[0] && y[2] == b[1]);
+    CHECK(starts == 5);
+    CHECK(stops == 3);
+    CHECK(bus_free());
+
+    // Nothing to send, or a read with no byte to leave unacknowledged, never reaches the bus
+    i2c_segment empty_read[2] = {
+        {&reg, 1, false},
+        {x, 0, true},
+    };
+    CHECK(!i2c.transfer(I2C_ADDRESS, read, 0));
+    CHECK(!i2c.transfer(I2C_ADDRESS, empty_read, 2));
+    CHECK(!i2c.read_bytes(I2C_ADDRESS, x, 0));
+    CHECK(starts == 5);
+    CHECK(stops == 3);
+
+    // Nobody at the address, reported and the bus left free for the next transaction
+    CHECK(!i2c.write_read(MISSING_ADDRESS, &reg, 1, rx, sizeof(rx)));
+    CHECK(bus_free());
+    reg = 0;
+    CHECK(i2c.write_read(I2C_ADDRESS, &reg, 1, rx, sizeof(rx)));
+    CHECK(memcmp(rx, &registers[0], sizeof(rx)) == 0);
+    CHECK(bus_free());
+
+    printf("%u starts, %u stops, %llu us simulated\n", starts, stops, (unsigned long long)(sim_time_ns() / 1000));
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+
+#include "io_hal.h"
+#include "led_bar.h"
+#include "sim_check.h"
+
+/*
+    The LED bars of the arcade boards on a simulated device. Every bit of a value must land on
+    its own pin, for a bar on one run of pins and for the scrambled ones of the button master and
+    the state leds, and pins outside the bar must keep whatever they were set to.
+*/
+
+// Pin map of the arcade button module data leds and of the button master module
+using run_leds = led_bar<6, 7, 8, 9, 10, 11, 12, 13>;
+using scrambled_leds = led_bar<17, 16, 15, 14, 21, 20, 19, 18>;
+using state_leds = led_bar<19, 20, 18, 21, 14, 16, 15>;
+
+static_assert(run_leds::MASK == 0x3fc0u, "a run of eight from pin 6");
+static_assert(run_leds::levels(0xa5) == 0xa5u << 6, "a run is a shift");
+static_assert(run_leds::levels(0x1ff) == run_leds::MASK, "bits past the last led are dropped");
+static_assert(scrambled_leds::MASK == 0x3fc000u, "pins 14 to 21");
+static_assert(scrambled_leds::levels(0x01) == 1u << 17, "bit 0 on the first pin");
+static_assert(scrambled_leds::levels(0x10) == 1u << 21, "bit 4 on the fifth pin");
+
+// A pin a bar does not own, driven high before and checked after
+#define OTHER_PIN 5
+
+// The level of each pin of a bar, read back from the device
+template <typename BAR>
+static uint32_t read_back()
+{
+    uint32_t levels = hal_gpio_get_all();
+    uint32_t value = 0;
+    for (uint i = 0; i < BAR::COUNT; i++)
+        value |= ((levels >> BAR::PIN[i]) & 1u) << i;
+    return value;
+}
+
+template <typename BAR>
+static void check_bar()
+{
+    BAR::init();
+    CHECK(read_back<BAR>() == 0);
+
+    for (uint32_t value = 0; value < (1u << BAR::COUNT); value++)
+    {
+        BAR::show(value);
+        if (read_back<BAR>() != value)
+        {
+            printf("FAIL shown %03x, read back %03x\n", value, read_back<BAR>());
+            failures++;
+            break;
+        }
+    }
+
+    BAR::show(0);
+    CHECK(read_back<BAR>() == 0);
+    CHECK(hal_gpio_get(OTHER_PIN));
+}
+
+int main()
+{
+    sim_device* board = sim_device_create("board");
+    sim_device_scope scope(board);
+
+    hal_gpio_init(OTHER_PIN);
+    hal_gpio_put(OTHER_PIN, true);
+    hal_gpio_set_dir(OTHER_PIN, true);
+
+    check_bar<run_leds>();
+    check_bar<scrambled_leds>();
+    check_bar<state_leds>();
+
+    if (failures)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -4,60 +4,16 @@
 #include "hardware/gpio.h"
 
 #include "i2c_software_slave_lib.h"
+#include "led_bar.h"
 
 // I2C arcade demo, allows the user to act as master using two buttons and shows the output to 8 led's
 
-// LED Pins
-#define LED_PIN_0 0
-#define LED_PIN_1 1
-#define LED_PIN_2 2
-#define LED_PIN_3 3
-#define LED_PIN_4 4
-#define LED_PIN_5 5
-#define LED_PIN_6 6
-#define LED_PIN_7 7
-
-// init led pins
-void init_leds()
-{
-    gpio_init(LED_PIN_0);
-    gpio_init(LED_PIN_1);
-    gpio_init(LED_PIN_2);
-    gpio_init(LED_PIN_3);
-    gpio_init(LED_PIN_4);
-    gpio_init(LED_PIN_5);
-    gpio_init(LED_PIN_6);
-    gpio_init(LED_PIN_7);
-
-    gpio_set_dir(LED_PIN_0, GPIO_OUT);
-    gpio_set_dir(LED_PIN_1, GPIO_OUT);
-    gpio_set_dir(LED_PIN_2, GPIO_OUT);
-    gpio_set_dir(LED_PIN_3, GPIO_OUT);
-    gpio_set_dir(LED_PIN_4, GPIO_OUT);
-    gpio_set_dir(LED_PIN_5, GPIO_OUT);
-    gpio_set_dir(LED_PIN_6, GPIO_OUT);
-    gpio_set_dir(LED_PIN_7, GPIO_OUT);
-
-    gpio_put(LED_PIN_0, 0);
-    gpio_put(LED_PIN_1, 0);
-    gpio_put(LED_PIN_2, 0);
-    gpio_put(LED_PIN_3, 0);
-    gpio_put(LED_PIN_4, 0);
-    gpio_put(LED_PIN_5, 0);
-    gpio_put(LED_PIN_6, 0);
-    gpio_put(LED_PIN_7, 0);
-}
+// LED pins, bit 0 to bit 7
+using leds = led_bar<0, 1, 2, 3, 4, 5, 6, 7>;
 
 void set_leds(const uint8_t value)
 {
-    gpio_put(LED_PIN_0, (value & 0x01));
-    gpio_put(LED_PIN_1, (value & 0x02));
-    gpio_put(LED_PIN_2, (value & 0x04));
-    gpio_put(LED_PIN_3, (value & 0x08));
-    gpio_put(LED_PIN_4, (value & 0x10));
-    gpio_put(LED_PIN_5, (value & 0x20));
-    gpio_put(LED_PIN_6, (value & 0x40));
-    gpio_put(LED_PIN_7, (value & 0x80));
+    leds::show(value);
 }
 
 // Button pins
@@ -69,6 +25,16 @@ void set_leds(const uint8_t value)
 
 static uint8_t data_received = 150;
 
+// Byte the next read by the master gets, kept ready for the interrupt by the main loop
+static volatile uint8_t reply = 150 * 2;
+
+// Runs in the interrupt, only hands over the byte that is already worked out
+void request_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    data = reply;
+}
+
+// Runs from the main loop, printing and the leds take far longer than a bit of the bus
 void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
 {
     switch (event)
@@ -81,10 +47,10 @@ void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_sof
             printf("I2C RECEIVE %02x\n", data);
             set_leds(data);
             data_received = data;
+            reply = data_received * 2;
             break;
         case I2C_SLAVE_REQUEST:
-            printf("I2C REQUEST %02x\n", data_received*2);
-            data = data_received * 2;
+            printf("I2C REQUEST %02x\n", data);
             set_leds(data);
             break;
         case I2C_SLAVE_STOP:
@@ -95,6 +61,8 @@ void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_sof
     }
 }
 
+static i2c_slave_event_queue events(&event_handler, &request_handler);
+
 int main()
 {
     stdio_init_all();
@@ -104,14 +72,21 @@ int main()
     printf("I2C Arcade Demo\n");
     
     // Init leds
-    init_leds();
+    leds::init();
 
     // Init i2c with buttons
-    i2c_software_slave_init(SDA_BUTTON_PIN, SCL_BUTTON_PIN, I2C_SLAVE_ADDRESS, &event_handler);
+    i2c_software_slave_init_deferred(SDA_BUTTON_PIN, SCL_BUTTON_PIN, I2C_SLAVE_ADDRESS, &events);
 
+    uint32_t overflows = 0;
     while (true)
     {
-        // loop code
+        events.dispatch();
+
+        if (events.overflows() != overflows)
+        {
+            overflows = events.overflows();
+            printf("I2C %u events lost\n", overflows);
+        }
     }
 
 }
\ No newline at end of file
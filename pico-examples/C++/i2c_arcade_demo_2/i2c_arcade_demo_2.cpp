@@ -3,17 +3,12 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 
+#include "led_bar.h"
 
 
-// LED Pins
-#define LED_PIN_0 0
-#define LED_PIN_1 1
-#define LED_PIN_2 2
-#define LED_PIN_3 3
-#define LED_PIN_4 4
-#define LED_PIN_5 5
-#define LED_PIN_6 6
-#define LED_PIN_7 7
+
+// LED pins, bit 0 to bit 7
+using leds = led_bar<0, 1, 2, 3, 4, 5, 6, 7>;
 
 // Button pins
 #define SDA_BUTTON_PIN 26
@@ -28,46 +23,9 @@
 // the SCL LED will show the current state of the clock
 // they have control over a button to modify SDA when its released
 
-void init_leds()
-{
-    gpio_init(LED_PIN_0);
-    gpio_init(LED_PIN_1);
-    gpio_init(LED_PIN_2);
-    gpio_init(LED_PIN_3);
-    gpio_init(LED_PIN_4);
-    gpio_init(LED_PIN_5);
-    gpio_init(LED_PIN_6);
-    gpio_init(LED_PIN_7);    
-
-    gpio_set_dir(LED_PIN_0, GPIO_OUT);
-    gpio_set_dir(LED_PIN_1, GPIO_OUT);
-    gpio_set_dir(LED_PIN_2, GPIO_OUT);
-    gpio_set_dir(LED_PIN_3, GPIO_OUT);
-    gpio_set_dir(LED_PIN_4, GPIO_OUT);
-    gpio_set_dir(LED_PIN_5, GPIO_OUT);
-    gpio_set_dir(LED_PIN_6, GPIO_OUT);
-    gpio_set_dir(LED_PIN_7, GPIO_OUT);
-
-    gpio_put(LED_PIN_0, 0);
-    gpio_put(LED_PIN_1, 0);
-    gpio_put(LED_PIN_2, 0);
-    gpio_put(LED_PIN_3, 0);
-    gpio_put(LED_PIN_4, 0);
-    gpio_put(LED_PIN_5, 0);
-    gpio_put(LED_PIN_6, 0);
-    gpio_put(LED_PIN_7, 0);
-}
-
 void set_leds(const uint8_t value)
 {
-    gpio_put(LED_PIN_0, (value & 0x01));
-    gpio_put(LED_PIN_1, (value & 0x02));
-    gpio_put(LED_PIN_2, (value & 0x04));
-    gpio_put(LED_PIN_3, (value & 0x08));
-    gpio_put(LED_PIN_4, (value & 0x10));
-    gpio_put(LED_PIN_5, (value & 0x20));
-    gpio_put(LED_PIN_6, (value & 0x40));
-    gpio_put(LED_PIN_7, (value & 0x80));
+    leds::show(value);
 }
 
 
@@ -333,7 +291,7 @@ int main()
     printf("I2C Arcade Demo\n");
     
     // Init leds
-    init_leds();
+    leds::init();
 
     // Init i2c with button
     i2c_software i2c(SDA_BUTTON_PIN, SCL_LED_PIN, 1);
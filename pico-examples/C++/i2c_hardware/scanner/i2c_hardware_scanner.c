@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+
+#include "i2c_scan.h"
+
+/*
+    Bus scanner using the hardware i2c module, prints every address that answers once a second.
+
+    The hardware cannot send an address on its own, so each probe is a one byte read: a missing
+    device stops it after the address byte.
+*/
+
+#define I2C				i2c0
+#define I2C_SDA_PIN 	4
+#define I2C_SCL_PIN 	5
+
+// Long enough for a byte at 400 kHz, even with some clock stretching
+#define PROBE_TIMEOUT_US    1000
+
+static i2c_scan_result scan()
+{
+    i2c_scan_result result = {0};
+    uint8_t data;
+
+    for (uint8_t address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++)
+    {
+        if (i2c_read_timeout_us(I2C, address, &data, 1, false, PROBE_TIMEOUT_US) >= 0)
+            i2c_scan_set(&result, address);
+    }
+    return result;
+}
+
+int main() {
+    stdio_init_all();
+    sleep_ms(2000);
+    printf("I2C Scanner\n");
+
+    // Setup hardware i2c communication
+    i2c_init(I2C, 400000);
+    gpio_set_function(I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(I2C_SDA_PIN);
+    gpio_pull_up(I2C_SCL_PIN);
+
+    // main loop
+    while (true)
+    {
+        uint64_t start = time_us_64();
+        i2c_scan_result result = scan();
+        uint64_t duration = time_us_64() - start;
+
+        i2c_scan_print(&result);
+        printf("Scanned in %llu us\n\n", duration);
+
+        sleep_ms(1000);
+    }
+
+    return 0;
+}
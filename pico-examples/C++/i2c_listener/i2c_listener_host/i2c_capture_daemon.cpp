@@ -0,0 +1,65 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "i2c_capture_host.h"
+
+/*
+    Captures the listener's stream into a memory mapped file until the device goes away or the
+    daemon is interrupted. Sleeps in poll() while the bus is quiet.
+
+    usage: i2c_capture_daemon <tty> <capture file> [entries kept]
+*/
+
+#define DEFAULT_CAPACITY    (1u << 20)
+#define POLL_TIMEOUT_MS     500
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int signal)
+{
+    (void)signal;
+    running = 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <tty> <capture file> [entries kept]\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t capacity = (argc > 3) ? strtoull(argv[3], nullptr, 0) : DEFAULT_CAPACITY;
+
+    i2c_capture* capture = i2c_capture_open(argv[1], argv[2], capacity);
+    if (capture == nullptr)
+    {
+        fprintf(stderr, "could not start capture: %s\n", strerror(errno));
+        return 1;
+    }
+
+    signal(SIGINT, &stop);
+    signal(SIGTERM, &stop);
+
+    int result = 0;
+    while (running)
+    {
+        if (i2c_capture_poll(capture, POLL_TIMEOUT_MS) < 0)
+        {
+            fprintf(stderr, "device: %s\n", strerror(errno));
+            result = 1;
+            break;
+        }
+    }
+
+    printf("%llu records, %llu dropped by the device, %llu bytes skipped\n",
+           (unsigned long long)i2c_capture_count(capture),
+           (unsigned long long)i2c_capture_dropped(capture),
+           (unsigned long long)i2c_capture_skipped(capture));
+
+    i2c_capture_close(capture);
+    return result;
+}
@@ -0,0 +1,209 @@
+#include "i2c_capture_host.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "i2c_capture_format.h"
+
+static_assert(sizeof(i2c_capture_entry) == 16, "capture entries are read from the file by other languages");
+static_assert(sizeof(i2c_capture_file_header) == 48, "capture header is read from the file by other languages");
+
+#define READ_SIZE 4096
+
+struct i2c_capture
+{
+    int device = -1;
+    int file = -1;
+
+    i2c_capture_file_header* header = nullptr;
+    i2c_capture_entry* entries = nullptr;
+    size_t mapped_size = 0;
+
+    i2c_capture_decoder decoder;
+};
+
+// Raw bytes, no echo or line editing, the stream is binary
+static int set_raw(int fd)
+{
+    if (!isatty(fd))
+        return 0;
+
+    struct termios settings;
+    if (tcgetattr(fd, &settings) < 0)
+        return -1;
+    cfmakeraw(&settings);
+    return tcsetattr(fd, TCSANOW, &settings);
+}
+
+// First entry number still kept once count entries have been written
+static uint64_t oldest_kept(uint64_t count, uint64_t capacity)
+{
+    return (count >= capacity) ? count - capacity + 1 : 0;
+}
+
+static int store(i2c_capture* capture, const uint8_t* bytes, uint64_t length)
+{
+    i2c_capture_file_header* header = capture->header;
+    uint64_t count = header->count;
+    uint64_t first = count;
+    uint64_t dropped = header->dropped;
+
+    capture->decoder.feed(bytes, length, [&](const i2c_capture_record& record) {
+        // The count published last goes out before the slot of entry count - capacity changes
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        i2c_capture_entry& entry = capture->entries[count % header->capacity];
+        entry.time_us = record.time_us;
+        entry.dropped = record.dropped;
+        entry.type = record.type;
+        entry.value = record.value;
+        entry.acknowledged = record.acknowledged;
+        entry.reserved = 0;
+
+        dropped += record.dropped;
+        count++;
+
+        // Readers of the file trust entries below count
+        __atomic_store_n(&header->count, count, __ATOMIC_RELEASE);
+    });
+
+    header->skipped = capture->decoder.get_skipped();
+    header->dropped = dropped;
+    return (int)(count - first);
+}
+
+i2c_capture* i2c_capture_open(const char* device_path, const char* capture_path, uint64_t capacity)
+{
+    if (capacity == 0)
+    {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    i2c_capture* capture = new i2c_capture;
+
+    if (device_path)
+    {
+        capture->device = open(device_path, O_RDONLY | O_NOCTTY | O_CLOEXEC);
+        if (capture->device < 0 || set_raw(capture->device) < 0)
+            goto fail;
+    }
+
+    capture->file = open(capture_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (capture->file < 0)
+        goto fail;
+
+    // One more slot for the entry being written
+    capacity++;
+    capture->mapped_size = sizeof(i2c_capture_file_header) + capacity * sizeof(i2c_capture_entry);
+    if (ftruncate(capture->file, capture->mapped_size) < 0)
+        goto fail;
+
+    {
+        void* mapped = mmap(nullptr, capture->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, capture->file, 0);
+        if (mapped == MAP_FAILED)
+            goto fail;
+
+        capture->header = (i2c_capture_file_header*)mapped;
+        capture->entries = (i2c_capture_entry*)(capture->header + 1);
+    }
+
+    memcpy(capture->header->magic, I2C_CAPTURE_FILE_MAGIC, sizeof(capture->header->magic));
+    capture->header->version = I2C_CAPTURE_FILE_VERSION;
+    capture->header->entry_size = sizeof(i2c_capture_entry);
+    capture->header->capacity = capacity;
+    return capture;
+
+fail:
+    int error = errno;
+    i2c_capture_close(capture);
+    errno = error;
+    return nullptr;
+}
+
+int i2c_capture_poll(i2c_capture* capture, int timeout_ms)
+{
+    if (capture->device < 0)
+    {
+        errno = EBADF;
+        return -1;
+    }
+
+    struct pollfd fd = {capture->device, POLLIN, 0};
+    int ready = poll(&fd, 1, timeout_ms);
+    if (ready < 0)
+        return (errno == EINTR) ? 0 : -1;
+    if (ready == 0)
+        return 0;
+
+    uint8_t bytes[READ_SIZE];
+    ssize_t length = read(capture->device, bytes, sizeof(bytes));
+    if (length < 0)
+        return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+
+    // Unplugged, a tty reports end of file or EIO once the other end has gone
+    if (length == 0)
+    {
+        errno = ENODEV;
+        return -1;
+    }
+
+    return store(capture, bytes, length);
+}
+
+int i2c_capture_feed(i2c_capture* capture, const uint8_t* bytes, uint64_t length)
+{
+    return store(capture, bytes, length);
+}
+
+uint64_t i2c_capture_count(const i2c_capture* capture)
+{
+    return __atomic_load_n(&capture->header->count, __ATOMIC_ACQUIRE);
+}
+
+uint64_t i2c_capture_skipped(const i2c_capture* capture)
+{
+    return capture->header->skipped;
+}
+
+uint64_t i2c_capture_dropped(const i2c_capture* capture)
+{
+    return capture->header->dropped;
+}
+
+uint64_t i2c_capture_read(const i2c_capture* capture, uint64_t first, i2c_capture_entry* entries, uint64_t max)
+{
+    uint64_t count = i2c_capture_count(capture);
+    uint64_t capacity = capture->header->capacity;
+    if (first < oldest_kept(count, capacity) || first >= count)
+        return 0;
+
+    uint64_t copied = 0;
+    for (uint64_t n = first; n < count && copied < max; n++)
+        entries[copied++] = capture->entries[n % capacity];
+
+    // The writer may have moved on meanwhile and be writing over what was copied
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (first < oldest_kept(__atomic_load_n(&capture->header->count, __ATOMIC_RELAXED), capacity))
+        return 0;
+    return copied;
+}
+
+void i2c_capture_close(i2c_capture* capture)
+{
+    if (capture == nullptr)
+        return;
+
+    if (capture->header)
+        munmap(capture->header, capture->mapped_size);
+    if (capture->file >= 0)
+        close(capture->file);
+    if (capture->device >= 0)
+        close(capture->device);
+    delete capture;
+}
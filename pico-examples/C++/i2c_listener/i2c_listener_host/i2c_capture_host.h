@@ -0,0 +1,83 @@
+#ifndef I2C_CAPTURE_HOST_H
+#define I2C_CAPTURE_HOST_H
+
+#include <stdint.h>
+
+/*
+    Host side of the listener: reads the capture stream from the listener's CDC tty, splits it back
+    into records (see lib/i2c_listener/i2c_capture_format.h) and keeps the latest ones in a memory
+    mapped capture file that other processes can read while it is being written.
+
+    Capture file layout, native byte order:
+
+        i2c_capture_file_header
+        i2c_capture_entry[capacity]     entry n is kept at index n % capacity
+
+    count in the header is raised once per entry, after the entry is written and before the next
+    one overwrites the slot of entry count - capacity. The file has one slot more than the entries
+    it keeps for the entry being written, so entries count - capacity + 1 up to count - 1 are the
+    ones kept. A reader in another process takes count, copies the entries it wants, then takes
+    count again: anything it copied that is no longer kept by the second count may have changed
+    under it and is thrown away. i2c_capture_read does the same.
+
+    Plain C so the Python UI can load it with ctypes.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_CAPTURE_FILE_MAGIC      "I2CCAPT"
+#define I2C_CAPTURE_FILE_VERSION    2
+
+typedef struct {
+    uint64_t time_us;           // device time_us_64
+    uint32_t dropped;           // OVERFLOW, records the device could not send
+    uint8_t type;               // i2c_capture_record_type
+    uint8_t value;              // ADDRESS and DATA
+    uint8_t acknowledged;       // ADDRESS and DATA
+    uint8_t reserved;
+} i2c_capture_entry;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t capacity;          // slots, one more than the entries kept
+    uint64_t count;             // entries written since the file was created
+    uint64_t skipped;           // stream bytes thrown away while resynchronising
+    uint64_t dropped;           // records the device reported dropped
+} i2c_capture_file_header;
+
+typedef struct i2c_capture i2c_capture;
+
+/// @brief start a capture
+/// @param device_path the listener's tty, NULL to only take bytes through i2c_capture_feed
+/// @param capture_path file to create, replaced if it exists
+/// @param capacity number of entries the file keeps
+/// @return NULL with errno set on failure
+i2c_capture* i2c_capture_open(const char* device_path, const char* capture_path, uint64_t capacity);
+
+/// @brief wait up to timeout_ms for the device and store what it sent, -1 waits forever
+/// @return entries added, -1 with errno set once the device has gone or on error
+int i2c_capture_poll(i2c_capture* capture, int timeout_ms);
+
+/// @brief store bytes of a capture stream from somewhere else, such as a recording
+/// @return entries added
+int i2c_capture_feed(i2c_capture* capture, const uint8_t* bytes, uint64_t length);
+
+uint64_t i2c_capture_count(const i2c_capture* capture);
+uint64_t i2c_capture_skipped(const i2c_capture* capture);
+uint64_t i2c_capture_dropped(const i2c_capture* capture);
+
+/// @brief copy out up to max entries starting at entry number first
+/// @return entries copied, fewer when first is older than the file keeps or not written yet
+uint64_t i2c_capture_read(const i2c_capture* capture, uint64_t first, i2c_capture_entry* entries, uint64_t max);
+
+void i2c_capture_close(i2c_capture* capture);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
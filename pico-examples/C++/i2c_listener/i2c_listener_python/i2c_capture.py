@@ -0,0 +1,71 @@
+"""
+ctypes binding for the host capture library in ../i2c_listener_host, build it first with
+
+    cmake -S ../i2c_listener_host -B ../i2c_listener_host/build
+    cmake --build ../i2c_listener_host/build
+"""
+
+import ctypes
+import os
+
+RECORD_TYPES = ["SYNC", "START", "RESTART", "STOP", "ADDRESS", "DATA", "OVERFLOW"]
+
+DEFAULT_LIBRARY = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               "..", "i2c_listener_host", "build", "libi2c_capture_host.so")
+
+
+class Entry(ctypes.Structure):
+    _fields_ = [
+        ("time_us", ctypes.c_uint64),
+        ("dropped", ctypes.c_uint32),
+        ("type", ctypes.c_uint8),
+        ("value", ctypes.c_uint8),
+        ("acknowledged", ctypes.c_uint8),
+        ("reserved", ctypes.c_uint8),
+    ]
+
+    def describe(self) -> str:
+        name = RECORD_TYPES[self.type] if self.type < len(RECORD_TYPES) else "?"
+        if name == "ADDRESS":
+            return f"ADDRESS 0x{self.value >> 1:02x} {'R' if self.value & 1 else 'W'} {'ACK' if self.acknowledged else 'NACK'}"
+        if name == "DATA":
+            return f"DATA 0x{self.value:02x} {'ACK' if self.acknowledged else 'NACK'}"
+        if name == "OVERFLOW":
+            return f"OVERFLOW {self.dropped} dropped"
+        return name
+
+
+class Capture:
+    def __init__(self, device_path: str, capture_path: str, capacity: int = 1 << 20, library: str = DEFAULT_LIBRARY):
+        self.lib = ctypes.CDLL(library, use_errno=True)
+        self.lib.i2c_capture_open.restype = ctypes.c_void_p
+        self.lib.i2c_capture_open.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_uint64]
+        self.lib.i2c_capture_poll.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.i2c_capture_count.restype = ctypes.c_uint64
+        self.lib.i2c_capture_count.argtypes = [ctypes.c_void_p]
+        self.lib.i2c_capture_read.restype = ctypes.c_uint64
+        self.lib.i2c_capture_read.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(Entry), ctypes.c_uint64]
+        self.lib.i2c_capture_close.argtypes = [ctypes.c_void_p]
+
+        self.capacity = capacity
+        self.handle = self.lib.i2c_capture_open(device_path.encode(), capture_path.encode(), capacity)
+        if not self.handle:
+            errno = ctypes.get_errno()
+            raise OSError(errno, f"could not capture from {device_path}")
+
+    def poll(self, timeout_ms: int) -> int:
+        """Sleep until the device sends something or the timeout, returns the entries added, -1 once it has gone"""
+        return self.lib.i2c_capture_poll(self.handle, timeout_ms)
+
+    def count(self) -> int:
+        return self.lib.i2c_capture_count(self.handle)
+
+    def read(self, first: int, max_entries: int) -> list:
+        entries = (Entry * max_entries)()
+        copied = self.lib.i2c_capture_read(self.handle, first, entries, max_entries)
+        return list(entries[:copied])
+
+    def close(self):
+        if self.handle:
+            self.lib.i2c_capture_close(self.handle)
+            self.handle = None
@@ -1,9 +1,9 @@
 import threading
-import serial
 from serial.tools import list_ports
-import time
 from collections import deque
 
+from i2c_capture import Capture
+
 from dash import Dash, dcc, html, Input, Output, dash_table
 import plotly
 
@@ -20,21 +20,24 @@ class DataStorage:
     def get_data(self):
         return list(self.data)
 
-def read_from_serial(arduino : serial.Serial, buffer : DataStorage, lock : threading.Lock, new_data_event : threading.Event):
+def read_from_serial(capture : Capture, buffer : DataStorage, lock : threading.Lock, new_data_event : threading.Event):
+    # The capture library sleeps in poll() and decodes the records, times are the device's
+    next_entry = 0
     while True:
-        # Read byte from serial if it exists
-        try:
-            bytes_to_read = arduino.in_waiting
-            if bytes_to_read > 0:
-                raw = arduino.read(bytes_to_read)
-                current_time = time.time_ns() / 1000
-                with lock:
-                    buffer.add_data(raw.hex(), current_time)
-                new_data_event.set()
-
-        except Exception as e:
-            print(f"Serial read error: {e}")
+        if capture.poll(500) < 0:
+            print("Serial device closed")
             break
+
+        # Entries older than the capture file keeps are gone
+        count = capture.count()
+        next_entry = max(next_entry, count - capture.capacity)
+        entries = capture.read(next_entry, count - next_entry)
+        if entries:
+            next_entry += len(entries)
+            with lock:
+                for entry in entries:
+                    buffer.add_data(entry.describe(), entry.time_us)
+            new_data_event.set()
             
 def process_data(buffer : DataStorage, lock : threading.Lock, new_data_event : threading.Event, sorted_buffer : DataStorage):
     while True:
@@ -93,7 +96,7 @@ def GUI():
 
 def main():
     chosen_port = ChoosePort()
-    arduino = serial.Serial(chosen_port, 115200)
+    capture = Capture(chosen_port, "i2c_capture.bin")
     buffer = DataStorage()
     sorted_buffer = DataStorage()
     lock = threading.Lock()
@@ -102,7 +105,7 @@ def main():
 
     try:
         # Create a new thread for the serial read and processing and GUI
-        reader_thread = threading.Thread(target=read_from_serial, args=(arduino, buffer, lock, new_data_event))
+        reader_thread = threading.Thread(target=read_from_serial, args=(capture, buffer, lock, new_data_event))
         processor_thread = threading.Thread(target=process_data, args=(buffer, lock, new_data_event, sorted_buffer))
         GUI_thread = threading.Thread(target=GUI)
 
@@ -118,7 +121,7 @@ def main():
         pass
 
     finally:
-        arduino.close()
+        capture.close()
 
     return sorted_buffer
 
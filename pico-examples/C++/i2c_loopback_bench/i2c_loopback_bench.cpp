@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#include "i2c_register_bank.h"
+#include "i2c_loopback_lib.h"
+
+#if defined(LOOPBACK_BACKEND_HARDWARE)
+#include "hardware/i2c.h"
+#include "pico/i2c_slave.h"
+#elif defined(LOOPBACK_BACKEND_PIO)
+#include "i2c_pio_slave_lib.h"
+#else
+#include "i2c_software_slave_lib.h"
+#endif
+
+/*
+    Master and slave on one Pico, the software master on core 0 and the slave on core 1, swept
+    from 10 kHz to 1 MHz with the throughput, NACKs, retries and first failing speed printed
+    over USB. Built once per slave backend:
+
+        i2c_loopback_bench_irq       i2c_software_slave, GPIO interrupt on every edge
+        i2c_loopback_bench_pio       i2c_pio_slave on pio0
+        i2c_loopback_bench_hardware  the i2c0 block through pico_i2c_slave
+
+    Wire GPIO 2 to GPIO 4 (SDA) and GPIO 3 to GPIO 5 (SCL), with a 2.2k pull up on each line
+    to 3V3, the internal pull ups are too weak for the faster speeds.
+*/
+
+#define MASTER_SDA_PIN  2u
+#define MASTER_SCL_PIN  3u
+
+#define SLAVE_SDA_PIN   4u
+#define SLAVE_SCL_PIN   5u
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static volatile uint8_t registers[I2C_LOOPBACK_REGISTERS];
+static i2c_register_bank bank(registers, I2C_LOOPBACK_REGISTERS);
+
+#if defined(LOOPBACK_BACKEND_HARDWARE)
+
+#define BACKEND_NAME "hardware"
+
+static uint byte_number = 0;
+
+// The bank behind the sdk's slave events, byte numbers count from 1 after the address as in the engines
+static void HAL_RAM_FUNC(hardware_handler)(i2c_inst_t* i2c, i2c_slave_event_t event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_RECEIVE:
+        bank.receive(i2c_read_byte_raw(i2c), ++byte_number);
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        i2c_write_byte_raw(i2c, bank.request());
+        break;
+
+    case I2C_SLAVE_FINISH:
+        bank.stop();
+        byte_number = 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void start_slave()
+{
+    gpio_set_function(SLAVE_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(SLAVE_SCL_PIN, GPIO_FUNC_I2C);
+
+    // Fast mode plus timing, the block then follows any slower master too
+    i2c_init(i2c0, 1000000);
+    i2c_slave_init(i2c0, I2C_ADDRESS, &hardware_handler);
+}
+
+#elif defined(LOOPBACK_BACKEND_PIO)
+
+#define BACKEND_NAME "pio"
+
+static void start_slave()
+{
+    i2c_pio_slave_init_register_bank(pio0, SLAVE_SDA_PIN, SLAVE_SCL_PIN, I2C_ADDRESS, &bank);
+}
+
+#else
+
+#define BACKEND_NAME "irq"
+
+static void start_slave()
+{
+    i2c_software_slave_init_register_bank(SLAVE_SDA_PIN, SLAVE_SCL_PIN, I2C_ADDRESS, &bank);
+}
+
+#endif
+
+// The slave's interrupts are taken by the core that starts it
+static void slave_main()
+{
+    start_slave();
+    multicore_fifo_push_blocking(1);
+
+    while (true)
+        __wfi();
+}
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+
+    gpio_pull_up(MASTER_SDA_PIN);
+    gpio_pull_up(MASTER_SCL_PIN);
+
+    multicore_launch_core1(&slave_main);
+    multicore_fifo_pop_blocking();
+
+    i2c_loopback_result results[I2C_LOOPBACK_SPEEDS];
+
+    while (true)
+    {
+        i2c_loopback_sweep(MASTER_SDA_PIN, MASTER_SCL_PIN, I2C_ADDRESS, results);
+        i2c_loopback_print(BACKEND_NAME, results);
+        printf("\n");
+        sleep_ms(5000);
+    }
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+#include "i2c_software_slave_lib.h"
+
+/*
+    I2C slave serving a bank of registers straight from memory. The master writes a register
+    number and then either the values to store from there on, or reads from there on with a
+    repeated START. The main loop is told what changed once per transaction.
+*/
+
+
+#define I2C_SDA_PIN 	4u
+#define I2C_SCL_PIN 	5u
+
+#define REGISTERS       16
+
+const uint8_t I2C_ADDRESS = 0x42;
+
+static volatile uint8_t registers[REGISTERS];
+
+// Last write, picked up by the main loop
+static volatile bool written = false;
+static volatile uint8_t written_first;
+static volatile uint written_count;
+
+static void on_stop(uint8_t first_register, uint n_written, uint n_read)
+{
+    if (n_written)
+    {
+        written_first = first_register;
+        written_count = n_written;
+        written = true;
+    }
+}
+
+static i2c_register_bank bank(registers, REGISTERS, &on_stop);
+
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+    printf("I2C Register Bank\n");
+
+    i2c_software_slave_init_register_bank(I2C_SDA_PIN, I2C_SCL_PIN, I2C_ADDRESS, &bank);
+
+    uint64_t next_second = time_us_64() + 1000000;
+    while (true)
+    {
+        if (written)
+        {
+            written = false;
+            printf("%u registers written from %u\n", written_count, written_first);
+        }
+
+        // Register 0 counts the seconds since start
+        if (time_us_64() >= next_second)
+        {
+            next_second += 1000000;
+            registers[0]++;
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+
+#include "i2c_software_master_lib.h"
+
+/*
+    Bus scanner using the bit banging master, prints every address that answers once a second
+*/
+
+
+#define I2C_SDA_PIN 	4
+#define I2C_SCL_PIN 	5
+
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+    printf("I2C Scanner\n");
+
+    i2c_software i2c(I2C_SDA_PIN, I2C_SCL_PIN, 400000);
+
+    while (true)
+    {
+        uint64_t start = time_us_64();
+        i2c_scan_result result = i2c.scan();
+        uint64_t duration = time_us_64() - start;
+
+        i2c_scan_print(&result);
+        printf("Scanned in %llu us\n\n", duration);
+
+        sleep_ms(1000);
+    }
+}
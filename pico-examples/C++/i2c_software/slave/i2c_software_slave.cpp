@@ -4,6 +4,7 @@
 #include "hardware/gpio.h"
 
 #include "i2c_software_slave_lib.h"
+#include "i2c_software_slave_stats.h"
 
 /*
     I2C demo using bit banging to create i2c with software slave not using the hardware module
@@ -15,9 +16,13 @@
 
 const uint8_t I2C_ADDRESS = 0x42;
 
+// Speed of the master example, only used to put the interrupt timing in context
+#define I2C_BUS_HZ      100000u
+
 static uint8_t received;
 
-static void event_handler(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+// Runs inside the slave's interrupt, kept in RAM like the rest of it
+static void HAL_RAM_FUNC(event_handler)(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
 {
     switch (event)
     {
@@ -55,6 +60,10 @@ int main()
     while (true)
     {   
         // loop code
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+        sleep_ms(5000);
+        i2c_software_slave_print_stats(I2C_BUS_HZ);
+#endif
     }
     
 }
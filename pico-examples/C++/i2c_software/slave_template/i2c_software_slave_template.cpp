@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_slave_t.h"
+#include "i2c_software_master_lib.h"
+
+#if defined(I2C_SOFTWARE_SLAVE_PIO)
+#error "the runtime slave must take its edges on the GPIO interrupt to be compared"
+#endif
+
+#if defined(I2C_SOFTWARE_SLAVE_STATS)
+#error "the runtime slave would time itself as well and be charged for it, build without I2C_SOFTWARE_SLAVE_STATS"
+#endif
+
+/*
+    The compile time slave template against the runtime slave on the same bus, measured on the
+    board. The master on core 0 writes and reads back each slave in turn, both slaves take their
+    edges on core 1 and every entry of their raw bank handlers is timed with hal_cycle_count.
+    Both handle every edge of the same traffic whichever is addressed, so the averages compare
+    like for like. Each round prints the cycles per entry of both and PASS if the template is
+    the cheaper one, FAIL otherwise or if either slave got its transfers wrong.
+
+    Wire GPIO 2 to GPIO 4 and GPIO 6 (SDA) and GPIO 3 to GPIO 5 and GPIO 7 (SCL), with a 2.2k
+    pull up on each line to 3V3.
+*/
+
+#define MASTER_SDA_PIN      2u
+#define MASTER_SCL_PIN      3u
+
+#define RUNTIME_SDA_PIN     4u
+#define RUNTIME_SCL_PIN     5u
+
+#define TEMPLATE_SDA_PIN    6u
+#define TEMPLATE_SCL_PIN    7u
+
+#define I2C_BUS_HZ          400000u
+
+#define PAYLOAD             16
+#define TRANSFERS           200
+
+const uint8_t RUNTIME_ADDRESS = 0x42;
+const uint8_t TEMPLATE_ADDRESS = 0x43;
+
+// What one slave was written and answers with
+struct slave_data {
+    uint8_t received[PAYLOAD];
+    uint count;
+};
+
+static slave_data runtime_data;
+static slave_data template_data;
+
+static inline void HAL_RAM_FUNC(on_event)(slave_data& d, volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    switch (event)
+    {
+    case I2C_SLAVE_RECEIVE:
+        if (d.count < PAYLOAD)
+            d.received[d.count++] = data;
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = d.received[byte_number % PAYLOAD];
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void HAL_RAM_FUNC(runtime_handler)(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    on_event(runtime_data, data, byte_number, event);
+}
+
+static void HAL_RAM_FUNC(template_handler)(volatile uint8_t &data, const uint byte_number, const i2c_software_slave_event event)
+{
+    on_event(template_data, data, byte_number, event);
+}
+
+typedef i2c_software_slave_t<TEMPLATE_SDA_PIN, TEMPLATE_SCL_PIN, TEMPLATE_ADDRESS, &template_handler> template_slave;
+
+// Cycles of one handler's entries, written on core 1 and read on core 0 once the bus is quiet
+struct handler_cycles {
+    volatile uint32_t calls;
+    volatile uint32_t max_cycles;
+    volatile uint64_t total_cycles;
+
+    void reset() { calls = 0; max_cycles = 0; total_cycles = 0; }
+    uint32_t average() const { return calls ? (uint32_t)(total_cycles / calls) : 0; }
+};
+
+static handler_cycles runtime_cycles;
+static handler_cycles template_cycles;
+
+static inline void HAL_RAM_FUNC(add_entry)(handler_cycles& c, uint32_t start)
+{
+    uint32_t cycles = (hal_cycle_count() - start) & HAL_CYCLE_COUNT_MASK;
+    c.calls = c.calls + 1;
+    c.total_cycles = c.total_cycles + cycles;
+    if (cycles > c.max_cycles)
+        c.max_cycles = cycles;
+}
+
+// The slaves' own raw handlers with the same timing around each
+static void HAL_RAM_FUNC(timed_runtime_handler)()
+{
+    uint32_t start = hal_cycle_count();
+    i2c_software_slave_raw_irq_handler();
+    add_entry(runtime_cycles, start);
+}
+
+static void HAL_RAM_FUNC(timed_template_handler)()
+{
+    uint32_t start = hal_cycle_count();
+    template_slave::irq_handler();
+    add_entry(template_cycles, start);
+}
+
+// The slaves' interrupts and SysTick are taken by the core that starts them
+static void slave_main()
+{
+    hal_cycle_counter_init();
+
+    const uint32_t runtime_pins = (1u << RUNTIME_SDA_PIN) | (1u << RUNTIME_SCL_PIN);
+    i2c_software_slave_init(RUNTIME_SDA_PIN, RUNTIME_SCL_PIN, RUNTIME_ADDRESS, &runtime_handler);
+    hal_gpio_remove_raw_irq_handler_masked(runtime_pins, &i2c_software_slave_raw_irq_handler);
+    hal_gpio_add_raw_irq_handler_masked(runtime_pins, &timed_runtime_handler);
+
+    template_slave::init();
+    hal_gpio_remove_raw_irq_handler_masked(template_slave::SDA_MASK | template_slave::SCL_MASK, &template_slave::irq_handler);
+    hal_gpio_add_raw_irq_handler_masked(template_slave::SDA_MASK | template_slave::SCL_MASK, &timed_template_handler);
+
+    multicore_fifo_push_blocking(1);
+
+    while (true)
+        __wfi();
+}
+
+// Write the payload and read it back, true if it came back the same
+static bool write_and_read(i2c_software& i2c, uint8_t address, slave_data& d, const uint8_t* payload)
+{
+    uint8_t written[PAYLOAD];
+    uint8_t read[PAYLOAD] = {0};
+    for (uint i = 0; i < PAYLOAD; i++)
+        written[i] = payload[i];
+
+    d.count = 0;
+    if (!i2c.write_bytes(address, written, PAYLOAD) || !i2c.read_bytes(address, read, PAYLOAD))
+        return false;
+
+    for (uint i = 0; i < PAYLOAD; i++)
+        if (read[i] != payload[i])
+            return false;
+    return d.count == PAYLOAD;
+}
+
+int main()
+{
+    stdio_init_all();
+    sleep_ms(2000);
+    printf("I2C slave template against the runtime slave\n");
+
+    multicore_launch_core1(&slave_main);
+    multicore_fifo_pop_blocking();
+
+    i2c_software i2c(MASTER_SDA_PIN, MASTER_SCL_PIN, I2C_BUS_HZ);
+
+    uint8_t payload[PAYLOAD];
+    uint round = 0;
+
+    while (true)
+    {
+        runtime_cycles.reset();
+        template_cycles.reset();
+
+        uint runtime_failures = 0;
+        uint template_failures = 0;
+        for (uint n = 0; n < TRANSFERS; n++)
+        {
+            for (uint i = 0; i < PAYLOAD; i++)
+                payload[i] = (uint8_t)(round * 31 + n * 7 + i);
+
+            runtime_failures += !write_and_read(i2c, RUNTIME_ADDRESS, runtime_data, payload);
+            template_failures += !write_and_read(i2c, TEMPLATE_ADDRESS, template_data, payload);
+        }
+
+        // Let core 1 finish the last STOP before the counts are read
+        sleep_ms(1);
+
+        uint32_t runtime_average = runtime_cycles.average();
+        uint32_t template_average = template_cycles.average();
+
+        printf("runtime slave   %6lu entries %4lu cycles average %4lu max, %u failed\n",
+               (unsigned long)runtime_cycles.calls, (unsigned long)runtime_average,
+               (unsigned long)runtime_cycles.max_cycles, runtime_failures);
+        printf("template slave  %6lu entries %4lu cycles average %4lu max, %u failed\n",
+               (unsigned long)template_cycles.calls, (unsigned long)template_average,
+               (unsigned long)template_cycles.max_cycles, template_failures);
+
+        bool passed = runtime_failures == 0 && template_failures == 0
+                   && runtime_cycles.calls > 0 && template_cycles.calls > 0
+                   && template_average < runtime_average;
+        printf("%s: the template takes %lu%% of the runtime slave's cycles\n\n", passed ? "PASS" : "FAIL",
+               runtime_average ? (unsigned long)(template_average * 100 / runtime_average) : 0ul);
+
+        round++;
+        sleep_ms(5000);
+    }
+}
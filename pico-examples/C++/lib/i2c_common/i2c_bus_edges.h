@@ -0,0 +1,86 @@
+#ifndef I2C_BUS_EDGES_H
+#define I2C_BUS_EDGES_H
+
+#include "io_hal.h"
+
+/*
+    Puts the edges latched on SDA and SCL back in the order they happened, for raw bank interrupt
+    handlers which may find several edges pending at once.
+
+    The bank only latches that a pin rose and / or fell, not when. The bus follows I2C timing so
+    apart from START and STOP, SDA only changes while SCL is low: a falling SCL edge came before
+    the SDA edges and a rising one after them. A START or STOP that is serviced together with the
+    next SCL edge is therefore seen as a data bit, it needs the interrupt to keep up with half a bit.
+*/
+
+#define I2C_BUS_EDGES_MAX 4
+
+// One edge on one of the lines and the level of both lines just after it
+struct i2c_bus_edge {
+    bool scl;
+    uint32_t event;
+    bool sda_level;
+    bool scl_level;
+};
+
+// Split the latched events of one line into single edges, oldest first, from the level it ended at
+static inline uint i2c_line_edges(uint32_t events, bool level_now, uint32_t edges[2])
+{
+    bool rise = events & GPIO_IRQ_EDGE_RISE;
+    bool fall = events & GPIO_IRQ_EDGE_FALL;
+
+    if (rise && fall)
+    {
+        edges[0] = level_now ? GPIO_IRQ_EDGE_FALL : GPIO_IRQ_EDGE_RISE;
+        edges[1] = level_now ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+        return 2;
+    }
+    if (rise || fall)
+    {
+        edges[0] = rise ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+        return 1;
+    }
+    return 0;
+}
+
+/// @brief order the edges latched on both lines
+/// @param sda_now level of SDA read after the events were latched, likewise scl_now
+/// @return number of edges written to edges
+static inline uint i2c_order_edges(uint32_t sda_events, uint32_t scl_events, bool sda_now, bool scl_now, i2c_bus_edge edges[I2C_BUS_EDGES_MAX])
+{
+    uint32_t sda_edges[2];
+    uint32_t scl_edges[2];
+    uint sda_count = i2c_line_edges(sda_events, sda_now, sda_edges);
+    uint scl_count = i2c_line_edges(scl_events, scl_now, scl_edges);
+
+    // Levels before the first edge
+    bool sda = (sda_count % 2) ? !sda_now : sda_now;
+    bool scl = (scl_count % 2) ? !scl_now : scl_now;
+
+    uint count = 0;
+    uint scl_index = 0;
+
+    // The clock falls before the data changes
+    if (scl_count && scl_edges[0] == GPIO_IRQ_EDGE_FALL)
+    {
+        scl = false;
+        edges[count++] = {true, GPIO_IRQ_EDGE_FALL, sda, scl};
+        scl_index++;
+    }
+
+    for (uint i = 0; i < sda_count; i++)
+    {
+        sda = (sda_edges[i] == GPIO_IRQ_EDGE_RISE);
+        edges[count++] = {false, sda_edges[i], sda, scl};
+    }
+
+    for (; scl_index < scl_count; scl_index++)
+    {
+        scl = (scl_edges[scl_index] == GPIO_IRQ_EDGE_RISE);
+        edges[count++] = {true, scl_edges[scl_index], sda, scl};
+    }
+
+    return count;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef I2C_FIFO_H
+#define I2C_FIFO_H
+
+#include <stdint.h>
+
+// 8 bit fifo 
+struct fifo_8bit
+{   
+    volatile uint8_t data = 0;
+
+    // Move data into the fifo
+    bool shift_in(bool bit)
+    {   
+        bool out = (data & 0x80);
+        data = data << 1;
+        data = (data & ~(0x01)) | ((uint8_t)bit);
+        return out;
+    }
+
+    // Reset fifo memory
+    void reset_fifo()
+    {
+        data = 0;
+    }
+};
+
+#endif
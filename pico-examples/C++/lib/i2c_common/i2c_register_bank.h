@@ -0,0 +1,77 @@
+#ifndef I2C_REGISTER_BANK_H
+#define I2C_REGISTER_BANK_H
+
+#include <stdint.h>
+
+/*
+    Register bank mode for the slave engines. The application hands over a block of its own
+    memory and the engine serves it without calling out per byte: the first byte the master
+    writes sets the register pointer, the bytes after it are stored from the pointer on and
+    reads carry on from wherever the pointer is, each byte moving it on by one and wrapping at
+    the end of the bank. The pointer is kept across a repeated START, so a register read is the
+    usual write of the register number followed by a read.
+
+    The only call into the application is at the STOP, with what the transaction touched.
+*/
+
+/// @brief called from the interrupt at the STOP of a transaction that wrote or read the bank
+/// @param first_register the first register written, or read if nothing was written
+/// @param n_written number of registers written
+/// @param n_read number of registers sent to the master
+typedef void (*i2c_register_bank_handler)(uint8_t first_register, unsigned int n_written, unsigned int n_read);
+
+struct i2c_register_bank
+{
+    volatile uint8_t* registers;
+    unsigned int size;
+    i2c_register_bank_handler on_stop;
+
+    volatile unsigned int pointer = 0;
+
+    // What the transaction in progress has done so far
+    volatile unsigned int first_register = 0;
+    volatile unsigned int n_written = 0;
+    volatile unsigned int n_read = 0;
+
+    i2c_register_bank(volatile uint8_t* bank_registers, unsigned int bank_size, i2c_register_bank_handler handler = nullptr)
+    {
+        registers = bank_registers;
+        size = bank_size;
+        on_stop = handler;
+    }
+
+    // byte_number counts from 1 after the address, as in the RECEIVE event
+    inline void receive(uint8_t data, unsigned int byte_number)
+    {
+        if (byte_number == 1)
+        {
+            pointer = data % size;
+            first_register = pointer;
+            return;
+        }
+        registers[pointer] = data;
+        pointer = (pointer + 1) % size;
+        n_written++;
+    }
+
+    inline uint8_t request()
+    {
+        if (n_written == 0 && n_read == 0)
+            first_register = pointer;
+
+        uint8_t data = registers[pointer];
+        pointer = (pointer + 1) % size;
+        n_read++;
+        return data;
+    }
+
+    inline void stop()
+    {
+        if (on_stop && (n_written || n_read))
+            on_stop(first_register, n_written, n_read);
+        n_written = 0;
+        n_read = 0;
+    }
+};
+
+#endif
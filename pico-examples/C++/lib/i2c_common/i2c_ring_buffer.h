@@ -0,0 +1,91 @@
+#ifndef I2C_RING_BUFFER_H
+#define I2C_RING_BUFFER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+/*
+    Lock free byte ring for one producer and one consumer, such as an interrupt handing data to
+    the main loop or one core handing data to the other.
+
+    head is only written by the producer and tail only by the consumer. Both count bytes forever
+    and wrap at 2^32, SIZE is a power of two so the difference is always the fill level.
+*/
+
+template <uint32_t SIZE>
+class i2c_ring_buffer
+{
+    static_assert(SIZE && (SIZE & (SIZE - 1)) == 0, "ring size must be a power of two");
+
+    public:
+        uint32_t size() const
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        uint32_t space() const
+        {
+            return SIZE - size();
+        }
+
+        // Producer: copy in every byte or none of them
+        bool push(const uint8_t* bytes, uint32_t length)
+        {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if (SIZE - (h - tail.load(std::memory_order_acquire)) < length)
+                return false;
+
+            uint32_t start = h & (SIZE - 1);
+            uint32_t first = (length < SIZE - start) ? length : SIZE - start;
+            memcpy(&data[start], bytes, first);
+            memcpy(&data[0], bytes + first, length - first);
+
+            head.store(h + length, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer: the longest run of bytes that can be read without wrapping
+        uint32_t peek(const uint8_t** bytes) const
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            uint32_t available = head.load(std::memory_order_acquire) - t;
+            uint32_t start = t & (SIZE - 1);
+
+            *bytes = &data[start];
+            return (available < SIZE - start) ? available : SIZE - start;
+        }
+
+        // Consumer: release bytes returned by peek
+        void consume(uint32_t length)
+        {
+            tail.store(tail.load(std::memory_order_relaxed) + length, std::memory_order_release);
+        }
+
+        // Consumer: copy out up to length bytes
+        uint32_t pop(uint8_t* bytes, uint32_t length)
+        {
+            uint32_t copied = 0;
+            while (copied < length)
+            {
+                const uint8_t* run;
+                uint32_t run_length = peek(&run);
+                if (run_length == 0)
+                    break;
+                if (run_length > length - copied)
+                    run_length = length - copied;
+
+                memcpy(bytes + copied, run, run_length);
+                consume(run_length);
+                copied += run_length;
+            }
+            return copied;
+        }
+
+    private:
+        uint8_t data[SIZE];
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+};
+
+#endif
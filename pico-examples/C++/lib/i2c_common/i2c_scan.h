@@ -0,0 +1,59 @@
+#ifndef I2C_SCAN_H
+#define I2C_SCAN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Result of probing a bus for devices, shared by the software and hardware master scanners so
+    it is plain C. Every 7 bit address from 0x08 to 0x77 is probed once, the rest are reserved:
+    0x00 - 0x07 for the general call, CBUS and high speed mode codes, 0x78 - 0x7f for 10 bit
+    addressing.
+*/
+
+#define I2C_SCAN_FIRST_ADDRESS  0x08
+#define I2C_SCAN_LAST_ADDRESS   0x77
+
+// One bit per 7 bit address, set if a device acknowledged it
+typedef struct {
+    uint32_t words[4];
+} i2c_scan_result;
+
+static inline bool i2c_scan_reserved(uint8_t address)
+{
+    return address < I2C_SCAN_FIRST_ADDRESS || address > I2C_SCAN_LAST_ADDRESS;
+}
+
+static inline void i2c_scan_set(i2c_scan_result* result, uint8_t address)
+{
+    result->words[(address >> 5) & 3] |= 1u << (address & 31);
+}
+
+static inline bool i2c_scan_found(const i2c_scan_result* result, uint8_t address)
+{
+    return (result->words[(address >> 5) & 3] >> (address & 31)) & 1;
+}
+
+/// @brief print the result as a table of addresses, like i2cdetect
+static inline void i2c_scan_print(const i2c_scan_result* result)
+{
+    printf("   0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f\n");
+    for (uint8_t address = 0; address < 0x80; address++)
+    {
+        if (address % 16 == 0)
+            printf("%02x", address);
+
+        if (i2c_scan_reserved(address))
+            printf("   ");
+        else if (i2c_scan_found(result, address))
+            printf(" %02x", address);
+        else
+            printf(" --");
+
+        if (address % 16 == 15)
+            printf("\n");
+    }
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef I2C_SEGMENT_H
+#define I2C_SEGMENT_H
+
+#include <stdint.h>
+
+/*
+    One buffer of a combined master transaction. Segments going the same way follow each other
+    in one phase of the transaction, so a register address and a payload kept in separate
+    buffers go out back to back without being copied together. A change of direction addresses
+    the device again after a repeated START, the last byte of a read phase is not acknowledged
+    and the transaction ends with a single STOP.
+
+    A write segment may be empty, a read segment may not: the slave only lets go of SDA for the
+    STOP after the master leaves the last byte it reads unacknowledged. A transaction with no
+    segments, or with an empty read segment, is refused before anything goes on the bus.
+*/
+
+struct i2c_segment {
+    uint8_t* data;
+    unsigned int n_bytes;
+    bool read;
+};
+
+// Whether the master may send the segments as one transaction
+static inline bool i2c_segments_valid(const i2c_segment* segments, unsigned int n_segments)
+{
+    if (n_segments == 0)
+        return false;
+    for (unsigned int i = 0; i < n_segments; i++)
+    {
+        if (segments[i].read && segments[i].n_bytes == 0)
+            return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef I2C_SLAVE_EVENT_H
+#define I2C_SLAVE_EVENT_H
+
+#include <stdint.h>
+
+/*
+    Callback contract shared by every slave engine, the GPIO interrupt slave and the PIO slave
+    call the same handler with the same events so an application works with either.
+*/
+
+// Event types
+enum i2c_software_slave_event {
+    I2C_SLAVE_START = 1,
+    I2C_SLAVE_RECEIVE,
+    I2C_SLAVE_REQUEST,
+    I2C_SLAVE_STOP,
+    I2C_SLAVE_NULL,
+};
+
+/// @brief a function type which specifies how to handle data in a out of the slave device
+/// @param data data received to to send
+/// @param byte_number the position of the data to be received or sent
+/// @param event the type of event triggering the event handler
+typedef void (*i2c_software_slave_event_handler)(volatile uint8_t &data, const unsigned int byte_number, const i2c_software_slave_event event);
+
+#endif
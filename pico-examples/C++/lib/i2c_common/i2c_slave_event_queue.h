@@ -0,0 +1,84 @@
+#ifndef I2C_SLAVE_EVENT_QUEUE_H
+#define I2C_SLAVE_EVENT_QUEUE_H
+
+#include <stdint.h>
+
+#include "i2c_slave_event.h"
+#include "i2c_ring_buffer.h"
+
+/*
+    Defers slave events from the interrupt to the main loop. The slave engine posts each event
+    into a lock free ring and returns straight away, dispatch() or poll() in the main loop then
+    hands them over in bus order, so printing or driving LEDs from a handler no longer holds up
+    the interrupt.
+
+    A REQUEST cannot wait, the master is clocking the byte out, so the optional request handler
+    is still run in the interrupt to fill in the byte. The REQUEST is queued afterwards with the
+    byte that was sent. Events arriving while the ring is full are dropped and counted.
+*/
+
+// Events the ring holds, a power of two
+#define I2C_SLAVE_EVENT_QUEUE_SIZE 64
+
+struct i2c_slave_queued_event {
+    uint8_t event;              // i2c_software_slave_event
+    uint8_t data;
+    uint16_t byte_number;
+};
+
+class i2c_slave_event_queue
+{
+    public:
+        /// @param handler run by dispatch in the main loop
+        /// @param request_handler run in the interrupt to fill in each byte the master reads, may be null
+        i2c_slave_event_queue(i2c_software_slave_event_handler handler, i2c_software_slave_event_handler request_handler = nullptr)
+        {
+            _handler = handler;
+            _request_handler = request_handler;
+        }
+
+        // Interrupt side, called by the slave engine
+        inline void post(volatile uint8_t &data, const unsigned int byte_number, const i2c_software_slave_event event)
+        {
+            if (event == I2C_SLAVE_REQUEST && _request_handler)
+                _request_handler(data, byte_number, event);
+
+            i2c_slave_queued_event queued = {(uint8_t)event, data, (uint16_t)byte_number};
+            if (!ring.push((const uint8_t*)&queued, sizeof(queued)))
+                overflow_count++;
+        }
+
+        // Main loop: take the oldest event, false if there is none
+        bool poll(i2c_slave_queued_event* event)
+        {
+            return ring.pop((uint8_t*)event, sizeof(*event)) == sizeof(*event);
+        }
+
+        // Main loop: run the handler for every queued event, returns how many
+        unsigned int dispatch()
+        {
+            unsigned int count = 0;
+            i2c_slave_queued_event queued;
+            while (poll(&queued))
+            {
+                volatile uint8_t data = queued.data;
+                _handler(data, queued.byte_number, (i2c_software_slave_event)queued.event);
+                count++;
+            }
+            return count;
+        }
+
+        // Events lost to a full ring since start
+        uint32_t overflows() const { return overflow_count; }
+
+    private:
+        i2c_software_slave_event_handler _handler;
+        i2c_software_slave_event_handler _request_handler;
+
+        i2c_ring_buffer<I2C_SLAVE_EVENT_QUEUE_SIZE * sizeof(i2c_slave_queued_event)> ring;
+
+        // Only written by the interrupt
+        volatile uint32_t overflow_count = 0;
+};
+
+#endif
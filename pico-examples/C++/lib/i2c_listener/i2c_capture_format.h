@@ -0,0 +1,270 @@
+#ifndef I2C_CAPTURE_FORMAT_H
+#define I2C_CAPTURE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+    Binary format the listener streams its capture in, version 1.
+
+    The stream is a run of records. Every record except SYNC starts with a tag byte followed by the
+    time since the previous record in microseconds, taken on the device with time_us_64:
+
+        tag         [type : 3][flag : 1][delta bits 11..8 : 4]
+        delta       [delta bits 7..0 : 8]
+
+    A delta of 0xF00 or more does not fit, the delta bits of the tag are then all set and the
+    whole delta follows as a varint instead of the low byte (7 bits per byte, low bits first,
+    top bit set on every byte but the last).
+
+    Records by type:
+
+        SYNC        0x00 'I' '2' 'C' version, then the absolute time in microseconds as a varint.
+                    Sent first and every I2C_CAPTURE_SYNC_INTERVAL records so a reader joining part
+                    way through can find the record boundaries and the time base.
+        START       START condition on an idle bus.
+        RESTART     START condition in the middle of a transfer.
+        STOP        STOP condition.
+        ADDRESS     1 byte, the 7 bit address shifted up with the read / write bit below it.
+        DATA        1 byte of data.
+        OVERFLOW    varint, how many records the device had to drop just before this one.
+
+    The flag is set on an ADDRESS or DATA record the receiver acknowledged, clear when it did not.
+
+    A data byte costs 3 bytes and an address byte 3, against 4 each for the old 32 bit messages.
+*/
+
+#define I2C_CAPTURE_VERSION             1
+#define I2C_CAPTURE_SYNC_INTERVAL       256
+#define I2C_CAPTURE_MAX_RECORD          32
+
+#define I2C_CAPTURE_FLAG                0x10
+#define I2C_CAPTURE_DELTA_ESCAPE        0x0F
+#define I2C_CAPTURE_DELTA_INLINE_MAX    0xEFF
+
+enum i2c_capture_record_type {
+    I2C_CAPTURE_SYNC = 0,
+    I2C_CAPTURE_START,
+    I2C_CAPTURE_RESTART,
+    I2C_CAPTURE_STOP,
+    I2C_CAPTURE_ADDRESS,
+    I2C_CAPTURE_DATA,
+    I2C_CAPTURE_OVERFLOW,
+};
+
+static const uint8_t i2c_capture_sync_magic[4] = {0x00, 'I', '2', 'C'};
+
+static inline uint32_t i2c_capture_put_varint(uint64_t value, uint8_t* out)
+{
+    uint32_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// Builds records, run on the device in the interrupt
+class i2c_capture_encoder
+{
+    public:
+        /// @brief encode one record, preceded by a SYNC record when one is due
+        /// @param value the byte of an ADDRESS or DATA record or the count of an OVERFLOW record
+        /// @param out at least I2C_CAPTURE_MAX_RECORD bytes
+        /// @return length written, call written() once the bytes have been stored
+        uint32_t encode(i2c_capture_record_type type, uint64_t now_us, uint32_t value, bool acknowledged, uint8_t* out) const
+        {
+            uint32_t length = 0;
+            uint64_t delta = now_us - last_us;
+
+            if (records_since_sync == 0)
+            {
+                for (uint8_t byte : i2c_capture_sync_magic)
+                    out[length++] = byte;
+                out[length++] = I2C_CAPTURE_VERSION;
+                length += i2c_capture_put_varint(now_us, &out[length]);
+                delta = 0;
+            }
+
+            uint8_t tag = (uint8_t)(type << 5) | (acknowledged ? I2C_CAPTURE_FLAG : 0);
+            if (delta <= I2C_CAPTURE_DELTA_INLINE_MAX)
+            {
+                out[length++] = tag | (uint8_t)(delta >> 8);
+                out[length++] = (uint8_t)delta;
+            }
+            else
+            {
+                out[length++] = tag | I2C_CAPTURE_DELTA_ESCAPE;
+                length += i2c_capture_put_varint(delta, &out[length]);
+            }
+
+            if (type == I2C_CAPTURE_ADDRESS || type == I2C_CAPTURE_DATA)
+                out[length++] = (uint8_t)value;
+            else if (type == I2C_CAPTURE_OVERFLOW)
+                length += i2c_capture_put_varint(value, &out[length]);
+
+            return length;
+        }
+
+        // The last encoded record made it into the stream, the next delta is taken from it
+        void written(uint64_t now_us)
+        {
+            last_us = now_us;
+            records_since_sync = (records_since_sync + 1) % I2C_CAPTURE_SYNC_INTERVAL;
+        }
+
+    private:
+        uint64_t last_us = 0;
+        uint32_t records_since_sync = 0;
+};
+
+struct i2c_capture_record {
+    i2c_capture_record_type type;
+    uint64_t time_us;
+    uint8_t value;              // ADDRESS and DATA
+    bool acknowledged;          // ADDRESS and DATA
+    uint32_t dropped;           // OVERFLOW
+};
+
+// Splits a byte stream back into records, resynchronising on SYNC records after a gap or damage
+class i2c_capture_decoder
+{
+    public:
+        /// @brief feed any number of bytes, on_record(const i2c_capture_record&) is called for every record
+        template <typename F>
+        void feed(const uint8_t* bytes, size_t length, F&& on_record)
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                pending[pending_length++] = bytes[i];
+
+                while (pending_length)
+                {
+                    i2c_capture_record record;
+                    int used = parse(record);
+                    if (used == 0)
+                        break;
+
+                    if (used < 0)
+                    {
+                        // Not a record here, lose sync and search from the next byte
+                        synced = false;
+                        skipped++;
+                        drop(1);
+                        continue;
+                    }
+
+                    drop(used);
+                    if (record.type != I2C_CAPTURE_SYNC)
+                        on_record(record);
+                }
+            }
+        }
+
+        bool is_synced() const { return synced; }
+
+        // Bytes thrown away while looking for a SYNC record
+        uint64_t get_skipped() const { return skipped; }
+
+    private:
+        uint8_t pending[I2C_CAPTURE_MAX_RECORD];
+        uint32_t pending_length = 0;
+        bool synced = false;
+        uint64_t time_us = 0;
+        uint64_t skipped = 0;
+
+        void drop(uint32_t count)
+        {
+            for (uint32_t i = count; i < pending_length; i++)
+                pending[i - count] = pending[i];
+            pending_length -= count;
+        }
+
+        // 0 when more bytes are needed, -1 when the varint is too long
+        int get_varint(uint32_t position, uint64_t& value) const
+        {
+            value = 0;
+            for (uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                if (position >= pending_length)
+                    return 0;
+                uint8_t byte = pending[position++];
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return position;
+            }
+            return -1;
+        }
+
+        // Bytes used by the record at the front, 0 if it is not complete and -1 if it is not a record
+        int parse(i2c_capture_record& record)
+        {
+            // Only a SYNC record can be trusted to start a record boundary
+            uint32_t magic_length = sizeof(i2c_capture_sync_magic);
+            if (!synced || pending[0] == 0x00)
+            {
+                for (uint32_t i = 0; i < magic_length && i < pending_length; i++)
+                {
+                    if (pending[i] != i2c_capture_sync_magic[i])
+                        return -1;
+                }
+                if (pending_length < magic_length + 1)
+                    return 0;
+                if (pending[magic_length] != I2C_CAPTURE_VERSION)
+                    return -1;
+
+                int end = get_varint(magic_length + 1, time_us);
+                if (end <= 0)
+                    return end;
+
+                synced = true;
+                record = {I2C_CAPTURE_SYNC, time_us, 0, false, 0};
+                return end;
+            }
+
+            uint8_t tag = pending[0];
+            i2c_capture_record_type type = (i2c_capture_record_type)(tag >> 5);
+            if (type == I2C_CAPTURE_SYNC || type > I2C_CAPTURE_OVERFLOW)
+                return -1;
+
+            uint64_t delta;
+            int position;
+            if ((tag & 0x0F) == I2C_CAPTURE_DELTA_ESCAPE)
+            {
+                position = get_varint(1, delta);
+                if (position <= 0)
+                    return position;
+            }
+            else
+            {
+                if (pending_length < 2)
+                    return 0;
+                delta = ((uint64_t)(tag & 0x0F) << 8) | pending[1];
+                position = 2;
+            }
+
+            record = {type, time_us + delta, 0, (tag & I2C_CAPTURE_FLAG) != 0, 0};
+
+            if (type == I2C_CAPTURE_ADDRESS || type == I2C_CAPTURE_DATA)
+            {
+                if ((uint32_t)position >= pending_length)
+                    return 0;
+                record.value = pending[position++];
+            }
+            else if (type == I2C_CAPTURE_OVERFLOW)
+            {
+                uint64_t dropped;
+                position = get_varint(position, dropped);
+                if (position <= 0)
+                    return position;
+                record.dropped = (uint32_t)dropped;
+            }
+
+            time_us = record.time_us;
+            return position;
+        }
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef I2C_CAPTURE_HISTORY_H
+#define I2C_CAPTURE_HISTORY_H
+
+#include <atomic>
+
+#include "i2c_capture_format.h"
+
+/*
+    The last SIZE - 1 bus records kept in RAM, for looking back at what went over the bus after the
+    fact rather than streaming it as it happens like i2c_listener_stream.
+
+    The interrupt records into a fixed ring and always overwrites the oldest record, it never
+    waits or drops anything new. The main loop can replay the ring whenever it likes: records
+    are handed over oldest first, and any the interrupt overwrote while the replay was reading
+    them are reported as one OVERFLOW record with their count, so nothing is shown torn or
+    twice. Replay feeds i2c_capture_encoder to send the history in the listener's format.
+
+    The interrupt may run on the other core, in the middle of a replay: the slot of record head
+    can be half written at any time, so of the SIZE slots only the SIZE - 1 below head are held.
+
+    head counts records forever and wraps at 2^32, SIZE is a power of two.
+*/
+
+template <uint32_t SIZE>
+class i2c_capture_history
+{
+    static_assert(SIZE && (SIZE & (SIZE - 1)) == 0, "history size must be a power of two");
+
+    public:
+        // Interrupt side, give this every event along with time_us_64()
+        void record(i2c_capture_record_type type, uint64_t now_us, uint8_t value, bool acknowledged)
+        {
+            uint32_t h = head.load(std::memory_order_relaxed);
+
+            // A replay that copies any of this record sees head at h or later once it has
+            std::atomic_thread_fence(std::memory_order_release);
+            slots[h & (SIZE - 1)] = {now_us, (uint8_t)type, value, acknowledged};
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        // Main loop side, records held right now
+        uint32_t size() const
+        {
+            uint32_t held = head.load(std::memory_order_acquire) - cleared;
+            return held < SIZE - 1 ? held : SIZE - 1;
+        }
+
+        // Main loop side, forget everything recorded so far
+        void clear()
+        {
+            cleared = head.load(std::memory_order_acquire);
+        }
+
+        /// @brief on_record(const i2c_capture_record&) for every record held when the replay starts, oldest first
+        /// @return records replayed, not counting OVERFLOW records
+        template <typename F>
+        uint32_t replay(F&& on_record) const
+        {
+            uint32_t end = head.load(std::memory_order_acquire);
+            uint32_t first = end - size();
+            uint32_t replayed = 0;
+            uint32_t lost = 0;
+
+            for (uint32_t i = first; i != end; i++)
+            {
+                slot s = slots[i & (SIZE - 1)];
+
+                // The interrupt may have come round to this slot before or while it was copied,
+                // it is writing record head into the slot of record head - SIZE
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (head.load(std::memory_order_relaxed) - i >= SIZE)
+                {
+                    lost++;
+                    continue;
+                }
+
+                if (lost)
+                {
+                    on_record(i2c_capture_record{I2C_CAPTURE_OVERFLOW, s.time_us, 0, false, lost});
+                    lost = 0;
+                }
+
+                on_record(i2c_capture_record{(i2c_capture_record_type)s.type, s.time_us, s.value, s.acknowledged, 0});
+                replayed++;
+            }
+            return replayed;
+        }
+
+    private:
+        // 16 bytes a record
+        struct slot {
+            uint64_t time_us;
+            uint8_t type;
+            uint8_t value;
+            bool acknowledged;
+        };
+
+        slot slots[SIZE];
+        std::atomic<uint32_t> head{0};
+
+        // Written by the main loop only
+        uint32_t cleared = 0;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "i2c_listener_lib.h"
+
+
+uint32_t i2c_listener::i2c_message(uint8_t data, i2c_listener_state_t state, i2c_listener_acknowledge_state_t acknowledge_state, bool acknowledged, uint8_t address)
+{
+    // [START       ADDRESS         i2c_state   ack_state   acknowledged    DATA        ]
+    // [1111 0000   0xxx xxxx       00xx        0xx         x               xxxx xxxx   ]
+    return ((uint32_t)0b11110000 << 24) | ((uint32_t)address << 16) | ((uint32_t)state << 12) | ((uint32_t)acknowledge_state << 9) | ((uint32_t)acknowledged << 8) | ((uint32_t)data);
+}
+
+void i2c_listener::sda_trigger_handler(uint32_t event)
+{
+    if (event == GPIO_IRQ_EDGE_FALL)
+    {
+        sda_level = false;
+        if (scl_level)
+        {
+            report((i2c_state == I2C_LISTENER_STATE_NULL) ? I2C_CAPTURE_START : I2C_CAPTURE_RESTART);
+            i2c_state = I2C_LISTENER_STATE_START;
+            bit_counter = 0;
+        }
+    }
+
+    else if (event == GPIO_IRQ_EDGE_RISE)
+    {
+        sda_level = true;
+        if (scl_level)
+        {
+            report(I2C_CAPTURE_STOP);
+            i2c_state = I2C_LISTENER_STATE_NULL;
+            bit_counter = 0;
+        }
+    }
+}
+
+void i2c_listener::scl_trigger_handler(uint32_t event)
+{
+    if (event == GPIO_IRQ_EDGE_RISE)
+    {
+        scl_level = true;
+
+        // if doing something
+        if (i2c_state != I2C_LISTENER_STATE_NULL)
+        {
+
+        i2c_fifo.shift_in(sda_level);
+
+        if (bit_counter == 6 && i2c_state == I2C_LISTENER_STATE_START)
+        {
+            predicted_i2c_state = (sda_level) ? I2C_LISTENER_STATE_RECEIVE : I2C_LISTENER_STATE_TRANSMIT;
+        }
+        else if ((bit_counter + 1) % 9 == 8)
+        {
+            byte = i2c_fifo.data;
+            i2c_acknowledge_state = (i2c_state == I2C_LISTENER_STATE_RECEIVE) ? I2C_LISTENER_ACKNOWLEDGE_STATE_TRANSMIT : I2C_LISTENER_ACKNOWLEDGE_STATE_RECEIVE;
+        }
+        else if ((bit_counter + 1) % 9 == 0)
+        {
+            bool address_byte = (i2c_state == I2C_LISTENER_STATE_START);
+            if (address_byte)
+                address = byte >> 1;
+
+            report(address_byte ? I2C_CAPTURE_ADDRESS : I2C_CAPTURE_DATA, byte, !sda_level);
+
+            if (_message_handler)
+            {
+                uint32_t msg = i2c_message(byte, I2C_LISTENER_STATE_START, i2c_acknowledge_state, sda_level, address);
+                _message_handler(msg);
+            }
+            i2c_acknowledge_state = I2C_LISTENER_ACKNOWLEDGE_STATE_NULL;
+            i2c_state = predicted_i2c_state;
+        }
+
+        ++bit_counter;
+        }
+
+    }
+
+    else if (event == GPIO_IRQ_EDGE_FALL)
+    {
+        scl_level = false;
+    }
+}
+
+
+static i2c_listener* global_listener;
+
+#ifdef I2C_RAW_IRQ
+static void raw_trigger_handler() {
+    global_listener->raw_trigger_handler();
+}
+#else
+static void trigger_handler(uint gpio, uint32_t events) {
+    global_listener->trigger_handler(gpio, events);
+}
+#endif
+
+
+void init_interrupts(i2c_listener& listener)
+{
+    int sda = listener.sda;
+    int scl = listener.scl;
+
+    global_listener = &listener;
+
+    hal_gpio_init(sda);
+    hal_gpio_init(scl);
+
+    hal_gpio_set_dir(sda, GPIO_IN);
+    hal_gpio_set_dir(scl, GPIO_IN);
+
+#ifdef I2C_RAW_IRQ
+    hal_gpio_add_raw_irq_handler_masked((1u << sda) | (1u << scl), &raw_trigger_handler);
+#else
+    hal_gpio_set_irq_callback(&trigger_handler);
+#endif
+
+    hal_gpio_set_irq_enabled(sda, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    hal_gpio_irq_bank_enable();
+    hal_gpio_set_irq_enabled(scl, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    hal_gpio_irq_bank_enable();
+}
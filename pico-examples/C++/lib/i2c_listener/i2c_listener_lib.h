@@ -0,0 +1,124 @@
+#ifndef I2C_LISTENER_H
+#define I2C_LISTENER_H
+
+#include "io_hal.h"
+#include "i2c_fifo.h"
+#include "i2c_bus_edges.h"
+#include "i2c_capture_format.h"
+
+// State machine for i2c
+enum i2c_listener_state_t {
+    I2C_LISTENER_STATE_START = 0,
+    I2C_LISTENER_STATE_TRANSMIT,
+    I2C_LISTENER_STATE_RECEIVE,
+    I2C_LISTENER_STATE_NULL,
+};
+
+// State machine for acknowledgement
+enum i2c_listener_acknowledge_state_t {
+    I2C_LISTENER_ACKNOWLEDGE_STATE_TRANSMIT = 0,
+    I2C_LISTENER_ACKNOWLEDGE_STATE_RECEIVE,
+    I2C_LISTENER_ACKNOWLEDGE_STATE_NULL,
+};
+
+/// @brief a function type which is given every decoded message
+/// @param message packed 32 bit message, see i2c_listener::i2c_message
+typedef void (*i2c_listener_message_handler)(uint32_t message);
+
+/// @brief a function type which is given every START, RESTART, STOP, address and data byte as it happens
+/// @param event one of the capture record types from I2C_CAPTURE_START to I2C_CAPTURE_DATA
+/// @param data the byte of an ADDRESS or DATA event
+/// @param acknowledged the receiver pulled SDA low in the 9th clock of an ADDRESS or DATA event
+typedef void (*i2c_listener_event_handler)(i2c_capture_record_type event, uint8_t data, bool acknowledged);
+
+class i2c_listener {
+    public:
+        int sda;
+        int scl;
+
+        volatile bool sda_level = false;
+        volatile bool scl_level = false;
+
+        volatile i2c_listener_state_t i2c_state = I2C_LISTENER_STATE_NULL;
+        volatile i2c_listener_acknowledge_state_t i2c_acknowledge_state = I2C_LISTENER_ACKNOWLEDGE_STATE_NULL;
+        volatile i2c_listener_state_t predicted_i2c_state = I2C_LISTENER_STATE_NULL;
+
+        fifo_8bit i2c_fifo;
+
+        i2c_listener(int sda_pin, int scl_pin, i2c_listener_message_handler message_handler) : sda(sda_pin), scl(scl_pin), _message_handler(message_handler)
+        {
+            sda_level = hal_gpio_get(sda);
+            scl_level = hal_gpio_get(scl);
+        }
+
+        // Also report bus events, for the capture format in i2c_capture_format.h
+        void set_event_handler(i2c_listener_event_handler event_handler)
+        {
+            _event_handler = event_handler;
+        }
+
+        void trigger_handler(uint gpio, uint32_t events)
+        {
+            if (gpio == (uint)sda)
+            {
+                // The sdk hands the pins over lowest first. As in i2c_order_edges, a clock fall that
+                // is still latched came before the data changed, it was no START or STOP.
+                if (scl_level && (hal_gpio_get_irq_events(scl) & GPIO_IRQ_EDGE_FALL))
+                    scl_level = false;
+                sda_trigger_handler(events);
+            }
+            else if (gpio == (uint)scl)
+            {
+                scl_trigger_handler(events);
+            }
+        }
+
+        // Handle every edge latched on both pins in the order they happened
+        void raw_trigger_handler()
+        {
+            uint32_t sda_events = hal_gpio_get_irq_events(sda) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+            uint32_t scl_events = hal_gpio_get_irq_events(scl) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+            hal_gpio_acknowledge_irq(sda, sda_events);
+            hal_gpio_acknowledge_irq(scl, scl_events);
+
+            uint32_t levels = hal_gpio_get_all();
+            i2c_bus_edge edges[I2C_BUS_EDGES_MAX];
+            uint count = i2c_order_edges(sda_events, scl_events, (levels >> sda) & 1, (levels >> scl) & 1, edges);
+
+            for (uint i = 0; i < count; i++)
+            {
+                if (edges[i].scl)
+                    scl_trigger_handler(edges[i].event);
+                else
+                    sda_trigger_handler(edges[i].event);
+            }
+        }
+
+        uint32_t message_queue;
+        uint32_t message_queue_size = 0;
+
+    private:
+        uint32_t bit_counter = 0;
+        i2c_listener_message_handler _message_handler;
+        i2c_listener_event_handler _event_handler = nullptr;
+
+        // Byte latched on the 8th clock, before the acknowledge bit shifts into the fifo
+        uint8_t byte = 0;
+        uint8_t address = 0;
+
+        void report(i2c_capture_record_type event, uint8_t data = 0, bool acknowledged = false)
+        {
+            if (_event_handler)
+                _event_handler(event, data, acknowledged);
+        }
+
+        uint32_t i2c_message(uint8_t data, i2c_listener_state_t state, i2c_listener_acknowledge_state_t acknowledge_state, bool acknowledged, uint8_t address);
+
+        void sda_trigger_handler(uint32_t event);
+        void scl_trigger_handler(uint32_t event);
+};
+
+// Attach the listener to the gpio interrupts of its pins, through a raw bank handler when I2C_RAW_IRQ is defined
+void init_interrupts(i2c_listener& listener);
+
+#endif
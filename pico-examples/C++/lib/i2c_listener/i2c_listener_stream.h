@@ -0,0 +1,75 @@
+#ifndef I2C_LISTENER_STREAM_H
+#define I2C_LISTENER_STREAM_H
+
+#include "i2c_ring_buffer.h"
+#include "i2c_capture_format.h"
+
+/*
+    Carries the listener's bus events from its interrupt handler to the main loop, which sends them
+    over USB in whole packets, encoded as described in i2c_capture_format.h.
+
+    The interrupt only appends to a ring buffer, it never waits. When the ring is full records are
+    dropped and counted, the next record that fits is preceded by an OVERFLOW record so the
+    receiving end knows exactly how many are missing. Timestamps stay correct across the gap, each
+    delta is taken from the last record that was actually written.
+*/
+
+#define I2C_LISTENER_STREAM_SIZE        4096
+#define I2C_LISTENER_PACKET_SIZE        64
+
+class i2c_listener_stream
+{
+    public:
+        // Interrupt side, give this every event from the listener along with time_us_64()
+        void write_event(i2c_capture_record_type event, uint64_t now_us, uint8_t data, bool acknowledged)
+        {
+            if (pending_dropped)
+            {
+                if (!write_record(I2C_CAPTURE_OVERFLOW, now_us, pending_dropped, false))
+                {
+                    drop();
+                    return;
+                }
+                pending_dropped = 0;
+            }
+
+            if (!write_record(event, now_us, data, acknowledged))
+                drop();
+        }
+
+        // Main loop side, see i2c_ring_buffer
+        uint32_t size() const { return ring.size(); }
+        uint32_t peek(const uint8_t** bytes) const { return ring.peek(bytes); }
+        void consume(uint32_t length) { ring.consume(length); }
+        uint32_t pop(uint8_t* bytes, uint32_t length) { return ring.pop(bytes, length); }
+
+        // Records dropped since start up
+        uint32_t get_dropped() const { return dropped; }
+
+    private:
+        i2c_ring_buffer<I2C_LISTENER_STREAM_SIZE> ring;
+
+        // Written by the interrupt only
+        i2c_capture_encoder encoder;
+        uint32_t pending_dropped = 0;
+        volatile uint32_t dropped = 0;
+
+        bool write_record(i2c_capture_record_type type, uint64_t now_us, uint32_t value, bool acknowledged)
+        {
+            uint8_t bytes[I2C_CAPTURE_MAX_RECORD];
+            uint length = encoder.encode(type, now_us, value, acknowledged, bytes);
+            if (!ring.push(bytes, length))
+                return false;
+
+            encoder.written(now_us);
+            return true;
+        }
+
+        void drop()
+        {
+            pending_dropped++;
+            dropped = dropped + 1;
+        }
+};
+
+#endif
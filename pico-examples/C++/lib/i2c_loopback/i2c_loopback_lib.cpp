@@ -0,0 +1,103 @@
+#include "i2c_loopback_lib.h"
+
+const uint i2c_loopback_speeds_hz[I2C_LOOPBACK_SPEEDS] = {
+    10000, 50000, 100000, 200000, 400000, 600000, 800000, 1000000
+};
+
+// Different in every transfer so a stale read back is caught
+static uint8_t pattern(uint transfer, uint i)
+{
+    return (transfer * 31 + i * 7) ^ 0xa5;
+}
+
+// The transfer, tried again while it is not acknowledged
+static bool attempt(i2c_software& i2c, uint8_t address, const i2c_segment* segments, uint n_segments, i2c_loopback_result& result)
+{
+    for (uint i = 0; i <= I2C_LOOPBACK_RETRIES; i++)
+    {
+        if (i > 0)
+            result.retries++;
+        if (i2c.transfer(address, segments, n_segments))
+            return true;
+        result.nacks++;
+    }
+    return false;
+}
+
+i2c_loopback_result i2c_loopback_run(uint sda_pin, uint scl_pin, uint8_t address, uint frequency_hz)
+{
+    i2c_loopback_result result = {};
+    result.frequency_hz = frequency_hz;
+
+    i2c_software i2c(sda_pin, scl_pin, frequency_hz);
+
+    uint8_t message[I2C_LOOPBACK_PAYLOAD + 1];
+    uint8_t select = 0;
+    uint8_t reply[I2C_LOOPBACK_PAYLOAD];
+
+    i2c_segment write[1] = {{message, I2C_LOOPBACK_PAYLOAD + 1, false}};
+    i2c_segment read_back[2] = {
+        {&select, 1, false},
+        {reply, I2C_LOOPBACK_PAYLOAD, true},
+    };
+
+    uint64_t start_us = hal_time_us_64();
+
+    for (uint transfer = 0; transfer < I2C_LOOPBACK_TRANSFERS; transfer++)
+    {
+        message[0] = 0;
+        for (uint i = 0; i < I2C_LOOPBACK_PAYLOAD; i++)
+            message[i + 1] = pattern(transfer, i);
+
+        if (!attempt(i2c, address, write, 1, result) || !attempt(i2c, address, read_back, 2, result))
+        {
+            result.failures++;
+            continue;
+        }
+
+        bool matched = true;
+        for (uint i = 0; i < I2C_LOOPBACK_PAYLOAD; i++)
+            matched &= reply[i] == message[i + 1];
+
+        if (matched)
+            result.transfers++;
+        else
+            result.failures++;
+    }
+
+    result.elapsed_us = hal_time_us_64() - start_us;
+    return result;
+}
+
+uint i2c_loopback_sweep(uint sda_pin, uint scl_pin, uint8_t address, i2c_loopback_result results[I2C_LOOPBACK_SPEEDS])
+{
+    uint first_failure = I2C_LOOPBACK_SPEEDS;
+    for (uint i = 0; i < I2C_LOOPBACK_SPEEDS; i++)
+    {
+        results[i] = i2c_loopback_run(sda_pin, scl_pin, address, i2c_loopback_speeds_hz[i]);
+        if (!results[i].passed() && first_failure == I2C_LOOPBACK_SPEEDS)
+            first_failure = i;
+    }
+    return first_failure;
+}
+
+void i2c_loopback_print(const char* backend, const i2c_loopback_result results[I2C_LOOPBACK_SPEEDS])
+{
+    printf("%s slave, %u transfers of %u bytes each way per speed\n", backend, I2C_LOOPBACK_TRANSFERS, I2C_LOOPBACK_PAYLOAD);
+    printf("%10s %10s %8s %8s %8s %8s\n", "scl hz", "bytes/s", "ok", "nacks", "retries", "failed");
+
+    const i2c_loopback_result* first_failure = nullptr;
+    for (uint i = 0; i < I2C_LOOPBACK_SPEEDS; i++)
+    {
+        const i2c_loopback_result& r = results[i];
+        printf("%10u %10lu %8u %8u %8u %8u\n", r.frequency_hz, (unsigned long)r.bytes_per_second(),
+               r.transfers, r.nacks, r.retries, r.failures);
+        if (!r.passed() && first_failure == nullptr)
+            first_failure = &r;
+    }
+
+    if (first_failure)
+        printf("%s slave: first failing speed %u Hz\n", backend, first_failure->frequency_hz);
+    else
+        printf("%s slave: no failures up to %u Hz\n", backend, results[I2C_LOOPBACK_SPEEDS - 1].frequency_hz);
+}
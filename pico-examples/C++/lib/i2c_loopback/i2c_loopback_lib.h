@@ -0,0 +1,54 @@
+#ifndef I2C_LOOPBACK_H
+#define I2C_LOOPBACK_H
+
+#include "io_hal.h"
+#include "i2c_software_master_lib.h"
+
+/*
+    Throughput sweep of the software master against a slave on the same board, or on the same
+    simulated bus on the host.
+
+    The slave must be listening at the given address as a register bank of at least
+    I2C_LOOPBACK_REGISTERS registers. At each speed the master writes a pattern from register 0,
+    reads it back with a repeated START and compares, I2C_LOOPBACK_TRANSFERS times. A transfer
+    that is not acknowledged is tried again up to I2C_LOOPBACK_RETRIES times, one that still fails
+    or reads back wrong fails the speed.
+*/
+
+#define I2C_LOOPBACK_REGISTERS      32
+#define I2C_LOOPBACK_PAYLOAD        16
+#define I2C_LOOPBACK_TRANSFERS      100
+#define I2C_LOOPBACK_RETRIES        3
+
+// 10 kHz to 1 MHz
+#define I2C_LOOPBACK_SPEEDS         8
+extern const uint i2c_loopback_speeds_hz[I2C_LOOPBACK_SPEEDS];
+
+struct i2c_loopback_result {
+    uint frequency_hz;
+    uint transfers;         // write and read back pairs that completed and matched
+    uint nacks;             // attempts not acknowledged
+    uint retries;           // attempts made again after a NACK
+    uint failures;          // transfers that gave up or read back wrong
+    uint64_t elapsed_us;
+
+    bool passed() const { return failures == 0; }
+
+    // Payload bytes written and read back per second
+    uint32_t bytes_per_second() const
+    {
+        return elapsed_us ? (uint32_t)((uint64_t)transfers * 2 * I2C_LOOPBACK_PAYLOAD * 1000000 / elapsed_us) : 0;
+    }
+};
+
+/// @brief run the transfers at one speed
+i2c_loopback_result i2c_loopback_run(uint sda_pin, uint scl_pin, uint8_t address, uint frequency_hz);
+
+/// @brief run every speed in i2c_loopback_speeds_hz, slowest first
+/// @return index of the first speed that failed, I2C_LOOPBACK_SPEEDS if none did
+uint i2c_loopback_sweep(uint sda_pin, uint scl_pin, uint8_t address, i2c_loopback_result results[I2C_LOOPBACK_SPEEDS]);
+
+/// @brief print a table of the results and the first failing speed
+void i2c_loopback_print(const char* backend, const i2c_loopback_result results[I2C_LOOPBACK_SPEEDS]);
+
+#endif
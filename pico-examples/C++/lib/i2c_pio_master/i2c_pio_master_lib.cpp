@@ -0,0 +1,253 @@
+#include "i2c_pio_master_lib.h"
+#include "i2c_pio_master.pio.h"
+
+// State machine cycles per bit, see i2c_pio_master.pio
+#define I2C_PIO_MASTER_CYCLES_PER_BIT   16
+
+// How long the CPU waits between looks at the engine
+#define I2C_PIO_MASTER_POLL_CYCLES      32
+
+// The program is loaded once per PIO block
+static int i2c_pio_master_offsets[NUM_PIOS] = {-1, -1};
+
+
+i2c_pio_master::i2c_pio_master(PIO pio, uint sda_pin, uint scl_pin, uint frequency_hz)
+{
+    // The program reads SCL as the pin after SDA
+    assert(scl_pin == sda_pin + 1);
+    (void)scl_pin;
+
+    uint pio_index = pio_get_index(pio);
+    if (i2c_pio_master_offsets[pio_index] < 0)
+    {
+        assert(pio_can_add_program(pio, &i2c_pio_master_program));
+        i2c_pio_master_offsets[pio_index] = pio_add_program(pio, &i2c_pio_master_program);
+    }
+
+    _pio = pio;
+    offset = i2c_pio_master_offsets[pio_index];
+    sm = pio_claim_unused_sm(pio, true);
+    tx_dma = dma_claim_unused_channel(true);
+    rx_dma = dma_claim_unused_channel(true);
+
+    float clkdiv = (float)hal_clock_sys_hz() / (I2C_PIO_MASTER_CYCLES_PER_BIT * frequency_hz);
+    i2c_pio_master_program_init(pio, sm, offset, sda_pin, clkdiv);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+i2c_pio_master::~i2c_pio_master()
+{
+    dma_channel_abort(tx_dma);
+    dma_channel_abort(rx_dma);
+    dma_channel_unclaim(tx_dma);
+    dma_channel_unclaim(rx_dma);
+
+    pio_sm_set_enabled(_pio, sm, false);
+    pio_sm_unclaim(_pio, sm);
+}
+
+bool i2c_pio_master::write_bytes(uint8_t address, const uint8_t* data, uint n_bytes)
+{
+    // The payload goes straight from the buffer to the FIFO behind the address
+    bool acknowledged = start_condition()
+                     && put_header(i2c_pio_master_offset_write, n_bytes + 1)
+                     && put((uint32_t)address << 25)
+                     && send(data, n_bytes);
+
+    return end_transfer(acknowledged);
+}
+
+bool i2c_pio_master::read_bytes(uint8_t address, uint8_t* data, uint n_bytes)
+{
+    if (n_bytes == 0)
+        return true;
+
+    // Each byte the engine pushes goes straight from the FIFO to the buffer
+    bool acknowledged = start_condition()
+                     && put_header(i2c_pio_master_offset_write, 1)
+                     && put((uint32_t)((address << 1) | 1) << 24)
+                     && put_header(i2c_pio_master_offset_read, n_bytes)
+                     && receive(data, n_bytes);
+
+    return end_transfer(acknowledged);
+}
+
+bool i2c_pio_master::transfer(uint8_t address, const i2c_segment* segments, uint n_segments)
+{
+    if (!i2c_segments_valid(segments, n_segments))
+        return false;
+
+    bool acknowledged = true;
+    uint i = 0;
+    while (i < n_segments && acknowledged)
+    {
+        // A phase is the run of segments going the same way, its length goes in one header so
+        // the engine only leaves the last byte of a read unacknowledged
+        bool read = segments[i].read;
+        uint end = i;
+        uint n_bytes = 0;
+        while (end < n_segments && segments[end].read == read)
+            n_bytes += segments[end++].n_bytes;
+
+        if (read)
+        {
+            acknowledged = start_condition()
+                        && put_header(i2c_pio_master_offset_write, 1)
+                        && put((uint32_t)((address << 1) | 1) << 24)
+                        && put_header(i2c_pio_master_offset_read, n_bytes);
+        }
+        else
+        {
+            acknowledged = start_condition()
+                        && put_header(i2c_pio_master_offset_write, n_bytes + 1)
+                        && put((uint32_t)address << 25);
+        }
+
+        for (; i < end && acknowledged; i++)
+        {
+            if (read)
+                acknowledged = receive(segments[i].data, segments[i].n_bytes);
+            else
+                acknowledged = send(segments[i].data, segments[i].n_bytes);
+        }
+        i = end;
+    }
+
+    return end_transfer(acknowledged);
+}
+
+bool i2c_pio_master::send(const uint8_t* data, uint n_bytes)
+{
+    if (n_bytes == 0)
+        return true;
+
+    dma_channel_config c = dma_channel_get_default_config(tx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, sm, true));
+    dma_channel_configure(tx_dma, &c, &_pio->txf[sm], data, n_bytes, true);
+
+    return wait_for(tx_dma);
+}
+
+bool i2c_pio_master::receive(uint8_t* data, uint n_bytes)
+{
+    if (n_bytes == 0)
+        return true;
+
+    dma_channel_config c = dma_channel_get_default_config(rx_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(_pio, sm, false));
+    dma_channel_configure(rx_dma, &c, data, &_pio->rxf[sm], n_bytes, true);
+
+    return wait_for(rx_dma);
+}
+
+bool i2c_pio_master::nacked()
+{
+    // The engine raises its relative irq 0 and waits there
+    return pio_interrupt_get(_pio, sm);
+}
+
+bool i2c_pio_master::put(uint32_t word)
+{
+    while (pio_sm_is_tx_fifo_full(_pio, sm))
+    {
+        if (nacked())
+            return false;
+        hal_busy_wait_cycles(I2C_PIO_MASTER_POLL_CYCLES);
+    }
+    pio_sm_put(_pio, sm, word);
+    return true;
+}
+
+bool i2c_pio_master::put_header(uint routine, uint count)
+{
+    return put(((count - 1) << 16) | ((offset + routine) << 11));
+}
+
+bool i2c_pio_master::put_exec(uint instruction)
+{
+    return put(instruction << 16);
+}
+
+bool i2c_pio_master::start_condition()
+{
+    uint release = pio_encode_sideset_opt(1, 0);
+    uint hold = pio_encode_sideset_opt(1, 1);
+    uint delay = pio_encode_delay(7);
+
+    // SDA is already released when idle or after an acknowledge, so this is a repeated START too
+    return put_header(i2c_pio_master_offset_exec, 4)
+        && put_exec(pio_encode_set(pio_pindirs, 0) | release | delay)
+        && put_exec(pio_encode_wait_pin(true, 1) | delay)
+        && put_exec(pio_encode_set(pio_pindirs, 1) | delay)
+        && put_exec(pio_encode_nop() | hold | delay);
+}
+
+bool i2c_pio_master::stop_condition()
+{
+    uint release = pio_encode_sideset_opt(1, 0);
+    uint delay = pio_encode_delay(7);
+
+    return put_header(i2c_pio_master_offset_exec, 4)
+        && put_exec(pio_encode_set(pio_pindirs, 1) | delay)
+        && put_exec(pio_encode_nop() | release | delay)
+        && put_exec(pio_encode_wait_pin(true, 1) | delay)
+        && put_exec(pio_encode_set(pio_pindirs, 0) | delay);
+}
+
+bool i2c_pio_master::wait_for(uint channel)
+{
+    while (dma_channel_is_busy(channel))
+    {
+        if (nacked())
+            return false;
+        hal_busy_wait_cycles(I2C_PIO_MASTER_POLL_CYCLES);
+    }
+    return true;
+}
+
+bool i2c_pio_master::wait_idle()
+{
+    // Done once the engine has taken everything and is waiting for the next header
+    while (!pio_sm_is_tx_fifo_empty(_pio, sm) || pio_sm_get_pc(_pio, sm) != offset + i2c_pio_master_offset_frame)
+    {
+        if (nacked())
+            return false;
+        hal_busy_wait_cycles(I2C_PIO_MASTER_POLL_CYCLES);
+    }
+    return true;
+}
+
+void i2c_pio_master::abort()
+{
+    dma_channel_abort(tx_dma);
+    dma_channel_abort(rx_dma);
+
+    // SCL is held low where the engine stopped, drop whatever was queued and go back to the top
+    pio_sm_set_enabled(_pio, sm, false);
+    pio_sm_clear_fifos(_pio, sm);
+    pio_sm_restart(_pio, sm);
+    pio_interrupt_clear(_pio, sm);
+    pio_sm_exec(_pio, sm, pio_encode_jmp(offset + i2c_pio_master_offset_frame));
+    pio_sm_set_enabled(_pio, sm, true);
+}
+
+bool i2c_pio_master::end_transfer(bool acknowledged)
+{
+    // The STOP is queued behind the payload, a NACK of the last bytes still turns up here
+    if (acknowledged)
+        acknowledged = stop_condition() && wait_idle();
+
+    if (!acknowledged)
+    {
+        abort();
+        stop_condition();
+        wait_idle();
+    }
+    return acknowledged;
+}
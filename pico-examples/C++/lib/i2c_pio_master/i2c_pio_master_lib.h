@@ -0,0 +1,70 @@
+#ifndef I2C_PIO_MASTER_H
+#define I2C_PIO_MASTER_H
+
+#include <assert.h>
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+
+#include "io_hal.h"
+#include "i2c_segment.h"
+
+/*
+    I2C master running on the PIO, an alternative to bit banging in i2c_software.
+
+    i2c_pio_master.pio drives both lines open drain and waits out clock stretching, the CPU only
+    writes the START, the address and the STOP. The payload is moved between the buffer and the
+    state machine's FIFOs by DMA, so a long transfer costs the CPU the same few words as a short
+    one and the wait for it to finish.
+
+    The program fills a whole PIO block, the software or PIO slave can have the other one.
+*/
+
+class i2c_pio_master
+{
+    public:
+        /// @param sda_pin SDA, SCL must be the next pin
+        i2c_pio_master(PIO pio, uint sda_pin, uint scl_pin, uint frequency_hz);
+
+        // Gives the state machine and DMA channels back, the program stays loaded for the next one
+        ~i2c_pio_master();
+
+        i2c_pio_master(const i2c_pio_master&) = delete;
+        i2c_pio_master& operator=(const i2c_pio_master&) = delete;
+
+        /// @return false if the address or a byte was not acknowledged
+        bool write_bytes(uint8_t address, const uint8_t* data, uint n_bytes);
+        bool read_bytes(uint8_t address, uint8_t* data, uint n_bytes);
+
+        /// @brief the segments as one transaction, a repeated START between directions, see i2c_segment.h
+        bool transfer(uint8_t address, const i2c_segment* segments, uint n_segments);
+
+    private:
+        PIO _pio;
+        uint sm;
+        uint offset;
+        uint tx_dma;
+        uint rx_dma;
+
+        bool nacked();
+
+        // Each waits for room in the FIFO, false if the engine stopped on a NACK first
+        bool put(uint32_t word);
+        bool put_header(uint routine, uint count);
+        bool put_exec(uint instruction);
+
+        bool start_condition();
+        bool stop_condition();
+
+        // Move a buffer to or from the engine by DMA and wait for it, false on a NACK
+        bool send(const uint8_t* data, uint n_bytes);
+        bool receive(uint8_t* data, uint n_bytes);
+
+        // Wait for a DMA channel or for the engine to finish, false on a NACK
+        bool wait_for(uint channel);
+        bool wait_idle();
+
+        void abort();
+        bool end_transfer(bool acknowledged);
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "i2c_pio_slave_lib.h"
+#include "i2c_pio_slave.pio.h"
+
+// Frames written to the engine, see i2c_pio_slave.pio
+#define I2C_PIO_SLAVE_RECEIVE_FRAME     (1u << 23)
+#define I2C_PIO_SLAVE_ADDRESS_MARK      (~0x1ffu)
+
+static i2c_pio_slave* i2c_pio_slave_instances[I2C_PIO_SLAVE_MAX_INSTANCES];
+static uint number_of_i2c_pio_slave_instances = 0;
+
+// Both programs are loaded once per PIO block and shared by every slave on it
+static int i2c_pio_slave_engine_offsets[NUM_PIOS] = {-1, -1};
+static int i2c_pio_slave_condition_offsets[NUM_PIOS] = {-1, -1};
+
+
+// Claim a state machine and the one after it, the engine waits on an irq raised relative to its neighbour
+static int claim_state_machine_pair(PIO pio)
+{
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+    {
+        uint next = (sm + 1) % NUM_PIO_STATE_MACHINES;
+        if (!pio_sm_is_claimed(pio, sm) && !pio_sm_is_claimed(pio, next))
+        {
+            pio_sm_claim(pio, sm);
+            pio_sm_claim(pio, next);
+            return sm;
+        }
+    }
+    return -1;
+}
+
+static void i2c_pio_slave_start(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                                i2c_register_bank* bank, i2c_slave_event_queue* queue);
+
+
+void i2c_pio_slave_init(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler)
+{
+    i2c_pio_slave_start(pio, sda_pin, scl_pin, slave_address, event_handler, nullptr, nullptr);
+}
+
+void i2c_pio_slave_init_register_bank(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_register_bank* bank)
+{
+    i2c_pio_slave_start(pio, sda_pin, scl_pin, slave_address, nullptr, bank, nullptr);
+}
+
+void i2c_pio_slave_init_deferred(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_slave_event_queue* queue)
+{
+    i2c_pio_slave_start(pio, sda_pin, scl_pin, slave_address, nullptr, nullptr, queue);
+}
+
+static void i2c_pio_slave_start(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                                i2c_register_bank* bank, i2c_slave_event_queue* queue)
+{
+    // The program reads SCL as the pin after SDA
+    assert(scl_pin == sda_pin + 1);
+    (void)scl_pin;
+    assert(number_of_i2c_pio_slave_instances < I2C_PIO_SLAVE_MAX_INSTANCES);
+
+    uint pio_index = pio_get_index(pio);
+    uint pio_irq = pio_index ? PIO1_IRQ_0 : PIO0_IRQ_0;
+
+    if (i2c_pio_slave_engine_offsets[pio_index] < 0)
+    {
+        assert(pio_can_add_program(pio, &i2c_pio_slave_program));
+        i2c_pio_slave_engine_offsets[pio_index] = pio_add_program(pio, &i2c_pio_slave_program);
+
+        assert(pio_can_add_program(pio, &i2c_pio_slave_condition_program));
+        i2c_pio_slave_condition_offsets[pio_index] = pio_add_program(pio, &i2c_pio_slave_condition_program);
+
+        irq_add_shared_handler(pio_irq, &i2c_pio_slave_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    }
+
+    int sm = claim_state_machine_pair(pio);
+    assert(sm >= 0);
+
+    // create new i2c_pio_slave instance
+    i2c_pio_slave* slave = new i2c_pio_slave(pio, sm, i2c_pio_slave_engine_offsets[pio_index], sda_pin, slave_address, event_handler, bank, queue);
+    i2c_pio_slave_instances[number_of_i2c_pio_slave_instances] = slave;
+    number_of_i2c_pio_slave_instances++;
+
+    i2c_pio_slave_program_init(pio, slave->get_engine_sm(), i2c_pio_slave_engine_offsets[pio_index], sda_pin);
+    i2c_pio_slave_condition_program_init(pio, slave->get_condition_sm(), i2c_pio_slave_condition_offsets[pio_index], sda_pin);
+
+    // Load the address into x with every bit above it set, restarting the engine never clears x
+    pio_sm_put(pio, slave->get_engine_sm(), ~0x7fu | slave_address);
+    pio_sm_exec(pio, slave->get_engine_sm(), pio_encode_pull(false, true));
+    pio_sm_exec(pio, slave->get_engine_sm(), pio_encode_mov(pio_x, pio_osr));
+
+    // One interrupt for a byte from the engine or a condition from the detector
+    pio_set_irq0_source_enabled(pio, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + slave->get_engine_sm()), true);
+    pio_set_irq0_source_enabled(pio, (enum pio_interrupt_source)(pis_sm0_rx_fifo_not_empty + slave->get_condition_sm()), true);
+    irq_set_enabled(pio_irq, true);
+
+    slave->arm();
+    pio_sm_set_enabled(pio, slave->get_condition_sm(), true);
+}
+
+void i2c_pio_slave_irq_handler()
+{
+    for (uint i = 0; i < number_of_i2c_pio_slave_instances; i++)
+    {
+        i2c_pio_slave_instances[i]->service();
+    }
+}
+
+void i2c_pio_slave::arm()
+{
+    pio_sm_set_enabled(_pio, engine_sm, false);
+    pio_sm_clear_fifos(_pio, engine_sm);
+    pio_sm_restart(_pio, engine_sm);
+
+    // Let go of both lines in case a frame was cut short
+    pio_sm_set_pindirs_with_mask(_pio, engine_sm, 0, (1u << sda) | (1u << scl));
+
+    // Empty the OSR so the first frame after the address is pulled from the FIFO
+    pio_sm_exec(_pio, engine_sm, pio_encode_mov(pio_osr, pio_null));
+    pio_sm_exec(_pio, engine_sm, pio_encode_out(pio_null, 32));
+    pio_sm_exec(_pio, engine_sm, pio_encode_jmp(engine_offset + i2c_pio_slave_offset_start));
+
+    pio_sm_set_enabled(_pio, engine_sm, true);
+}
+
+void i2c_pio_slave::service()
+{
+    while (!pio_sm_is_rx_fifo_empty(_pio, engine_sm))
+    {
+        uint32_t next_frame = pio_sm_get(_pio, engine_sm);
+
+        // An address frame belongs to a new transfer, report the START in front of it first
+        if ((next_frame & I2C_PIO_SLAVE_ADDRESS_MARK) == I2C_PIO_SLAVE_ADDRESS_MARK)
+        {
+            while (!pio_sm_is_rx_fifo_empty(_pio, condition_sm))
+                condition(pio_sm_get(_pio, condition_sm));
+        }
+        frame(next_frame);
+    }
+
+    while (!pio_sm_is_rx_fifo_empty(_pio, condition_sm))
+        condition(pio_sm_get(_pio, condition_sm));
+}
+
+inline void i2c_pio_slave::notify(i2c_software_slave_event event)
+{
+    if (queue != nullptr)
+    {
+        queue->post(data, byte_number, event);
+        return;
+    }
+
+    if (bank == nullptr)
+    {
+        _event_handler(data, byte_number, event);
+        return;
+    }
+
+    switch (event)
+    {
+    case I2C_SLAVE_RECEIVE:
+        bank->receive(data, byte_number);
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        data = bank->request();
+        break;
+
+    case I2C_SLAVE_STOP:
+        bank->stop();
+        break;
+
+    default:
+        break;
+    }
+}
+
+void i2c_pio_slave::condition(uint32_t sda_level)
+{
+    // SDA is low straight after a START
+    if (sda_level == 0)
+    {
+        // The engine takes the irq itself while it is waiting, if it is still set the engine was
+        // busy with the previous transfer and this is a repeated START
+        if (pio_interrupt_get(_pio, 4 + condition_sm))
+            arm();
+
+        i2c_state = I2C_PIO_SLAVE_STATE_ADDRESS;
+        byte_number = 0;
+        data = 0;
+        notify(I2C_SLAVE_START);
+    }
+    else
+    {
+        // A late CPU can get to this STOP after the next START. If the engine has already taken
+        // that START's irq it is reading the new address and is left to it, restarting it would
+        // have it wait for a START that has passed. Otherwise it is still in the transfer that
+        // stopped and is restarted. It is held while this is decided so it cannot take the irq
+        // in between, a few cycles against a bus free time of at least 0.5 us.
+        pio_sm_set_enabled(_pio, engine_sm, false);
+        bool next_started = !pio_sm_is_rx_fifo_empty(_pio, condition_sm) && !pio_interrupt_get(_pio, 4 + condition_sm);
+        if (next_started)
+            pio_sm_set_enabled(_pio, engine_sm, true);
+        else
+            arm();
+
+        i2c_state = I2C_PIO_SLAVE_STATE_NULL;
+        byte_number = 0;
+        data = 0;
+        notify(I2C_SLAVE_STOP);
+    }
+}
+
+void i2c_pio_slave::frame(uint32_t frame)
+{
+    uint8_t byte = (frame >> 1) & 0xff;
+    bool acknowledged = !(frame & 1);
+
+    switch (i2c_state)
+    {
+    case I2C_PIO_SLAVE_STATE_ADDRESS:
+        byte_number = 0;
+        // Read / write bit, a 1 is a read by the master
+        if (byte & 1)
+        {
+            i2c_state = I2C_PIO_SLAVE_STATE_TRANSMIT;
+            transmit();
+        }
+        else
+        {
+            i2c_state = I2C_PIO_SLAVE_STATE_RECEIVE;
+            // One acknowledge at a time, a late CPU then stretches the clock at the next byte
+            // instead of the engine acknowledging bytes ahead of it, counting the clock of a
+            // repeated START as a bit and pulling SDA low on the read / write bit after it
+            receive();
+        }
+        break;
+
+    case I2C_PIO_SLAVE_STATE_RECEIVE:
+        data = byte;
+        byte_number++;
+        notify(I2C_SLAVE_RECEIVE);
+        receive();
+        break;
+
+    case I2C_PIO_SLAVE_STATE_TRANSMIT:
+        // The master does not acknowledge the last byte it wants
+        if (!acknowledged)
+        {
+            i2c_state = I2C_PIO_SLAVE_STATE_NULL;
+            arm();
+            break;
+        }
+        byte_number++;
+        transmit();
+        break;
+
+    default:
+        break;
+    }
+}
+
+void i2c_pio_slave::transmit()
+{
+    notify(I2C_SLAVE_REQUEST);
+
+    // Inverted as a 1 pulls SDA low, the 0 after the byte releases SDA for the acknowledge
+    pio_sm_put(_pio, engine_sm, (uint32_t)(uint8_t)~data << 24);
+}
+
+void i2c_pio_slave::receive()
+{
+    pio_sm_put(_pio, engine_sm, I2C_PIO_SLAVE_RECEIVE_FRAME);
+}
@@ -0,0 +1,119 @@
+#ifndef I2C_PIO_SLAVE_H
+#define I2C_PIO_SLAVE_H
+
+#include <assert.h>
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+
+#include "i2c_slave_event.h"
+#include "i2c_register_bank.h"
+#include "i2c_slave_event_queue.h"
+
+/*
+    I2C slave running on the PIO, an alternative to the GPIO interrupt engine in i2c_software_slave.
+
+    START / STOP detection, address matching, the bit shifting and every acknowledge happen in
+    i2c_pio_slave.pio, the CPU is interrupted once per byte instead of four times per bit. The
+    event handler is called with exactly the same events as i2c_software_slave.
+
+    Each slave uses a pair of neighbouring state machines on one PIO block. If the CPU has not
+    supplied the next byte by the time it is needed the engine holds SCL low until it has, a
+    master which does not allow clock stretching must leave the CPU enough time instead.
+
+    After a read the engine goes back to waiting for a START as soon as the master does not
+    acknowledge, after a write or a repeated START only the CPU restarts it from the PIO
+    interrupt. A STOP at the end of a write must be serviced before the first address bit of
+    the next transfer, and a repeated START within the 8 bit times of the address after it,
+    otherwise the engine counts them as data and drives the acknowledge on the read / write bit.
+*/
+
+#define I2C_PIO_SLAVE_MAX_INSTANCES (NUM_PIOS * NUM_PIO_STATE_MACHINES / 2)
+
+// State of the current transfer as seen by the CPU
+enum i2c_pio_slave_state_t {
+    I2C_PIO_SLAVE_STATE_ADDRESS = 1,
+    I2C_PIO_SLAVE_STATE_TRANSMIT,
+    I2C_PIO_SLAVE_STATE_RECEIVE,
+    I2C_PIO_SLAVE_STATE_NULL,
+};
+
+class i2c_pio_slave
+{
+    public:
+        i2c_pio_slave(PIO pio, uint sm, uint offset, uint sda_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                      i2c_register_bank* register_bank = nullptr, i2c_slave_event_queue* event_queue = nullptr)
+        {
+            _pio = pio;
+            engine_sm = sm;
+            condition_sm = (sm + 1) % NUM_PIO_STATE_MACHINES;
+            engine_offset = offset;
+
+            sda = sda_pin;
+            scl = sda_pin + 1;
+            i2c_address = slave_address;
+
+            _event_handler = event_handler;
+            bank = register_bank;
+            queue = event_queue;
+
+            i2c_state = I2C_PIO_SLAVE_STATE_NULL;
+            byte_number = 0;
+            data = 0;
+        }
+
+        // Restart the engine waiting for the next START, releasing both lines
+        void arm();
+
+        // Empty both receive FIFOs, called from the PIO interrupt
+        void service();
+
+        PIO get_pio() { return _pio; }
+        uint get_engine_sm() { return engine_sm; }
+        uint get_condition_sm() { return condition_sm; }
+
+    private:
+        PIO _pio;
+        uint engine_sm;
+        uint condition_sm;
+        uint engine_offset;
+
+        uint sda;
+        uint scl;
+        uint8_t i2c_address;
+        i2c_software_slave_event_handler _event_handler;
+
+        // Served straight from the interrupt instead of calling the event handler, when set
+        i2c_register_bank* bank;
+
+        // Events posted for the main loop instead of calling the event handler, when set
+        i2c_slave_event_queue* queue;
+
+        volatile i2c_pio_slave_state_t i2c_state;
+        volatile uint byte_number;
+        volatile uint8_t data;
+
+        // Hand an event to the register bank, the event queue or the event handler
+        inline void notify(i2c_software_slave_event event);
+
+        void condition(uint32_t sda_level);
+        void frame(uint32_t frame);
+
+        void transmit();
+        void receive();
+};
+
+/// @brief start a slave on a pair of free state machines of a PIO block
+/// @param pio pio0 or pio1
+/// @param sda_pin SDA, SCL must be the next pin
+void i2c_pio_slave_init(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler);
+
+/// @brief start a slave in register bank mode, see i2c_register_bank.h
+void i2c_pio_slave_init_register_bank(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_register_bank* bank);
+
+/// @brief start a slave whose events are run from the main loop, see i2c_slave_event_queue.h
+void i2c_pio_slave_init_deferred(PIO pio, uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_slave_event_queue* queue);
+
+// Shared handler for PIO0_IRQ_0 and PIO1_IRQ_0
+void i2c_pio_slave_irq_handler();
+
+#endif
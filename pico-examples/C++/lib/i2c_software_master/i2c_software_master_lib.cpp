@@ -0,0 +1,335 @@
+#include "i2c_software_master_lib.h"
+
+const int on = 1;
+const int off = 0;
+
+
+void set_bit(const uint location, const bool value, uint8_t& byte)
+{
+    byte = (byte & ~(0x01 << location)) | ((uint8_t)value << location);
+}
+
+
+i2c_software::i2c_software(int sda_pin, int scl_pin, int frequency_hz)
+{
+    sda = sda_pin;
+    scl = scl_pin;
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+    // The PIO engine clocks the bus and DMA moves the bytes, pio0 is left to the PIO slave
+    pio_master = new i2c_pio_master(pio1, sda_pin, scl_pin, frequency_hz);
+#else
+    // Round the bit once and split it so the phases add up to the whole bit
+    uint32_t bit_cycles = (hal_clock_sys_hz() + frequency_hz / 2) / frequency_hz;
+    setup_cycles = bit_cycles / 4;
+    high_cycles = bit_cycles / 2;
+    hold_cycles = bit_cycles - setup_cycles - high_cycles;
+
+    sda_mask = 1u << sda;
+    scl_mask = 1u << scl;
+
+    hal_gpio_init(sda);
+    hal_gpio_init(scl);
+
+    // Output level low for good, the lines start released
+    hal_gpio_clr_mask(sda_mask | scl_mask);
+    hal_gpio_set_dir_in_masked(sda_mask | scl_mask);
+
+    hal_gpio_set_slew_rate(sda, GPIO_SLEW_RATE_FAST);
+    hal_gpio_set_slew_rate(scl, GPIO_SLEW_RATE_FAST);
+#endif
+}
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+i2c_software::~i2c_software()
+{
+    delete pio_master;
+}
+#endif
+
+// Both go through transfer() so the bit banged and PIO masters end them the same way
+bool i2c_software::write_bytes(uint8_t address, uint8_t* data, uint n_bytes)
+{
+    i2c_segment segment = {data, n_bytes, false};
+    return transfer(address, &segment, 1);
+}
+
+bool i2c_software::read_bytes(uint8_t address, uint8_t* data, uint n_bytes)
+{
+    i2c_segment segment = {data, n_bytes, true};
+    return transfer(address, &segment, 1);
+}
+
+bool i2c_software::write_read(uint8_t address, const uint8_t* tx, uint tx_len, uint8_t* rx, uint rx_len)
+{
+    // The tx segment is only ever read from
+    i2c_segment segments[2] = {
+        {const_cast<uint8_t*>(tx), tx_len, false},
+        {rx, rx_len, true},
+    };
+    return transfer(address, segments, 2);
+}
+
+#ifndef I2C_SOFTWARE_MASTER_PIO
+// Whether the segment is the end of a read phase, read segments are never empty
+static bool ends_read_phase(const i2c_segment* segments, uint n_segments, uint index)
+{
+    return index + 1 == n_segments || !segments[index + 1].read;
+}
+#endif
+
+bool i2c_software::transfer(uint8_t address, const i2c_segment* segments, uint n_segments)
+{
+#ifdef I2C_SOFTWARE_MASTER_PIO
+    return pio_master->transfer(address, segments, n_segments);
+#else
+    error = I2C_SOFTWARE_OK;
+    if (!i2c_segments_valid(segments, n_segments))
+        return false;
+
+    bool acknowledged = true;
+    for (uint i = 0; i < n_segments && acknowledged; i++)
+    {
+        const i2c_segment& segment = segments[i];
+
+        // The first segment and every change of direction address the device after a START
+        if (i == 0 || segment.read != segments[i - 1].read)
+            acknowledged = start_communication_with(address, segment.read);
+
+        bool last_segment = segment.read && ends_read_phase(segments, n_segments, i);
+        for (uint j = 0; j < segment.n_bytes && acknowledged; j++)
+        {
+            if (segment.read)
+                segment.data[j] = read_byte(!(last_segment && j == segment.n_bytes - 1));
+            else
+                acknowledged = write_byte(segment.data[j]);
+        }
+    }
+
+    if (error != I2C_SOFTWARE_OK)
+    {
+        release_bus();
+        return false;
+    }
+    stop_condition();
+    return acknowledged;
+#endif
+}
+
+i2c_scan_result i2c_software::scan()
+{
+    i2c_scan_result result = {};
+    for (uint8_t address = I2C_SCAN_FIRST_ADDRESS; address <= I2C_SCAN_LAST_ADDRESS; address++)
+    {
+        if (probe(address))
+            i2c_scan_set(&result, address);
+    }
+    return result;
+}
+
+bool i2c_software::probe(uint8_t address)
+{
+#ifdef I2C_SOFTWARE_MASTER_PIO
+    return pio_master->write_bytes(address, nullptr, 0);
+#else
+    // No retries, a missing device is the common case here
+    error = I2C_SOFTWARE_OK;
+    bool acknowledged = start_communication_with(address, false);
+    if (error != I2C_SOFTWARE_OK)
+    {
+        release_bus();
+        return false;
+    }
+    stop_condition();
+    return acknowledged;
+#endif
+}
+
+#ifndef I2C_SOFTWARE_MASTER_PIO
+// Every phase ends in a pin write, which is taken off the wait
+void i2c_software::wait(uint32_t cycles)
+{
+    hal_busy_wait_cycles((cycles > HAL_GPIO_PUT_CYCLES) ? cycles - HAL_GPIO_PUT_CYCLES : 0);
+}
+
+// High lets go of the line, low pulls it down
+void i2c_software::set_sda(bool value)
+{
+    if (value)
+        hal_gpio_set_dir_in_masked(sda_mask);
+    else
+        hal_gpio_set_dir_out_masked(sda_mask);
+}
+
+bool i2c_software::get_sda()
+{
+    return hal_gpio_get(sda);
+}
+
+void i2c_software::set_scl(bool value)
+{
+    if (!value)
+    {
+        hal_gpio_set_dir_out_masked(scl_mask);
+        return;
+    }
+
+    // A slave may hold SCL low to stretch the clock, the high phase starts once it lets go
+    hal_gpio_set_dir_in_masked(scl_mask);
+    if (hal_gpio_get(scl))
+        return;
+
+    uint64_t give_up_us = hal_time_us_64() + I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US;
+    while (!hal_gpio_get(scl))
+    {
+        if (hal_time_us_64() >= give_up_us)
+        {
+            error = I2C_SOFTWARE_STRETCH_TIMEOUT;
+            return;
+        }
+        hal_busy_wait_cycles(1);
+    }
+}
+
+void i2c_software::release_bus()
+{
+    hal_gpio_set_dir_in_masked(sda_mask | scl_mask);
+}
+
+void i2c_software::start_condition()
+{
+    if (error != I2C_SOFTWARE_OK)
+        return;
+
+    // SDA falls half way through a clock high
+    set_sda(on);
+    wait(setup_cycles);
+    set_scl(on);
+    wait(high_cycles / 2);
+
+    // Another master already has the bus
+    if (error == I2C_SOFTWARE_OK && !get_sda())
+        error = I2C_SOFTWARE_ARBITRATION_LOST;
+    if (error != I2C_SOFTWARE_OK)
+        return;
+
+    set_sda(off);
+    wait(high_cycles - high_cycles / 2);
+    set_scl(off);
+    wait(hold_cycles);
+}
+
+void i2c_software::stop_condition()
+{
+    set_sda(off);
+    set_scl(off);
+    wait(setup_cycles);
+    set_scl(on);
+    wait(high_cycles / 2);
+    set_sda(on);
+    wait(high_cycles - high_cycles / 2);
+}
+
+void i2c_software::write_bit(bool bit)
+{
+    if (error != I2C_SOFTWARE_OK)
+        return;
+
+    set_sda(bit);
+    wait(setup_cycles);
+    set_scl(on);
+    wait(high_cycles);
+
+    // A released SDA read low is another master sending a 0, it has the bus from here on
+    if (error == I2C_SOFTWARE_OK && bit && !get_sda())
+        error = I2C_SOFTWARE_ARBITRATION_LOST;
+    if (error != I2C_SOFTWARE_OK)
+        return;
+
+    set_scl(off);
+    wait(hold_cycles);
+}
+
+bool i2c_software::read_bit()
+{
+    if (error != I2C_SOFTWARE_OK)
+        return true;
+
+    wait(setup_cycles);
+    set_scl(on);
+    wait(high_cycles);
+    if (error != I2C_SOFTWARE_OK)
+        return true;
+
+    // Sampled at the end of the high phase, the slave changes SDA after the falling edge
+    bool bit = get_sda();
+    set_scl(off);
+    wait(hold_cycles);
+    return bit;
+}
+
+bool i2c_software::read_acknowledge()
+{
+    if (error != I2C_SOFTWARE_OK)
+        return false;
+
+    set_sda(on);
+    wait(setup_cycles);
+
+    set_scl(on);
+    wait(high_cycles);
+    if (error != I2C_SOFTWARE_OK)
+        return false;
+
+    // Low is an acknowledge
+    bool acknowledged =  !get_sda();
+    set_scl(off);
+    wait(hold_cycles);
+
+    return acknowledged;
+}
+
+bool i2c_software::start_communication_with(uint8_t address, bool read)
+{
+    start_condition();
+    for (uint i = 0; i < 7; i++)
+    {
+        // MSB first
+        write_bit(bool((address & (0x01 << (6-i))) >> (6-i)));
+    }
+
+    // Read / Write bit
+    write_bit(read);
+
+    // Acknowledge
+    return read_acknowledge();
+}
+
+uint8_t i2c_software::read_byte(bool acknowledge)
+{
+    set_sda(on);
+
+    uint8_t output = 0;
+
+    // Read byte
+    for (uint i = 0; i < 8; i++)
+    {
+        set_bit(7 - i, read_bit(), output);
+    }
+
+    // Acknowledge, or leave SDA released for a NACK
+    write_bit(!acknowledge);
+
+    return output;
+}
+
+bool i2c_software::write_byte(uint8_t byte)
+{
+    for (uint i = 0; i < 8; i++)
+    {
+        // MSB first
+        write_bit(bool((byte & (0x01 << (7-i))) >> (7-i)));
+    }
+    return read_acknowledge();
+}
+#endif
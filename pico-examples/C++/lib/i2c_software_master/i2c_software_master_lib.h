@@ -0,0 +1,119 @@
+#ifndef I2C_SOFTWARE_MASTER_H
+#define I2C_SOFTWARE_MASTER_H
+
+#include "io_hal.h"
+#include "i2c_segment.h"
+#include "i2c_scan.h"
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+#include "i2c_pio_master_lib.h"
+#endif
+
+/*
+    I2C master using bit banging, not using the hardware module
+
+    Each bit is timed in system clock cycles as a quarter period with SCL low before the rising
+    edge, half a period high and the remaining quarter low again, so the clock runs at the
+    requested frequency up to 1 MHz and beyond.
+
+    Both lines are open drain: the output level stays low and a line is pulled down by enabling
+    its output or let go by disabling it, one SIO register write with a mask worked out at
+    construction. A released SCL is read back and the master waits while a slave stretches it,
+    for up to I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US. A released SDA is read back at the end of
+    every bit the master sends, if it is low another master is driving the bus: this one lets go
+    of both lines, sends no STOP and the transfer fails with I2C_SOFTWARE_ARBITRATION_LOST.
+*/
+
+// Longest a slave may hold SCL low before the transfer is given up, as the SMBus timeout
+#ifndef I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US
+#define I2C_SOFTWARE_MASTER_STRETCH_TIMEOUT_US 25000
+#endif
+
+// Why a transfer gave up other than for a NACK
+enum i2c_software_error {
+    I2C_SOFTWARE_OK = 0,
+    I2C_SOFTWARE_STRETCH_TIMEOUT,
+    I2C_SOFTWARE_ARBITRATION_LOST,
+};
+
+void set_bit(const uint location, const bool value, uint8_t& byte);
+
+class i2c_software
+{
+    public:
+        int sda;
+        int scl;
+
+        // SIO masks of the pins
+        uint32_t sda_mask;
+        uint32_t scl_mask;
+
+        // Cycles of each phase of a bit, SCL low / high / low
+        uint32_t setup_cycles;
+        uint32_t high_cycles;
+        uint32_t hold_cycles;
+
+#ifdef I2C_SOFTWARE_MASTER_PIO
+        i2c_pio_master* pio_master;
+#endif
+
+        i2c_software(int sda_pin, int scl_pin, int frequency_hz);
+#ifdef I2C_SOFTWARE_MASTER_PIO
+        ~i2c_software();
+
+        // Owns the PIO master and with it a state machine and two DMA channels
+        i2c_software(const i2c_software&) = delete;
+        i2c_software& operator=(const i2c_software&) = delete;
+#endif
+
+        /// @brief one transaction ending in a STOP, the last byte read is not acknowledged
+        /// @return false if the device or a written byte was not acknowledged
+        bool write_bytes(uint8_t address, uint8_t* data, uint n_bytes);
+        bool read_bytes(uint8_t address, uint8_t* data, uint n_bytes);
+
+        /// @brief write tx then read rx in one transaction, joined by a repeated START
+        /// @return false if the device or a written byte was not acknowledged
+        bool write_read(uint8_t address, const uint8_t* tx, uint tx_len, uint8_t* rx, uint rx_len);
+
+        /// @brief run the segments as one transaction ending in a STOP, see i2c_segment.h
+        /// @return false if the device or a written byte was not acknowledged, or get_error() says why not
+        bool transfer(uint8_t address, const i2c_segment* segments, uint n_segments);
+
+        // What ended the last transfer early besides a NACK, the bit banged master only
+        i2c_software_error get_error() { return error; }
+
+        /// @brief probe every address that is not reserved with a single address byte and a STOP
+        i2c_scan_result scan();
+
+    private:
+        // Set by a bit that could not be finished, every later bit does nothing until the next transfer
+        i2c_software_error error = I2C_SOFTWARE_OK;
+
+        void wait(uint32_t cycles);
+
+        void set_sda(bool value);
+        bool get_sda();
+        void set_scl(bool value);
+
+        void start_condition();
+        void stop_condition();
+
+        // Let go of both lines after an error, in place of the STOP
+        void release_bus();
+
+        void write_bit(bool bit);
+        bool read_bit();
+        bool read_acknowledge();
+
+        // Start communications with a device, read set to true to read, false to write
+        bool start_communication_with(uint8_t address, bool read);
+
+        // Address a device for writing and stop straight away, true if it acknowledged
+        bool probe(uint8_t address);
+
+        // The last byte a master reads before a STOP or repeated START is not acknowledged
+        uint8_t read_byte(bool acknowledge);
+        bool write_byte(uint8_t byte);
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "i2c_software_queue.h"
+
+// The queue on each hardware alarm, a bare interrupt handler has nothing else to find it by
+static i2c_software_queue* i2c_software_queue_instances[HAL_TIMER_COUNT];
+
+template <uint TIMER>
+static void HAL_RAM_FUNC(i2c_software_queue_timer_handler)()
+{
+    hal_timer_acknowledge(TIMER);
+    i2c_software_queue_instances[TIMER]->tick();
+}
+
+static_assert(HAL_TIMER_COUNT == 4, "one handler per hardware alarm");
+static const irq_handler_t i2c_software_queue_timer_handlers[HAL_TIMER_COUNT] = {
+    &i2c_software_queue_timer_handler<0>,
+    &i2c_software_queue_timer_handler<1>,
+    &i2c_software_queue_timer_handler<2>,
+    &i2c_software_queue_timer_handler<3>,
+};
+
+i2c_software_queue::i2c_software_queue(int sda_pin, int scl_pin, int frequency_hz) : sda(sda_pin), scl(scl_pin)
+{
+    timer = hal_timer_claim_unused();
+    i2c_software_queue_instances[timer] = this;
+    hal_timer_set_handler(timer, i2c_software_queue_timer_handlers[timer]);
+
+    // The alarm can not fire more than once a microsecond
+    quarter_ns = MAX(1000000000ull / (4ull * frequency_hz), 1000ull);
+
+    // Outputs stay low, a line is pulled low by making it an output and released by making it an input
+    hal_gpio_init(sda);
+    hal_gpio_init(scl);
+    hal_gpio_put(sda, false);
+    hal_gpio_put(scl, false);
+    hal_gpio_set_dir(sda, GPIO_IN);
+    hal_gpio_set_dir(scl, GPIO_IN);
+}
+
+bool i2c_software_queue::submit(i2c_transaction* transaction)
+{
+    transaction->status = I2C_TRANSACTION_QUEUED;
+    transaction->transferred = 0;
+
+    // The alarm may be deciding to stop, whoever finds the queue idle starts it
+    uint32_t interrupts = hal_save_and_disable_interrupts();
+    bool queued = queue.push((const uint8_t*)&transaction, sizeof(transaction));
+    bool start = queued && !running;
+    if (start)
+    {
+        running = true;
+        next_transaction();
+    }
+    hal_restore_interrupts(interrupts);
+
+    if (start)
+    {
+        scheduled_ns = 0;
+        target_us = hal_timer_now_us() + 1;
+        hal_timer_set_target_us(timer, target_us);
+    }
+    return queued;
+}
+
+bool i2c_software_queue::next_transaction()
+{
+    uint32_t interrupts = hal_save_and_disable_interrupts();
+    bool found = queue.pop((uint8_t*)&current, sizeof(current)) == sizeof(current);
+    if (!found)
+        running = false;
+    hal_restore_interrupts(interrupts);
+
+    if (found)
+    {
+        current->status = I2C_TRANSACTION_ACTIVE;
+        outcome = I2C_TRANSACTION_DONE;
+        symbol = I2C_SOFTWARE_QUEUE_START;
+        quarter = 0;
+    }
+    return found;
+}
+
+bool i2c_software_queue::master_drives_bit() const
+{
+    // The receiver of a byte drives its acknowledge
+    if (byte_index < 0 || !current->read)
+        return bit_index < 8;
+    return bit_index == 8;
+}
+
+bool i2c_software_queue::bit_to_send() const
+{
+    if (bit_index < 8)
+        return (byte >> (7 - bit_index)) & 0x01;
+
+    // Reading, acknowledge every byte but the last
+    return byte_index + 1 >= (int)current->length;
+}
+
+void i2c_software_queue::load_byte()
+{
+    if (byte_index < 0)
+        byte = (current->address << 1) | current->read;
+    else
+        byte = current->read ? 0 : current->data[byte_index];
+    bit_index = 0;
+}
+
+void i2c_software_queue::end_bit()
+{
+    if (bit_index < 8)
+    {
+        if (byte_index >= 0 && current->read)
+            byte = (byte << 1) | sample;
+        bit_index++;
+        return;
+    }
+
+    // Low is an acknowledge
+    bool acknowledged = !sample;
+
+    if (byte_index < 0)
+    {
+        if (!acknowledged)
+        {
+            finish(I2C_TRANSACTION_ADDRESS_NACK);
+            return;
+        }
+    }
+    else if (current->read)
+    {
+        current->data[byte_index] = byte;
+        current->transferred = byte_index + 1;
+    }
+    else
+    {
+        if (!acknowledged)
+        {
+            finish(I2C_TRANSACTION_DATA_NACK);
+            return;
+        }
+        current->transferred = byte_index + 1;
+    }
+
+    if (++byte_index >= (int)current->length)
+    {
+        finish(I2C_TRANSACTION_DONE);
+        return;
+    }
+    load_byte();
+}
+
+void i2c_software_queue::finish(i2c_transaction_status status)
+{
+    outcome = status;
+    symbol = I2C_SOFTWARE_QUEUE_STOP;
+}
+
+void i2c_software_queue::tick()
+{
+    if (step())
+        schedule_next();
+}
+
+bool i2c_software_queue::step()
+{
+    // SCL was released a quarter ago, a slave stretching the clock still holds it low. The bit
+    // waits a quarter at a time until it lets go, so SDA is never sampled or changed early.
+    if (quarter == 2 && !hal_gpio_get(scl))
+        return true;
+
+    // Every bit period is four quarters: SDA set up while SCL is low, SCL high for two, SCL low
+    switch (symbol)
+    {
+    case I2C_SOFTWARE_QUEUE_START:
+        if (quarter == 0)
+            set_sda(true);
+        else if (quarter == 1)
+            set_scl(true);
+        else if (quarter == 2)
+            set_sda(false);
+        else
+            set_scl(false);
+        break;
+
+    case I2C_SOFTWARE_QUEUE_BIT:
+        if (quarter == 0)
+            set_sda(master_drives_bit() ? bit_to_send() : true);
+        else if (quarter == 1)
+            set_scl(true);
+        else if (quarter == 3)
+        {
+            // Sampled at the end of the high phase
+            sample = hal_gpio_get(sda);
+            set_scl(false);
+        }
+        break;
+
+    case I2C_SOFTWARE_QUEUE_STOP:
+        if (quarter == 0)
+            set_sda(false);
+        else if (quarter == 1)
+            set_scl(true);
+        else if (quarter == 2)
+            set_sda(true);
+        break;
+    }
+
+    if (++quarter == 4)
+    {
+        quarter = 0;
+
+        if (symbol == I2C_SOFTWARE_QUEUE_START)
+        {
+            symbol = I2C_SOFTWARE_QUEUE_BIT;
+            byte_index = -1;
+            load_byte();
+        }
+        else if (symbol == I2C_SOFTWARE_QUEUE_BIT)
+        {
+            end_bit();
+        }
+        else
+        {
+            i2c_transaction* finished = current;
+            finished->status = outcome;
+            if (finished->callback)
+                finished->callback(finished);
+
+            // The next START follows straight on, or the alarm stops
+            if (!next_transaction())
+                return false;
+        }
+    }
+    return true;
+}
+
+void i2c_software_queue::schedule_next()
+{
+    // Keep the fraction of a microsecond so the average bit rate is exact
+    uint64_t next_ns = scheduled_ns + quarter_ns;
+    target_us += next_ns / 1000 - scheduled_ns / 1000;
+    scheduled_ns = next_ns % 1000;
+    hal_timer_set_target_us(timer, target_us);
+}
@@ -0,0 +1,117 @@
+#ifndef I2C_SOFTWARE_QUEUE_H
+#define I2C_SOFTWARE_QUEUE_H
+
+#include "io_hal.h"
+#include "i2c_ring_buffer.h"
+
+/*
+    I2C master that runs queued transactions from a timer interrupt, the caller submits a
+    transaction and carries on, it is told how it went through the transaction's status and an
+    optional callback.
+
+    Each queue claims one of the hardware alarms and takes its interrupt directly, without the
+    sdk's alarm pool, on the core that created it. The alarm fires every quarter bit and moves
+    the bus on by one step, one transaction follows the STOP of the one before without a gap.
+    Lines are driven open drain: low, or released to the pull up. A slave may stretch the clock,
+    the high phase of a bit only starts once SCL has been seen high. The alarm works in whole
+    microseconds and still costs an interrupt per quarter bit, so this engine is meant for
+    standard mode buses of 100 kHz and below, i2c_pio_master takes faster ones off the CPU.
+*/
+
+// Transactions that can wait behind the one on the bus, a power of two
+#define I2C_SOFTWARE_QUEUE_SIZE 16
+
+enum i2c_transaction_status {
+    I2C_TRANSACTION_QUEUED = 0,
+    I2C_TRANSACTION_ACTIVE,
+    I2C_TRANSACTION_DONE,
+    I2C_TRANSACTION_ADDRESS_NACK,
+    I2C_TRANSACTION_DATA_NACK,
+};
+
+struct i2c_transaction;
+
+/// @brief a function type called from the timer interrupt once a transaction has finished
+typedef void (*i2c_transaction_callback)(i2c_transaction* transaction);
+
+struct i2c_transaction {
+    uint8_t address;
+    bool read;
+    uint8_t* data;
+    uint length;
+    i2c_transaction_callback callback = nullptr;
+    void* user_data = nullptr;
+
+    // Written by the queue, final once status is past I2C_TRANSACTION_ACTIVE
+    volatile i2c_transaction_status status = I2C_TRANSACTION_QUEUED;
+    volatile uint transferred = 0;
+};
+
+// What the bus is doing during the current bit period
+enum i2c_software_queue_symbol {
+    I2C_SOFTWARE_QUEUE_START = 0,
+    I2C_SOFTWARE_QUEUE_BIT,
+    I2C_SOFTWARE_QUEUE_STOP,
+};
+
+class i2c_software_queue
+{
+    public:
+        int sda;
+        int scl;
+
+        i2c_software_queue(int sda_pin, int scl_pin, int frequency_hz);
+
+        /// @brief queue a transaction, it must stay valid until it has finished
+        /// @return false if the queue is full
+        bool submit(i2c_transaction* transaction);
+
+        // Nothing on the bus and nothing queued
+        bool idle() const { return !running; }
+
+        // Run by the alarm, moves the bus on by a quarter bit and sets the alarm for the next one
+        void tick();
+
+    private:
+        // Hardware alarm claimed by this queue
+        uint timer;
+        uint32_t target_us = 0;
+
+        i2c_ring_buffer<I2C_SOFTWARE_QUEUE_SIZE * sizeof(i2c_transaction*)> queue;
+
+        // Written with interrupts disabled by submit, or by the alarm
+        volatile bool running = false;
+
+        // Length of a quarter bit and how far the alarm has got into the current one
+        uint64_t quarter_ns;
+        uint64_t scheduled_ns = 0;
+
+        i2c_transaction* current = nullptr;
+        i2c_software_queue_symbol symbol = I2C_SOFTWARE_QUEUE_START;
+        uint quarter = 0;
+
+        int byte_index = -1;        // -1 while sending the address
+        uint bit_index = 0;         // 8 is the acknowledge
+        uint8_t byte = 0;
+        bool sample = false;
+
+        // Status the current transaction gets at its STOP
+        i2c_transaction_status outcome = I2C_TRANSACTION_DONE;
+
+        void set_sda(bool high) { hal_gpio_set_dir(sda, !high); }
+        void set_scl(bool high) { hal_gpio_set_dir(scl, !high); }
+
+        bool master_drives_bit() const;
+        bool bit_to_send() const;
+
+        // One quarter bit, false once the queue has run dry
+        bool step();
+        void schedule_next();
+
+        bool next_transaction();
+        void load_byte();
+        void end_bit();
+        void finish(i2c_transaction_status status);
+};
+
+#endif
@@ -0,0 +1,553 @@
+#include "i2c_software_slave_lib.h"
+#include "i2c_software_slave_stats.h"
+
+i2c_software_slave* i2c_software_slave_instances[MAX_NUMBER_OF_SLAVES];
+uint number_of_i2c_software_slave_instances = 0;
+
+i2c_software_slave_pin_dispatch i2c_software_slave_pin_table[NUM_BANK0_GPIOS];
+
+#if I2C_SOFTWARE_SLAVE_TIMEOUT_US > 0
+// The timeout alarms of every slave, on the core taking the edges so a recovery never runs beside an edge
+static hal_alarm_pool_t timeout_alarm_pool = nullptr;
+#endif
+
+static void i2c_software_slave_start(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                                     i2c_register_bank* bank, i2c_slave_event_queue* queue);
+
+
+void i2c_software_slave_init(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler)
+{
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    // The PIO engine decodes the bus itself and only interrupts once per byte
+    i2c_pio_slave_init(pio0, sda_pin, scl_pin, slave_address, event_handler);
+    return;
+#endif
+
+    i2c_software_slave_start(sda_pin, scl_pin, slave_address, event_handler, nullptr, nullptr);
+}
+
+void i2c_software_slave_init_register_bank(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_register_bank* bank)
+{
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    i2c_pio_slave_init_register_bank(pio0, sda_pin, scl_pin, slave_address, bank);
+    return;
+#endif
+
+    i2c_software_slave_start(sda_pin, scl_pin, slave_address, nullptr, bank, nullptr);
+}
+
+void i2c_software_slave_init_deferred(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_slave_event_queue* queue)
+{
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+    i2c_pio_slave_init_deferred(pio0, sda_pin, scl_pin, slave_address, queue);
+    return;
+#endif
+
+    i2c_software_slave_start(sda_pin, scl_pin, slave_address, nullptr, nullptr, queue);
+}
+
+static void i2c_software_slave_start(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                                     i2c_register_bank* bank, i2c_slave_event_queue* queue)
+{
+    // Another address on pins that already have a slave is decoded by that slave
+    i2c_software_slave* existing = i2c_software_slave_pin_table[sda_pin].instance;
+    if (existing != nullptr)
+    {
+        assert(existing->get_scl_pin() == scl_pin);
+        bool added = existing->add_address(slave_address, event_handler, bank, queue);
+        assert(added);
+        (void)added;
+        return;
+    }
+
+    // You cannot have more than 16 i2c slave instances, limited by number of pins
+    assert(number_of_i2c_software_slave_instances < MAX_NUMBER_OF_SLAVES);
+
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    // SysTick is per core, start it on this one as it is the one taking the slave's interrupts
+    hal_cycle_counter_init();
+#endif
+
+#if I2C_SOFTWARE_SLAVE_TIMEOUT_US > 0
+    if (timeout_alarm_pool == nullptr)
+        timeout_alarm_pool = hal_alarm_pool_create(MAX_NUMBER_OF_SLAVES);
+#endif
+
+    // init i2c pins 
+    hal_gpio_init(sda_pin);
+    hal_gpio_init(scl_pin);
+
+    // Open drain, the output level stays low and SDA is pulled down by enabling the output
+    hal_gpio_clr_mask(1u << sda_pin);
+    hal_gpio_set_dir(sda_pin, GPIO_IN);
+    hal_gpio_set_dir(scl_pin, GPIO_IN);
+
+    hal_gpio_set_slew_rate(sda_pin, GPIO_SLEW_RATE_FAST);
+    hal_gpio_set_slew_rate(scl_pin, GPIO_SLEW_RATE_FAST);
+
+    // Each pin can only belong to one slave
+    assert(i2c_software_slave_pin_table[sda_pin].instance == nullptr);
+    assert(i2c_software_slave_pin_table[scl_pin].instance == nullptr);
+
+    // create new i2c_slave_instance
+    i2c_software_slave* slave = new i2c_software_slave(sda_pin, scl_pin, slave_address, event_handler, bank, queue);
+    i2c_software_slave_instances[number_of_i2c_software_slave_instances] = slave;
+    number_of_i2c_software_slave_instances++;
+
+    i2c_software_slave_pin_table[sda_pin] = {slave, &i2c_software_slave::sda_trigger_handler};
+    i2c_software_slave_pin_table[scl_pin] = {slave, &i2c_software_slave::scl_trigger_handler};
+
+    // attach triggers to pins
+#ifdef I2C_RAW_IRQ
+    // The sdk takes one mask per handler, so swap the handler's mask for one with the new pins added
+    static uint32_t raw_irq_pins = 0;
+    if (raw_irq_pins)
+        hal_gpio_remove_raw_irq_handler_masked(raw_irq_pins, &i2c_software_slave_raw_irq_handler);
+    raw_irq_pins |= (1u << sda_pin) | (1u << scl_pin);
+    hal_gpio_add_raw_irq_handler_masked(raw_irq_pins, &i2c_software_slave_raw_irq_handler);
+#else
+    hal_gpio_set_irq_callback(&i2c_software_slave_trigger_handler);
+#endif
+    
+    hal_gpio_set_irq_enabled(sda_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    hal_gpio_irq_bank_enable();
+    hal_gpio_set_irq_enabled(scl_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    hal_gpio_irq_bank_enable();
+
+}
+
+// Nothing recorded, min_cycles starts high so the first entry replaces it
+static i2c_software_slave_stats no_stats()
+{
+    i2c_software_slave_stats empty = {};
+    empty.min_cycles = UINT32_MAX;
+    return empty;
+}
+
+static i2c_software_slave_stats stats = no_stats();
+
+// The handlers are in RAM and so is everything they call, in case it is not inlined
+
+// Both edges latched on a pin before the handler got to it
+static inline bool HAL_RAM_FUNC(missed_edge)(uint32_t events)
+{
+    return (events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL)) == (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+}
+
+static inline void HAL_RAM_FUNC(record_entry)(uint32_t start)
+{
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    uint32_t cycles = (hal_cycle_count() - start) & HAL_CYCLE_COUNT_MASK;
+
+    stats.calls++;
+    stats.total_cycles += cycles;
+    stats.min_cycles = MIN(stats.min_cycles, cycles);
+    stats.max_cycles = MAX(stats.max_cycles, cycles);
+
+    uint bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+    stats.histogram[MIN(bucket, I2C_SOFTWARE_SLAVE_STATS_BUCKETS - 1)]++;
+#else
+    (void)start;
+#endif
+}
+
+static inline void HAL_RAM_FUNC(record_missed)(uint32_t events)
+{
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    if (missed_edge(events))
+        stats.missed_edges++;
+#else
+    (void)events;
+#endif
+}
+
+void HAL_RAM_FUNC(i2c_software_slave_trigger_handler)(uint gpio, uint32_t event)
+{
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    uint32_t start = hal_cycle_count();
+    record_missed(event);
+#endif
+
+    // look up the instance owning the pin instead of searching every instance
+    const i2c_software_slave_pin_dispatch& dispatch = i2c_software_slave_pin_table[gpio];
+    if (dispatch.instance != nullptr)
+        (dispatch.instance->*dispatch.handler)(gpio, event);
+
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    record_entry(start);
+#endif
+}
+
+void HAL_RAM_FUNC(i2c_software_slave_raw_irq_handler)()
+{
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    uint32_t start = hal_cycle_count();
+#endif
+
+    // One read of every pin for all of the edges handled in this entry
+    uint32_t levels = hal_gpio_get_all();
+
+    for (uint i = 0; i < number_of_i2c_software_slave_instances; i++)
+        i2c_software_slave_instances[i]->raw_trigger_handler(levels);
+
+#ifdef I2C_SOFTWARE_SLAVE_STATS
+    record_entry(start);
+#endif
+}
+
+i2c_software_slave_stats i2c_software_slave_get_stats()
+{
+    uint32_t status = hal_save_and_disable_interrupts();
+    i2c_software_slave_stats copy = stats;
+    hal_restore_interrupts(status);
+    return copy;
+}
+
+void i2c_software_slave_reset_stats()
+{
+    uint32_t status = hal_save_and_disable_interrupts();
+    stats = no_stats();
+    hal_restore_interrupts(status);
+}
+
+void i2c_software_slave_print_stats(uint bus_hz)
+{
+    i2c_software_slave_stats copy = i2c_software_slave_get_stats();
+    if (copy.calls == 0)
+    {
+        printf("i2c slave: no interrupts recorded, build with I2C_SOFTWARE_SLAVE_STATS\n");
+        return;
+    }
+
+    // SCL changes every half bit, the handler has to be back before the next edge
+    uint32_t budget = hal_clock_sys_hz() / (2 * bus_hz);
+
+    printf("i2c slave: %lu entries, %lu / %lu / %lu cycles min / avg / max, %lu missed edges\n",
+           (unsigned long)copy.calls, (unsigned long)copy.min_cycles,
+           (unsigned long)(copy.total_cycles / copy.calls), (unsigned long)copy.max_cycles,
+           (unsigned long)copy.missed_edges);
+    printf("i2c slave: %lu cycles between edges at %u Hz, worst case uses %lu%%\n",
+           (unsigned long)budget, bus_hz, (unsigned long)((uint64_t)copy.max_cycles * 100 / budget));
+
+    for (uint i = 0; i < I2C_SOFTWARE_SLAVE_STATS_BUCKETS; i++)
+    {
+        if (copy.histogram[i])
+            printf("  %6lu+ cycles %10lu\n", (unsigned long)(1ul << i), (unsigned long)copy.histogram[i]);
+    }
+}
+
+#if I2C_SOFTWARE_SLAVE_TIMEOUT_US > 0
+static int64_t HAL_RAM_FUNC(i2c_software_slave_timeout_alarm)(alarm_id_t id, void* user_data)
+{
+    (void)id;
+    return ((i2c_software_slave*)user_data)->check_timeout();
+}
+#endif
+
+inline void HAL_RAM_FUNC(i2c_software_slave::arm_timeout)()
+{
+#if I2C_SOFTWARE_SLAVE_TIMEOUT_US > 0
+    if (timeout_armed)
+        return;
+
+    timeout_armed = true;
+    edges_at_check = edges_seen;
+
+    // Out of alarm slots, the next START tries again
+    if (hal_alarm_pool_add_alarm_in_us(timeout_alarm_pool, I2C_SOFTWARE_SLAVE_TIMEOUT_US, &i2c_software_slave_timeout_alarm, this) <= 0)
+        timeout_armed = false;
+#endif
+}
+
+int64_t HAL_RAM_FUNC(i2c_software_slave::check_timeout)()
+{
+    // Whatever the alarm's priority against the GPIO interrupt, no edge runs in the middle of this
+    uint32_t status = hal_save_and_disable_interrupts();
+
+    int64_t next_check_us = 0;
+    if (i2c_state == I2C_STATE_NULL)
+    {
+        timeout_armed = false;
+    }
+    else if (edges_seen != edges_at_check)
+    {
+        // Still moving, look again after another period
+        edges_at_check = edges_seen;
+        next_check_us = I2C_SOFTWARE_SLAVE_TIMEOUT_US;
+    }
+    else
+    {
+        // The master has gone, let go of SDA so the bus is free and end the transfer for the application
+        release_sda();
+        i2c_state = I2C_STATE_NULL;
+        reset_values();
+        recoveries++;
+        notify_all(I2C_SLAVE_STOP);
+        timeout_armed = false;
+    }
+
+    hal_restore_interrupts(status);
+    return next_check_us;
+}
+
+uint i2c_software_slave_get_recoveries()
+{
+    uint total = 0;
+    for (uint i = 0; i < number_of_i2c_software_slave_instances; i++)
+        total += i2c_software_slave_instances[i]->get_recoveries();
+    return total;
+}
+
+bool i2c_software_slave::add_address(uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                                     i2c_register_bank* register_bank, i2c_slave_event_queue* event_queue)
+{
+    if (slave_address > 0x7f || address_table[slave_address] != 0 || number_of_targets == MAX_NUMBER_OF_SLAVE_ADDRESSES)
+        return false;
+
+    // The table entry last, the interrupt may already be running
+    targets[number_of_targets] = {slave_address, event_handler, register_bank, event_queue};
+    number_of_targets++;
+    address_table[slave_address] = number_of_targets;
+    return true;
+}
+
+inline void HAL_RAM_FUNC(i2c_software_slave::notify)(i2c_software_slave_target* target, uint byte_number, i2c_software_slave_event event)
+{
+    if (target->queue != nullptr)
+    {
+        target->queue->post(i2c_fifo.data, byte_number, event);
+        return;
+    }
+
+    i2c_register_bank* bank = target->bank;
+    if (bank == nullptr)
+    {
+        target->event_handler(i2c_fifo.data, byte_number, event);
+        return;
+    }
+
+    switch (event)
+    {
+    case I2C_SLAVE_RECEIVE:
+        bank->receive(i2c_fifo.data, byte_number);
+        break;
+
+    case I2C_SLAVE_REQUEST:
+        i2c_fifo.data = bank->request();
+        break;
+
+    case I2C_SLAVE_STOP:
+        bank->stop();
+        break;
+
+    default:
+        break;
+    }
+}
+
+inline void HAL_RAM_FUNC(i2c_software_slave::notify_all)(i2c_software_slave_event event)
+{
+    // Once per transfer, not per bit, so the cost of more addresses stays off the data bits
+    for (uint i = 0; i < number_of_targets; i++)
+        notify(&targets[i], 0, event);
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::reset_values)()
+{
+    i2c_fifo.reset_fifo();
+    i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+    i2c_bit_counter = 0;
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::raw_trigger_handler)(uint32_t levels)
+{
+    uint32_t sda_events = hal_gpio_get_irq_events(sda) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+    uint32_t scl_events = hal_gpio_get_irq_events(scl) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+    if (!(sda_events | scl_events))
+        return;
+
+    record_missed(sda_events);
+    record_missed(scl_events);
+
+    hal_gpio_acknowledge_irq(sda, sda_events);
+    hal_gpio_acknowledge_irq(scl, scl_events);
+
+    i2c_bus_edge edges[I2C_BUS_EDGES_MAX];
+    uint count = i2c_order_edges(sda_events, scl_events, (levels >> sda) & 1, (levels >> scl) & 1, edges);
+
+    for (uint i = 0; i < count; i++)
+    {
+        if (edges[i].scl)
+            scl_edge(edges[i].event, edges[i].sda_level);
+        else
+            sda_edge(edges[i].event, edges[i].scl_level);
+    }
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::sda_trigger_handler)(uint gpio, uint32_t event)
+{
+    (void)gpio;
+    sda_edge(event, hal_gpio_get(scl));
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::scl_trigger_handler)(uint gpio, uint32_t event)
+{
+    (void)gpio;
+    scl_edge(event, hal_gpio_get(sda));
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::sda_edge)(uint32_t event, bool clock_level)
+{
+    edges_seen++;
+
+    // Start condition is a falling edge while scl is high
+    if (event == GPIO_IRQ_EDGE_FALL && clock_level)
+    {
+        i2c_state = I2C_STATE_START;
+        reset_values();
+        arm_timeout();
+        notify_all(I2C_SLAVE_START);
+    }
+    
+    // Stop condition is a rising edge while scl is high
+    else if (event == GPIO_IRQ_EDGE_RISE && clock_level)
+    {
+        i2c_state = I2C_STATE_NULL;
+        reset_values();
+        notify_all(I2C_SLAVE_STOP);
+    }
+}
+
+void HAL_RAM_FUNC(i2c_software_slave::scl_edge)(uint32_t event, bool data_level)
+{
+    edges_seen++;
+
+    // Whenever we a reading a pin it must be when scl is high
+    if (event == GPIO_IRQ_EDGE_RISE)
+    {
+        switch(i2c_state)
+        {   
+        
+        case I2C_STATE_START:
+            
+            // Read Bit
+            i2c_fifo.shift_in(data_level);
+            i2c_bit_counter++;
+
+            // Only the whole address byte is compared, the first bits of another address could match
+            if (i2c_bit_counter < 8)
+            {
+                break;
+            }
+            
+            // One lookup whichever of the addresses it is, the low bit is read or write
+            if (address_table[i2c_fifo.data >> 1] != 0)
+            {
+                active = &targets[address_table[i2c_fifo.data >> 1] - 1];
+                i2c_state = (i2c_fifo.data & 1) ? I2C_STATE_TRANSMIT : I2C_STATE_RECEIVE;
+                i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_TRANSMIT;
+                i2c_bit_counter = 0;
+                i2c_fifo.reset_fifo();
+            }
+            // Nobody here has this address, wait for the next START
+            else
+            {
+                i2c_state = I2C_STATE_NULL;
+            }
+            break;
+        
+
+        case I2C_STATE_TRANSMIT:
+            if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_RECEIVE)
+            {
+                release_sda();
+                bool acknowledged = !data_level;
+                i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+                // Not acknowledged is the master's last byte, leave SDA alone until its STOP or repeated START
+                if (!acknowledged)
+                {
+                    i2c_state = I2C_STATE_NULL;
+                }
+            }
+            break;
+        
+        case I2C_STATE_RECEIVE:
+            if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+            {
+                i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL; // reset acknowledge after its been read
+            }
+            else if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_NULL)
+            {
+                // Read data into fifo
+                i2c_fifo.shift_in(data_level);
+                i2c_bit_counter++;
+                if (i2c_bit_counter % 8 == 0)
+                {
+                    notify(active, i2c_bit_counter / 8, I2C_SLAVE_RECEIVE);
+                    i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_TRANSMIT;
+                }
+            }
+
+        default:
+            break;
+        }
+    }
+
+    // SCL must be low to change SDA
+    else if (event == GPIO_IRQ_EDGE_FALL)
+    {
+        switch (i2c_state)
+        {
+        case I2C_STATE_TRANSMIT:
+
+            if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+            {
+                pull_sda();
+                i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+            }
+            
+            // State condition to transmit data from buffer
+            else if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_NULL)
+            {
+                // Every byte get the next one
+                if (i2c_bit_counter % 9 == 0)
+                {
+                    notify(active, i2c_bit_counter / 9, I2C_SLAVE_REQUEST);
+                }
+                // The ninth clock is the master's acknowledge, let go of SDA for it, and a 1 is let go too
+                if (i2c_bit_counter % 9 == 8 || i2c_fifo.shift_in(0))
+                {
+                    release_sda();
+                }
+                else
+                {
+                    pull_sda();
+                }
+                i2c_bit_counter++;
+
+                if (i2c_bit_counter % 9 == 0)
+                {
+                    i2c_acknowledge_state = I2C_ACKNOWLEDGE_STATE_RECEIVE;
+                }
+            }
+            
+            break;
+        
+        case I2C_STATE_RECEIVE:
+            if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+            {
+                pull_sda();
+            }
+            else if (i2c_acknowledge_state == I2C_ACKNOWLEDGE_STATE_NULL)
+            {
+                release_sda();
+            }
+            break;
+
+
+        default:
+            break;
+        } // END switch i2c_state
+    } // END if event
+} // END scl trigger handling
+
@@ -0,0 +1,189 @@
+#ifndef I2C_SOFTWARE_SLAVE_H
+#define I2C_SOFTWARE_SLAVE_H
+
+#include "io_hal.h"
+#include "i2c_fifo.h"
+#include "i2c_slave_event.h"
+#include "i2c_register_bank.h"
+#include "i2c_slave_event_queue.h"
+#include "i2c_bus_edges.h"
+
+#ifdef I2C_SOFTWARE_SLAVE_PIO
+#include "i2c_pio_slave_lib.h"
+#endif
+
+#define MAX_NUMBER_OF_SLAVES 16
+
+// Addresses one slave can answer to on its pair of pins
+#define MAX_NUMBER_OF_SLAVE_ADDRESSES 32
+
+// A transfer with no edge on either line for this long is abandoned, SDA is let go and the slave
+// waits for the next START, as the SMBus timeout. It is noticed 1 to 2 times this late. Off unless
+// set, with -DI2C_SOFTWARE_SLAVE_TIMEOUT_US=25000, as a bus clocked by hand stands still for longer.
+#ifndef I2C_SOFTWARE_SLAVE_TIMEOUT_US
+#define I2C_SOFTWARE_SLAVE_TIMEOUT_US 0
+#endif
+
+// State machine for i2c
+enum i2c_state_t {
+    I2C_STATE_START = 1,
+    I2C_STATE_TRANSMIT,
+    I2C_STATE_RECEIVE,
+    I2C_STATE_NULL,
+};
+
+// State machine for acknowledgement 
+enum i2c_acknowledge_state_t {
+    I2C_ACKNOWLEDGE_STATE_TRANSMIT = 1,
+    I2C_ACKNOWLEDGE_STATE_RECEIVE,
+    I2C_ACKNOWLEDGE_STATE_NULL,
+};
+
+// One address a slave answers to and where the events of its transfers go
+struct i2c_software_slave_target {
+    uint8_t address;
+    i2c_software_slave_event_handler event_handler;
+
+    // Served straight from the interrupt instead of calling the event handler, when set
+    i2c_register_bank* bank;
+
+    // Events posted for the main loop instead of calling the event handler, when set
+    i2c_slave_event_queue* queue;
+};
+
+// Decodes one SDA / SCL pair, answering to every address in its table with one pass over each edge
+class i2c_software_slave
+{
+    public:
+        i2c_software_slave(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                           i2c_register_bank* register_bank = nullptr, i2c_slave_event_queue* event_queue = nullptr)
+        {
+            sda = sda_pin;
+            scl = scl_pin;
+            sda_mask = 1u << sda_pin;
+
+            for (uint8_t& index : address_table)
+                index = 0;
+            number_of_targets = 0;
+            active = nullptr;
+            add_address(slave_address, event_handler, register_bank, event_queue);
+
+            edges_seen = 0;
+            edges_at_check = 0;
+            timeout_armed = false;
+            recoveries = 0;
+
+            i2c_state = I2C_STATE_NULL;
+            reset_values();
+        }
+
+        /// @brief answer to another address on the same pins, its transfers go to its own handler, bank or queue
+        /// @return false if the address is already taken or the table is full
+        bool add_address(uint8_t slave_address, i2c_software_slave_event_handler event_handler,
+                         i2c_register_bank* register_bank = nullptr, i2c_slave_event_queue* event_queue = nullptr);
+
+        void sda_trigger_handler(uint gpio, uint32_t event);
+        void scl_trigger_handler(uint gpio, uint32_t event);
+
+        // Handle every edge latched on both pins, levels is a snapshot of all pins from hal_gpio_get_all
+        void raw_trigger_handler(uint32_t levels);
+
+        void reset_values();
+
+        // Called by the timeout alarm, abandons a transfer that has stopped moving
+        // @return when to look again as for an alarm callback, 0 once the slave is idle
+        int64_t check_timeout();
+
+        // Transfers abandoned by the timeout
+        uint get_recoveries() { return recoveries; }
+
+        uint get_sda_pin() { return sda; }
+        uint get_scl_pin() { return scl; }
+
+        uint8_t get_i2c_fifo() { return i2c_fifo.data; }
+    
+    private:
+        uint sda;
+        uint scl;
+        uint32_t sda_mask;
+
+        i2c_software_slave_target targets[MAX_NUMBER_OF_SLAVE_ADDRESSES];
+        uint number_of_targets;
+
+        // Index + 1 into targets for each 7 bit address, 0 where nobody answers
+        uint8_t address_table[128];
+
+        // Target addressed by the current transfer, null until an address matches
+        i2c_software_slave_target* active;
+
+        // i2c input fifo
+        fifo_8bit i2c_fifo;
+
+        // i2c state machine
+        volatile  i2c_state_t i2c_state;
+
+        // acknowledgement state machine
+        volatile i2c_acknowledge_state_t i2c_acknowledge_state;
+
+        // count the number of bits read / written
+        volatile uint i2c_bit_counter;
+
+        // Edges seen on either line, the timeout looks for it standing still
+        volatile uint32_t edges_seen;
+        uint32_t edges_at_check;
+        volatile bool timeout_armed;
+        volatile uint recoveries;
+
+        // SDA is open drain, let go of it or pull it low
+        inline void release_sda() { hal_gpio_set_dir_in_masked(sda_mask); }
+        inline void pull_sda()    { hal_gpio_set_dir_out_masked(sda_mask); }
+
+        // Start watching the transfer that has just begun, if nothing is watching yet
+        inline void arm_timeout();
+
+        // Hand an event to a target's register bank, event queue or event handler
+        inline void notify(i2c_software_slave_target* target, uint byte_number, i2c_software_slave_event event);
+
+        // START and STOP are seen by every address
+        inline void notify_all(i2c_software_slave_event event);
+
+        // One edge with the level the other line had at the time
+        void sda_edge(uint32_t event, bool clock_level);
+        void scl_edge(uint32_t event, bool data_level);
+};
+
+// Every slave started, defined in i2c_software_slave_lib.cpp
+extern i2c_software_slave* i2c_software_slave_instances[MAX_NUMBER_OF_SLAVES];
+extern uint number_of_i2c_software_slave_instances;
+
+// The slave a pin belongs to and which of its handlers an edge on that pin runs
+struct i2c_software_slave_pin_dispatch {
+    i2c_software_slave* instance;
+    void (i2c_software_slave::*handler)(uint gpio, uint32_t event);
+};
+
+// Filled by i2c_software_slave_init so an edge is dispatched with one lookup, unused pins have no instance
+extern i2c_software_slave_pin_dispatch i2c_software_slave_pin_table[NUM_BANK0_GPIOS];
+
+/// @brief start a slave, or add the address to the slave already on these pins
+void i2c_software_slave_init(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_software_slave_event_handler event_handler);
+
+/// @brief start a slave in register bank mode, see i2c_register_bank.h
+/// @param bank must stay valid for as long as the slave runs
+void i2c_software_slave_init_register_bank(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_register_bank* bank);
+
+/// @brief start a slave whose events are run from the main loop, see i2c_slave_event_queue.h
+/// @param queue must stay valid for as long as the slave runs
+void i2c_software_slave_init_deferred(uint sda_pin, uint scl_pin, uint8_t slave_address, i2c_slave_event_queue* queue);
+
+/// @brief transfers abandoned by the timeout on every slave, see I2C_SOFTWARE_SLAVE_TIMEOUT_US
+uint i2c_software_slave_get_recoveries();
+
+// Trigger handler
+void i2c_software_slave_trigger_handler(uint gpio, uint32_t event);
+
+// Raw bank interrupt handler used instead of the trigger handler when I2C_RAW_IRQ is defined,
+// it services both pins of every slave in one entry
+void i2c_software_slave_raw_irq_handler();
+
+#endif
\ No newline at end of file
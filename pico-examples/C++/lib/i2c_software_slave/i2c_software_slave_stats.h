@@ -0,0 +1,38 @@
+#ifndef I2C_SOFTWARE_SLAVE_STATS_H
+#define I2C_SOFTWARE_SLAVE_STATS_H
+
+#include "io_hal.h"
+
+/*
+    How long the software slave's interrupt takes per entry, for finding out how much headroom a bus
+    speed leaves. Recorded only when the library is built with I2C_SOFTWARE_SLAVE_STATS
+    (-DI2C_SOFTWARE_SLAVE_STATS=ON), otherwise everything stays at zero and the handlers pay nothing.
+
+    Cycles are counted with hal_cycle_count, on the pico that is clk_sys from the entry of the
+    handler to its return, not counting the time the core takes to get into the handler. SysTick
+    is per core, the slave's init starts it on the core it is called from, which takes the edges.
+
+    A missed edge is a pin found to have both risen and fallen by the time the handler got to it,
+    the handler was late by at least one edge and the bus state may be wrong from there on.
+*/
+
+// Bucket i counts entries that took [2^i, 2^(i+1)) cycles, the last one everything longer
+#define I2C_SOFTWARE_SLAVE_STATS_BUCKETS 16
+
+struct i2c_software_slave_stats {
+    uint32_t calls;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t missed_edges;
+    uint32_t histogram[I2C_SOFTWARE_SLAVE_STATS_BUCKETS];
+};
+
+/// @brief a copy of the counts so far, taken with interrupts off
+i2c_software_slave_stats i2c_software_slave_get_stats();
+void i2c_software_slave_reset_stats();
+
+/// @brief print the counts to stdio with the time between SCL edges at bus_hz to compare them with
+void i2c_software_slave_print_stats(uint bus_hz);
+
+#endif
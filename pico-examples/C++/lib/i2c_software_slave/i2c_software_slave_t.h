@@ -0,0 +1,228 @@
+#ifndef I2C_SOFTWARE_SLAVE_T_H
+#define I2C_SOFTWARE_SLAVE_T_H
+
+#include "i2c_software_slave_lib.h"
+
+/*
+    Compile time variant of i2c_software_slave for a slave whose pins, address and handler are
+    known when the firmware is built.
+
+    Everything is a template parameter and all state is static, so there is no instance to
+    allocate or look up: the pin masks and address conditions are constants, the handler is a
+    direct call the compiler can inline, and the bank interrupt goes straight to a raw handler
+    of its own that is placed in RAM. Both lines are driven open drain, a 0 is the output
+    enabled with the level held low.
+
+    The bus behaviour is that of i2c_software_slave with its event handler. Declare one per
+    slave and call init once:
+
+        i2c_software_slave_t<4, 5, 0x42, &event_handler>::init();
+*/
+
+template <uint SDA, uint SCL, uint8_t ADDRESS, i2c_software_slave_event_handler HANDLER>
+class i2c_software_slave_t
+{
+    static_assert(SDA < NUM_BANK0_GPIOS && SCL < NUM_BANK0_GPIOS && SDA != SCL, "SDA and SCL must be two bank 0 pins");
+    static_assert(ADDRESS < 0x80, "a 7 bit address");
+
+    public:
+        static constexpr uint32_t SDA_MASK = 1u << SDA;
+        static constexpr uint32_t SCL_MASK = 1u << SCL;
+
+        // Address + Read or write bit
+        static constexpr uint8_t RECEIVE_CONDITION = ADDRESS << 1;
+        static constexpr uint8_t TRANSMIT_CONDITION = (ADDRESS << 1) | 1;
+
+        static void init()
+        {
+            hal_gpio_init(SDA);
+            hal_gpio_init(SCL);
+
+            hal_gpio_clr_mask(SDA_MASK | SCL_MASK);
+            hal_gpio_set_dir_in_masked(SDA_MASK | SCL_MASK);
+
+            hal_gpio_set_slew_rate(SDA, GPIO_SLEW_RATE_FAST);
+            hal_gpio_set_slew_rate(SCL, GPIO_SLEW_RATE_FAST);
+
+            hal_gpio_add_raw_irq_handler_masked(SDA_MASK | SCL_MASK, &irq_handler);
+            hal_gpio_set_irq_enabled(SDA, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+            hal_gpio_set_irq_enabled(SCL, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+            hal_gpio_irq_bank_enable();
+        }
+
+        // Raw bank interrupt handler, services every edge latched on the two pins
+        static void HAL_RAM_FUNC(irq_handler)()
+        {
+            uint32_t levels = hal_gpio_get_all();
+
+            uint32_t sda_events = hal_gpio_get_irq_events(SDA) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+            uint32_t scl_events = hal_gpio_get_irq_events(SCL) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+            if (!(sda_events | scl_events))
+                return;
+
+            hal_gpio_acknowledge_irq(SDA, sda_events);
+            hal_gpio_acknowledge_irq(SCL, scl_events);
+
+            i2c_bus_edge edges[I2C_BUS_EDGES_MAX];
+            uint count = i2c_order_edges(sda_events, scl_events, levels & SDA_MASK, levels & SCL_MASK, edges);
+
+            for (uint i = 0; i < count; i++)
+            {
+                if (edges[i].scl)
+                    scl_edge(edges[i].event, edges[i].sda_level);
+                else
+                    sda_edge(edges[i].event, edges[i].scl_level);
+            }
+        }
+
+        // One edge with the level the other line had at the time
+        static inline void sda_edge(uint32_t event, bool clock_level)
+        {
+            if (!clock_level)
+                return;
+
+            // Start condition is a falling edge while scl is high, stop a rising one
+            if (event == GPIO_IRQ_EDGE_FALL)
+            {
+                state = I2C_STATE_START;
+                reset_values();
+                HANDLER(fifo.data, 0, I2C_SLAVE_START);
+            }
+            else
+            {
+                state = I2C_STATE_NULL;
+                reset_values();
+                HANDLER(fifo.data, 0, I2C_SLAVE_STOP);
+            }
+        }
+
+        static inline void scl_edge(uint32_t event, bool data_level)
+        {
+            if (event == GPIO_IRQ_EDGE_RISE)
+                scl_rise(data_level);
+            else
+                scl_fall();
+        }
+
+    private:
+        static inline i2c_state_t state = I2C_STATE_NULL;
+        static inline i2c_acknowledge_state_t acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+        static inline uint bit_counter = 0;
+        static inline fifo_8bit fifo;
+
+        static inline void reset_values()
+        {
+            fifo.reset_fifo();
+            acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+            bit_counter = 0;
+        }
+
+        static inline void release_sda() { hal_gpio_set_dir_in_masked(SDA_MASK); }
+        static inline void pull_sda()    { hal_gpio_set_dir_out_masked(SDA_MASK); }
+
+        // Whenever a pin is read it must be while scl is high
+        static inline void scl_rise(bool data_level)
+        {
+            switch (state)
+            {
+            case I2C_STATE_START:
+                fifo.shift_in(data_level);
+                bit_counter++;
+
+                // Only the whole address byte is compared, the first bits of another address could match
+                if (bit_counter < 8)
+                    break;
+
+                if (fifo.data == TRANSMIT_CONDITION)
+                    state = I2C_STATE_TRANSMIT;
+                else if (fifo.data == RECEIVE_CONDITION)
+                    state = I2C_STATE_RECEIVE;
+                else
+                {
+                    // Another device's address, wait for the next START
+                    state = I2C_STATE_NULL;
+                    break;
+                }
+                acknowledge_state = I2C_ACKNOWLEDGE_STATE_TRANSMIT;
+                bit_counter = 0;
+                fifo.reset_fifo();
+                break;
+
+            case I2C_STATE_TRANSMIT:
+                if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_RECEIVE)
+                {
+                    acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+
+                    // Not acknowledged is the master's last byte, leave SDA alone until its STOP or repeated START
+                    if (data_level)
+                        state = I2C_STATE_NULL;
+                }
+                break;
+
+            case I2C_STATE_RECEIVE:
+                if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+                {
+                    // Acknowledge has been read
+                    acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+                }
+                else if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_NULL)
+                {
+                    fifo.shift_in(data_level);
+                    bit_counter++;
+                    if (bit_counter % 8 == 0)
+                    {
+                        HANDLER(fifo.data, bit_counter / 8, I2C_SLAVE_RECEIVE);
+                        acknowledge_state = I2C_ACKNOWLEDGE_STATE_TRANSMIT;
+                    }
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        // SCL must be low to change SDA
+        static inline void scl_fall()
+        {
+            switch (state)
+            {
+            case I2C_STATE_TRANSMIT:
+                if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+                {
+                    // Acknowledge the address
+                    pull_sda();
+                    acknowledge_state = I2C_ACKNOWLEDGE_STATE_NULL;
+                }
+                else if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_NULL)
+                {
+                    // Every byte get the next one
+                    if (bit_counter % 9 == 0)
+                        HANDLER(fifo.data, bit_counter / 9, I2C_SLAVE_REQUEST);
+
+                    // The ninth clock is the master's acknowledge, let go of SDA for it
+                    if (bit_counter % 9 == 8 || fifo.shift_in(0))
+                        release_sda();
+                    else
+                        pull_sda();
+                    bit_counter++;
+
+                    if (bit_counter % 9 == 0)
+                        acknowledge_state = I2C_ACKNOWLEDGE_STATE_RECEIVE;
+                }
+                break;
+
+            case I2C_STATE_RECEIVE:
+                if (acknowledge_state == I2C_ACKNOWLEDGE_STATE_TRANSMIT)
+                    pull_sda();
+                else
+                    release_sda();
+                break;
+
+            default:
+                break;
+            }
+        }
+};
+
+#endif
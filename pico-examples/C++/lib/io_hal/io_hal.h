@@ -0,0 +1,118 @@
+#ifndef IO_HAL_H
+#define IO_HAL_H
+
+/*
+    Thin hardware abstraction layer used by the i2c engines.
+
+    On the pico every call is a static inline forward to the pico-sdk so there is no cost.
+    When IO_HAL_SIM is defined the calls are routed to a simulated wired-AND bus (io_hal_sim.h)
+    so the engines can be run, tested and profiled on a linux host.
+*/
+
+#ifdef IO_HAL_SIM
+
+#include "io_hal_sim.h"
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+#include "hardware/timer.h"
+#include "hardware/structs/systick.h"
+
+// Pin setup
+static inline void hal_gpio_init(uint pin)                                   { gpio_init(pin); }
+static inline void hal_gpio_set_dir(uint pin, bool out)                      { gpio_set_dir(pin, out); }
+static inline void hal_gpio_set_slew_rate(uint pin, enum gpio_slew_rate rate) { gpio_set_slew_rate(pin, rate); }
+
+// Pin access
+static inline bool hal_gpio_get(uint pin)              { return gpio_get(pin); }
+static inline void hal_gpio_put(uint pin, bool value)  { gpio_put(pin, value); }
+static inline uint32_t hal_gpio_get_all()              { return gpio_get_all(); }
+
+// Several pins in one SIO register write, the output enable is how an open drain line is driven
+static inline void hal_gpio_init_mask(uint32_t mask)                  { gpio_init_mask(mask); }
+static inline void hal_gpio_put_masked(uint32_t mask, uint32_t value) { gpio_put_masked(mask, value); }
+static inline void hal_gpio_clr_mask(uint32_t mask)            { gpio_clr_mask(mask); }
+static inline void hal_gpio_set_dir_out_masked(uint32_t mask)  { gpio_set_dir_out_masked(mask); }
+static inline void hal_gpio_set_dir_in_masked(uint32_t mask)   { gpio_set_dir_in_masked(mask); }
+
+// Interrupts
+static inline void hal_gpio_set_irq_callback(gpio_irq_callback_t callback)        { gpio_set_irq_callback(callback); }
+static inline void hal_gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled) { gpio_set_irq_enabled(pin, events, enabled); }
+static inline void hal_gpio_irq_bank_enable()                                      { irq_set_enabled(IO_IRQ_BANK0, true); }
+
+// Raw bank interrupts, the handler reads and acknowledges the latched edges of its pins itself
+static inline void     hal_gpio_add_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler)    { gpio_add_raw_irq_handler_masked(pin_mask, handler); }
+static inline void     hal_gpio_remove_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler) { gpio_remove_raw_irq_handler_masked(pin_mask, handler); }
+static inline uint32_t hal_gpio_get_irq_events(uint pin)                      { return gpio_get_irq_event_mask(pin); }
+static inline void     hal_gpio_acknowledge_irq(uint pin, uint32_t events)    { gpio_acknowledge_irq(pin, events); }
+
+// Time
+static inline void     hal_sleep_us(uint64_t us) { sleep_us(us); }
+static inline void     hal_sleep_ms(uint32_t ms) { sleep_ms(ms); }
+static inline uint64_t hal_time_us_64()          { return time_us_64(); }
+
+// Cycle timing, for waits shorter than a microsecond
+static inline uint32_t hal_clock_sys_hz()                   { return clock_get_hz(clk_sys); }
+static inline void     hal_busy_wait_cycles(uint32_t cycles) { busy_wait_at_least_cycles(cycles); }
+
+// Free running cycle counter for measuring short sections, SysTick counting down from its 24 bit reload.
+// Counts wrap at HAL_CYCLE_COUNT_MASK, take (end - start) & HAL_CYCLE_COUNT_MASK.
+#define HAL_CYCLE_COUNT_MASK 0xffffffu
+static inline void     hal_cycle_counter_init() { systick_hw->rvr = HAL_CYCLE_COUNT_MASK; systick_hw->csr = 0x5; }
+static inline uint32_t hal_cycle_count()        { return HAL_CYCLE_COUNT_MASK - systick_hw->cvr; }
+
+// Alarms, the callback runs in the timer interrupt and returns when to run again, see add_alarm_in_us
+static inline alarm_id_t hal_add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data) { return add_alarm_in_us(us, callback, user_data, true); }
+
+// The default pool's interrupt is on core 0. A pool of its own takes a free hardware alarm whose
+// interrupt is on the core that creates it, so its callbacks run on that core.
+typedef alarm_pool_t* hal_alarm_pool_t;
+static inline hal_alarm_pool_t hal_alarm_pool_create(uint max_alarms) { return alarm_pool_create_with_unused_hardware_alarm(max_alarms); }
+static inline alarm_id_t hal_alarm_pool_add_alarm_in_us(hal_alarm_pool_t pool, uint64_t us, alarm_callback_t callback, void* user_data) { return alarm_pool_add_alarm_in_us(pool, us, callback, user_data, true); }
+
+// A hardware alarm of its own, its handler is entered straight from the timer interrupt with no
+// alarm pool in between. The interrupt is on the core that sets the handler. The handler
+// acknowledges the alarm and sets the next target itself, targets are absolute us on the timer.
+#define HAL_TIMER_COUNT NUM_TIMERS
+static inline uint     hal_timer_claim_unused()  { return hardware_alarm_claim_unused(true); }
+static inline uint32_t hal_timer_now_us()        { return timer_hw->timerawl; }
+static inline void     hal_timer_set_handler(uint timer, irq_handler_t handler)
+{
+    irq_set_exclusive_handler(TIMER_IRQ_0 + timer, handler);
+    hw_set_bits(&timer_hw->inte, 1u << timer);
+    irq_set_enabled(TIMER_IRQ_0 + timer, true);
+}
+static inline void     hal_timer_acknowledge(uint timer)
+{
+    hw_clear_bits(&timer_hw->intf, 1u << timer);
+    timer_hw->intr = 1u << timer;
+}
+static inline void     hal_timer_set_target_us(uint timer, uint32_t target_us)
+{
+    timer_hw->alarm[timer] = target_us;
+
+    // A target already passed would only be reached once the counter wraps, raise it now instead
+    if ((int32_t)(target_us - timer_hw->timerawl) <= 0)
+        hw_set_bits(&timer_hw->intf, 1u << timer);
+}
+
+// Keep this core's interrupt handlers out of a short critical section
+static inline uint32_t hal_save_and_disable_interrupts()     { return save_and_disable_interrupts(); }
+static inline void     hal_restore_interrupts(uint32_t status) { restore_interrupts(status); }
+
+// Roughly what writing a pin costs on top of a cycle wait, timing loops take it off each wait
+#define HAL_GPIO_PUT_CYCLES 3
+
+// Runs the function from RAM so an interrupt handler never waits on the flash cache,
+// used as void HAL_RAM_FUNC(name)(args)
+#define HAL_RAM_FUNC(name) __not_in_flash_func(name)
+
+#endif // IO_HAL_SIM
+
+#endif
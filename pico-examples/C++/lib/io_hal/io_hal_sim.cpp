@@ -0,0 +1,743 @@
+#include "io_hal_sim.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <vector>
+
+struct sim_pin
+{
+    int net = SIM_NET_NONE;
+    bool out = false;
+    bool value = false;
+    bool level = true;          // level seen by this pin, pulled up when nothing drives it
+    uint32_t irq_events = 0;    // edges that raise an interrupt
+};
+
+struct sim_raw_handler
+{
+    uint32_t pin_mask;
+    irq_handler_t handler;
+};
+
+struct sim_device
+{
+    const char* name;
+    sim_pin pins[NUM_BANK0_GPIOS];
+
+    gpio_irq_callback_t callback = nullptr;
+    std::vector<sim_raw_handler> raw_handlers;
+    bool irq_bank_enabled = false;
+    bool irq_held = false;
+    bool in_irq = false;
+
+    // Simulated time one interrupt entry takes, no other entry runs until busy_until_ns
+    uint64_t irq_cost_ns = 0;
+    uint64_t busy_until_ns = 0;
+
+    // latched edges waiting to be serviced, one mask per pin
+    uint32_t pending[NUM_BANK0_GPIOS] = {};
+    uint32_t pending_pins = 0;
+
+    sim_irq_stats stats;
+};
+
+struct sim_net_member
+{
+    sim_device* device;
+    uint pin;
+};
+
+static std::vector<std::unique_ptr<sim_device>> sim_devices;
+static std::vector<sim_net_member> sim_nets[SIM_MAX_NETS];
+static sim_device* sim_current = nullptr;
+static uint64_t sim_now_ns = 0;
+static uint64_t sim_contentions = 0;
+static bool sim_trace = false;
+static std::vector<sim_time_hook> sim_time_hooks;
+
+struct sim_alarm
+{
+    alarm_id_t id;
+    uint64_t due_ns;
+    sim_device* device;
+    alarm_callback_t callback;
+    void* user_data;
+};
+
+static std::vector<sim_alarm> sim_alarms;
+static alarm_id_t sim_next_alarm_id = 1;
+
+static void sim_run_alarms(uint64_t by_ns);
+
+// Edges waiting to be delivered, net is SIM_NET_NONE for a pin that is not wired to a net
+struct sim_edge
+{
+    sim_device* device;
+    uint pin;
+    int net;
+    bool level;
+};
+
+static std::deque<sim_edge> sim_edges;
+static bool sim_dispatching = false;
+static bool sim_net_low[SIM_MAX_NETS];   // nets start pulled up
+
+static uint64_t host_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void sim_record_irq(sim_device* device, uint64_t start)
+{
+    uint64_t elapsed = host_ns() - start;
+    device->stats.calls++;
+    device->stats.total_ns += elapsed;
+    device->stats.max_ns = MAX(device->stats.max_ns, elapsed);
+}
+
+// Whether a device has handlers and nothing keeps it from taking an interrupt, busy time aside
+static bool sim_can_run_irq(const sim_device* device)
+{
+    return !device->in_irq && !device->irq_held && device->irq_bank_enabled
+        && (device->callback != nullptr || !device->raw_handlers.empty());
+}
+
+// Run every latched interrupt of a device until none are left. Raw handlers go first, then the
+// callback for the remaining pins, lowest pin first like the sdk.
+static void sim_run_irq(sim_device* device)
+{
+    if (!sim_can_run_irq(device) || sim_now_ns < device->busy_until_ns)
+        return;
+
+    sim_device* previous = sim_current;
+    sim_current = device;
+    device->in_irq = true;
+
+    bool entered = device->pending_pins != 0;
+    while (device->pending_pins)
+    {
+        uint32_t raw_pins = 0;
+        for (const sim_raw_handler& raw : device->raw_handlers)
+        {
+            raw_pins |= raw.pin_mask;
+            if (!(device->pending_pins & raw.pin_mask))
+                continue;
+
+            uint64_t start = host_ns();
+            raw.handler();
+            sim_record_irq(device, start);
+        }
+
+        // On the pico an edge left unacknowledged would interrupt forever
+        assert(!(device->pending_pins & raw_pins) && "a raw irq handler did not acknowledge its edges");
+
+        uint32_t callback_pins = device->pending_pins & ~raw_pins;
+        if (callback_pins == 0 || device->callback == nullptr)
+            break;
+
+        uint pin = __builtin_ctz(callback_pins);
+        uint32_t events = device->pending[pin];
+        device->pending[pin] = 0;
+        device->pending_pins &= ~(1u << pin);
+
+        uint64_t start = host_ns();
+        device->callback(pin, events);
+        sim_record_irq(device, start);
+    }
+
+    // The entry takes up the core, edges latched from now on wait for the next one
+    if (entered)
+        device->busy_until_ns = sim_now_ns + device->irq_cost_ns;
+
+    device->in_irq = false;
+    sim_current = previous;
+}
+
+// Latch an edge on a pin if it is watched
+static void sim_latch(sim_device* device, uint pin, bool level)
+{
+    sim_pin& p = device->pins[pin];
+    if (p.level == level)
+        return;
+    p.level = level;
+
+    uint32_t event = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (p.irq_events & event)
+    {
+        device->pending[pin] |= event;
+        device->pending_pins |= (1u << pin);
+    }
+}
+
+// Deliver queued edges one at a time, every device finishes handling an edge before the next
+// one is delivered. Edges caused by an interrupt handler are queued behind the current one.
+static void sim_dispatch()
+{
+    if (sim_dispatching)
+        return;
+    sim_dispatching = true;
+
+    while (!sim_edges.empty())
+    {
+        sim_edge edge = sim_edges.front();
+        sim_edges.pop_front();
+
+        if (edge.net == SIM_NET_NONE)
+        {
+            sim_latch(edge.device, edge.pin, edge.level);
+            sim_run_irq(edge.device);
+            continue;
+        }
+
+        for (const sim_net_member& m : sim_nets[edge.net])
+            sim_latch(m.device, m.pin, edge.level);
+
+        for (const sim_net_member& m : sim_nets[edge.net])
+            if (m.device->pending_pins)
+                sim_run_irq(m.device);
+    }
+
+    sim_dispatching = false;
+}
+
+// Resolve the level of a pin or the net it is wired to and queue an edge if it changed
+static void sim_update(sim_device* device, uint pin)
+{
+    int net = device->pins[pin].net;
+
+    if (net == SIM_NET_NONE)
+    {
+        const sim_pin& p = device->pins[pin];
+        bool level = !(p.out && !p.value);
+        if (level != p.level)
+            sim_edges.push_back({device, pin, SIM_NET_NONE, level});
+        sim_dispatch();
+        return;
+    }
+
+    bool pulled_low = false;
+    bool driven_high = false;
+    for (const sim_net_member& m : sim_nets[net])
+    {
+        const sim_pin& p = m.device->pins[m.pin];
+        if (p.out)
+        {
+            pulled_low |= !p.value;
+            driven_high |= p.value;
+        }
+    }
+
+    if (pulled_low && driven_high)
+        sim_contentions++;
+
+    bool level = !pulled_low;
+    if (level == sim_net_low[net])
+    {
+        if (sim_trace)
+            printf("%10llu ns  net %d %s  (%s pin %u)\n", (unsigned long long)sim_now_ns, net, level ? "rise" : "fall", device->name, pin);
+
+        sim_net_low[net] = !level;
+        sim_edges.push_back({nullptr, 0, net, level});
+    }
+    sim_dispatch();
+}
+
+static sim_device* current()
+{
+    assert(sim_current != nullptr && "select a device with sim_device_scope first");
+    return sim_current;
+}
+
+
+void hal_gpio_init(uint pin)
+{
+    assert(pin < NUM_BANK0_GPIOS);
+    sim_device* device = current();
+    device->pins[pin].out = false;
+    device->pins[pin].value = false;
+    sim_update(device, pin);
+}
+
+void hal_gpio_set_dir(uint pin, bool out)
+{
+    sim_device* device = current();
+    if (device->pins[pin].out == out)
+        return;
+    device->pins[pin].out = out;
+    sim_update(device, pin);
+}
+
+void hal_gpio_set_slew_rate(uint pin, enum gpio_slew_rate rate)
+{
+    (void)pin;
+    (void)rate;
+}
+
+bool hal_gpio_get(uint pin)
+{
+    // Reads the pad as it is now, even if the edge has not been delivered yet
+    const sim_pin& p = current()->pins[pin];
+    if (p.net == SIM_NET_NONE)
+        return !(p.out && !p.value);
+    return !sim_net_low[p.net];
+}
+
+uint32_t hal_gpio_get_all()
+{
+    uint32_t levels = 0;
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        levels |= (uint32_t)hal_gpio_get(pin) << pin;
+    return levels;
+}
+
+void hal_gpio_put(uint pin, bool value)
+{
+    sim_device* device = current();
+    if (device->pins[pin].value == value)
+        return;
+    device->pins[pin].value = value;
+    if (device->pins[pin].out)
+        sim_update(device, pin);
+}
+
+void hal_gpio_init_mask(uint32_t mask)
+{
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        if (mask & (1u << pin))
+            hal_gpio_init(pin);
+}
+
+void hal_gpio_put_masked(uint32_t mask, uint32_t value)
+{
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        if (mask & (1u << pin))
+            hal_gpio_put(pin, (value >> pin) & 1);
+}
+
+void hal_gpio_clr_mask(uint32_t mask)
+{
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        if (mask & (1u << pin))
+            hal_gpio_put(pin, false);
+}
+
+void hal_gpio_set_dir_out_masked(uint32_t mask)
+{
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        if (mask & (1u << pin))
+            hal_gpio_set_dir(pin, true);
+}
+
+void hal_gpio_set_dir_in_masked(uint32_t mask)
+{
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++)
+        if (mask & (1u << pin))
+            hal_gpio_set_dir(pin, false);
+}
+
+void hal_gpio_set_irq_callback(gpio_irq_callback_t callback)
+{
+    current()->callback = callback;
+}
+
+void hal_gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled)
+{
+    sim_device* device = current();
+    if (enabled)
+    {
+        device->pins[pin].irq_events |= events;
+    }
+    else
+    {
+        device->pins[pin].irq_events &= ~events;
+        device->pending[pin] &= ~events;
+        if (device->pending[pin] == 0)
+            device->pending_pins &= ~(1u << pin);
+    }
+}
+
+void hal_gpio_irq_bank_enable()
+{
+    sim_device* device = current();
+    device->irq_bank_enabled = true;
+    sim_run_irq(device);
+}
+
+void hal_gpio_add_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler)
+{
+    sim_device* device = current();
+    for (const sim_raw_handler& raw : device->raw_handlers)
+    {
+        assert(!(raw.pin_mask & pin_mask) && "a pin can only have one raw irq handler");
+        (void)raw;
+    }
+    device->raw_handlers.push_back({pin_mask, handler});
+}
+
+void hal_gpio_remove_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler)
+{
+    std::vector<sim_raw_handler>& handlers = current()->raw_handlers;
+    for (size_t i = 0; i < handlers.size(); i++)
+    {
+        if (handlers[i].handler == handler && handlers[i].pin_mask == pin_mask)
+        {
+            handlers.erase(handlers.begin() + i);
+            return;
+        }
+    }
+}
+
+uint32_t hal_gpio_get_irq_events(uint pin)
+{
+    return current()->pending[pin];
+}
+
+void hal_gpio_acknowledge_irq(uint pin, uint32_t events)
+{
+    sim_device* device = current();
+    device->pending[pin] &= ~events;
+    if (device->pending[pin] == 0)
+        device->pending_pins &= ~(1u << pin);
+}
+
+void hal_sleep_us(uint64_t us)
+{
+    sim_advance_ns(us * 1000);
+}
+
+void hal_sleep_ms(uint32_t ms)
+{
+    sim_advance_ns((uint64_t)ms * 1000000);
+}
+
+uint64_t hal_time_us_64()
+{
+    return sim_now_ns / 1000;
+}
+
+// The hardware alarms, each set target is one sim alarm
+struct sim_timer
+{
+    sim_device* device;
+    irq_handler_t handler;
+    alarm_id_t armed;
+};
+
+static sim_timer sim_timers[HAL_TIMER_COUNT];
+static uint sim_timers_claimed = 0;
+
+static int64_t sim_timer_fired(alarm_id_t id, void* user_data)
+{
+    (void)id;
+    sim_timer* timer = (sim_timer*)user_data;
+    timer->armed = 0;
+    timer->handler();
+    return 0;
+}
+
+uint hal_timer_claim_unused()
+{
+    assert(sim_timers_claimed < HAL_TIMER_COUNT && "no hardware alarm left");
+    return sim_timers_claimed++;
+}
+
+uint32_t hal_timer_now_us()
+{
+    return (uint32_t)(sim_now_ns / 1000);
+}
+
+void hal_timer_set_handler(uint timer, irq_handler_t handler)
+{
+    sim_timers[timer].device = current();
+    sim_timers[timer].handler = handler;
+}
+
+void hal_timer_acknowledge(uint timer)
+{
+    (void)timer;
+}
+
+void hal_timer_set_target_us(uint timer, uint32_t target_us)
+{
+    sim_timer& t = sim_timers[timer];
+    assert(t.handler != nullptr && "set the timer's handler first");
+
+    // A new target replaces the one the alarm was armed with
+    for (size_t i = 0; i < sim_alarms.size(); i++)
+    {
+        if (sim_alarms[i].id == t.armed)
+        {
+            sim_alarms.erase(sim_alarms.begin() + i);
+            break;
+        }
+    }
+
+    // The counter is 32 bits of us, a target already passed fires straight away
+    int32_t ahead_us = (int32_t)(target_us - hal_timer_now_us());
+    uint64_t due_ns = ahead_us > 0 ? (sim_now_ns / 1000 + ahead_us) * 1000 : sim_now_ns;
+
+    t.armed = sim_next_alarm_id++;
+    sim_alarms.push_back({t.armed, due_ns, t.device, &sim_timer_fired, &t});
+}
+
+alarm_id_t hal_add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data)
+{
+    return hal_alarm_pool_add_alarm_in_us(current(), us, callback, user_data);
+}
+
+hal_alarm_pool_t hal_alarm_pool_create(uint max_alarms)
+{
+    // Alarms are only ever limited by memory here
+    (void)max_alarms;
+    return current();
+}
+
+alarm_id_t hal_alarm_pool_add_alarm_in_us(hal_alarm_pool_t pool, uint64_t us, alarm_callback_t callback, void* user_data)
+{
+    alarm_id_t id = sim_next_alarm_id++;
+    sim_alarms.push_back({id, sim_now_ns + us * 1000, pool, callback, user_data});
+    return id;
+}
+
+uint32_t hal_save_and_disable_interrupts()
+{
+    sim_device* device = current();
+    uint32_t status = device->irq_held;
+    device->irq_held = true;
+    return status;
+}
+
+void hal_restore_interrupts(uint32_t status)
+{
+    sim_device_hold_irq(current(), status);
+}
+
+uint32_t hal_clock_sys_hz()
+{
+    return SIM_CLK_SYS_HZ;
+}
+
+void hal_busy_wait_cycles(uint32_t cycles)
+{
+    sim_advance_ns((uint64_t)cycles * 1000000000ull / SIM_CLK_SYS_HZ);
+}
+
+void hal_cycle_counter_init()
+{
+}
+
+uint32_t hal_cycle_count()
+{
+    return (uint32_t)(host_ns() * (SIM_CLK_SYS_HZ / 1000000) / 1000);
+}
+
+
+sim_device* sim_device_create(const char* name)
+{
+    sim_devices.emplace_back(new sim_device());
+    sim_device* device = sim_devices.back().get();
+    device->name = name;
+    return device;
+}
+
+void sim_device_wire(sim_device* device, uint pin, uint net)
+{
+    assert(pin < NUM_BANK0_GPIOS && net < SIM_MAX_NETS);
+    assert(device->pins[pin].net == SIM_NET_NONE);
+
+    device->pins[pin].net = net;
+    device->pins[pin].level = !sim_net_low[net];
+    sim_nets[net].push_back({device, pin});
+    sim_update(device, pin);
+}
+
+void sim_device_select(sim_device* device)
+{
+    sim_current = device;
+}
+
+sim_device* sim_device_current()
+{
+    return sim_current;
+}
+
+void sim_device_hold_irq(sim_device* device, bool hold)
+{
+    device->irq_held = hold;
+    if (!hold)
+    {
+        sim_run_irq(device);
+        sim_run_alarms(sim_now_ns);
+    }
+}
+
+void sim_device_set_irq_cost_ns(sim_device* device, uint64_t ns)
+{
+    device->irq_cost_ns = ns;
+}
+
+void sim_device_mask_irq_ns(sim_device* device, uint64_t ns)
+{
+    device->busy_until_ns = MAX(device->busy_until_ns, sim_now_ns + ns);
+}
+
+sim_irq_stats sim_device_irq_stats(const sim_device* device)
+{
+    return device->stats;
+}
+
+void sim_device_reset_irq_stats(sim_device* device)
+{
+    device->stats = sim_irq_stats();
+}
+
+bool sim_net_get(uint net)
+{
+    return !sim_net_low[net];
+}
+
+void sim_set_trace(bool enabled)
+{
+    sim_trace = enabled;
+}
+
+uint64_t sim_contention_count()
+{
+    return sim_contentions;
+}
+
+uint64_t sim_time_ns()
+{
+    return sim_now_ns;
+}
+
+static void sim_run_time_hooks()
+{
+    for (sim_time_hook hook : sim_time_hooks)
+        hook(sim_now_ns);
+}
+
+// When an alarm can run, once it is due and its device has finished the entry it is in
+static uint64_t sim_alarm_time(const sim_alarm& alarm)
+{
+    return MAX(alarm.due_ns, alarm.device->busy_until_ns);
+}
+
+// Index of the earliest alarm due by the given time whose device can take it, -1 if none
+static int sim_next_alarm(uint64_t by_ns)
+{
+    int next = -1;
+    for (size_t i = 0; i < sim_alarms.size(); i++)
+    {
+        const sim_alarm& alarm = sim_alarms[i];
+        if (sim_alarm_time(alarm) > by_ns || alarm.device->irq_held || alarm.device->in_irq)
+            continue;
+        if (next < 0 || sim_alarm_time(alarm) < sim_alarm_time(sim_alarms[next]))
+            next = i;
+    }
+    return next;
+}
+
+// The device that stops being busy first by the given time with edges latched meanwhile, null if none
+static sim_device* sim_next_busy(uint64_t by_ns)
+{
+    sim_device* next = nullptr;
+    for (const std::unique_ptr<sim_device>& device : sim_devices)
+    {
+        if (!device->pending_pins || !sim_can_run_irq(device.get()) || device->busy_until_ns <= sim_now_ns || device->busy_until_ns > by_ns)
+            continue;
+        if (next == nullptr || device->busy_until_ns < next->busy_until_ns)
+            next = device.get();
+    }
+    return next;
+}
+
+// Move time forward to each alarm and each end of a busy stretch up to by_ns, in order
+static void sim_run_alarms(uint64_t by_ns)
+{
+    while (true)
+    {
+        int next = sim_next_alarm(by_ns);
+        sim_device* busy = sim_next_busy(by_ns);
+        if (next < 0 && busy == nullptr)
+            break;
+
+        if (busy != nullptr && (next < 0 || busy->busy_until_ns < sim_alarm_time(sim_alarms[next])))
+        {
+            if (busy->busy_until_ns > sim_now_ns)
+            {
+                sim_now_ns = busy->busy_until_ns;
+                sim_run_time_hooks();
+            }
+            sim_run_irq(busy);
+            continue;
+        }
+
+        sim_alarm alarm = sim_alarms[next];
+        sim_alarms.erase(sim_alarms.begin() + next);
+
+        uint64_t run_ns = sim_alarm_time(alarm);
+        if (run_ns > sim_now_ns)
+        {
+            sim_now_ns = run_ns;
+            sim_run_time_hooks();
+        }
+
+        sim_device* previous = sim_current;
+        sim_current = alarm.device;
+        alarm.device->in_irq = true;
+        uint64_t start = host_ns();
+        int64_t again_us = alarm.callback(alarm.id, alarm.user_data);
+        sim_record_irq(alarm.device, start);
+        alarm.device->in_irq = false;
+        sim_current = previous;
+
+        if (alarm.device->irq_cost_ns)
+            alarm.device->busy_until_ns = sim_now_ns + alarm.device->irq_cost_ns;
+
+        // Edges the alarm caused may have been latched while it ran
+        sim_run_irq(alarm.device);
+
+        if (again_us < 0)
+            alarm.due_ns += (uint64_t)(-again_us) * 1000;
+        else if (again_us > 0)
+            alarm.due_ns = sim_now_ns + (uint64_t)again_us * 1000;
+        else
+            continue;
+        sim_alarms.push_back(alarm);
+    }
+}
+
+void sim_advance_ns(uint64_t ns)
+{
+    uint64_t target = sim_now_ns + ns;
+    sim_run_alarms(target);
+    sim_now_ns = target;
+    sim_run_time_hooks();
+}
+
+void sim_add_time_hook(sim_time_hook hook)
+{
+    sim_time_hooks.push_back(hook);
+}
+
+void sim_reset()
+{
+    for (uint net = 0; net < SIM_MAX_NETS; net++)
+    {
+        sim_nets[net].clear();
+        sim_net_low[net] = false;
+    }
+    sim_edges.clear();
+    sim_devices.clear();
+    sim_time_hooks.clear();
+    sim_alarms.clear();
+    for (sim_timer& timer : sim_timers)
+        timer = sim_timer();
+    sim_timers_claimed = 0;
+    sim_current = nullptr;
+    sim_now_ns = 0;
+    sim_contentions = 0;
+}
@@ -0,0 +1,216 @@
+#ifndef IO_HAL_SIM_H
+#define IO_HAL_SIM_H
+
+/*
+    Simulated backend for io_hal.h, used on a linux host.
+
+    Each sim_device stands in for one RP2040 with its own pins, irq callback and pending interrupt
+    flags. Device pins are wired onto shared nets which behave as an open drain bus with a pull up
+    resistor: a net is low if any pin on it is an output driving low, otherwise it is high.
+    Whenever a net changes level the edge is latched on every device watching that net and the
+    device's irq callback is run straight away, exactly like a GPIO bank interrupt would be.
+
+    The hal_* functions act on the currently selected device. The simulator selects the correct
+    device while running its interrupts, main-loop code selects one with sim_device_scope.
+
+    Time does not pass on its own, it only moves forward when code calls hal_sleep_us / hal_sleep_ms
+    or the test calls sim_advance_ns. Interrupt handlers are therefore infinitely fast in simulated
+    time, their real cost on the host is recorded in sim_irq_stats instead.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#define NUM_BANK0_GPIOS     30
+#define SIM_MAX_NETS        32
+#define SIM_NET_NONE        (-1)
+#define SIM_CLK_SYS_HZ      125000000u
+
+// Same values as the pico-sdk so engine code compiles unchanged
+enum gpio_dir {
+    GPIO_IN = 0u,
+    GPIO_OUT = 1u,
+};
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+enum gpio_slew_rate {
+    GPIO_SLEW_RATE_SLOW = 0,
+    GPIO_SLEW_RATE_FAST = 1,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+typedef void (*irq_handler_t)(void);
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void* user_data);
+
+struct sim_device;
+typedef sim_device* hal_alarm_pool_t;
+
+// Pin setup
+void hal_gpio_init(uint pin);
+void hal_gpio_set_dir(uint pin, bool out);
+void hal_gpio_set_slew_rate(uint pin, enum gpio_slew_rate rate);
+
+// Pin access
+bool hal_gpio_get(uint pin);
+void hal_gpio_put(uint pin, bool value);
+uint32_t hal_gpio_get_all();
+
+// Masked forms, one SIO register write on the pico
+void hal_gpio_init_mask(uint32_t mask);
+void hal_gpio_put_masked(uint32_t mask, uint32_t value);
+void hal_gpio_clr_mask(uint32_t mask);
+void hal_gpio_set_dir_out_masked(uint32_t mask);
+void hal_gpio_set_dir_in_masked(uint32_t mask);
+
+// Interrupts
+void hal_gpio_set_irq_callback(gpio_irq_callback_t callback);
+void hal_gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+void hal_gpio_irq_bank_enable();
+
+// Raw bank interrupts, run before the callback for any pending edge on their pins. The handler
+// must acknowledge those edges, the callback is never run for them.
+void     hal_gpio_add_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler);
+void     hal_gpio_remove_raw_irq_handler_masked(uint32_t pin_mask, irq_handler_t handler);
+uint32_t hal_gpio_get_irq_events(uint pin);
+void     hal_gpio_acknowledge_irq(uint pin, uint32_t events);
+
+// Time
+void     hal_sleep_us(uint64_t us);
+void     hal_sleep_ms(uint32_t ms);
+uint64_t hal_time_us_64();
+
+// Alarms run as an interrupt of the device that added them, at their exact simulated time. The
+// callback returns 0 to stop, < 0 to run again that many us after the time it was due and > 0 to
+// run again that many us from now.
+alarm_id_t hal_add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data);
+
+// A pool is the device that created it, its alarms run there whichever device adds them
+hal_alarm_pool_t hal_alarm_pool_create(uint max_alarms);
+alarm_id_t       hal_alarm_pool_add_alarm_in_us(hal_alarm_pool_t pool, uint64_t us, alarm_callback_t callback, void* user_data);
+
+// A hardware alarm of its own, its handler runs as an interrupt of the device that set it once the
+// target, in absolute us, is reached. Acknowledging does nothing, each target fires once.
+#define HAL_TIMER_COUNT 4
+uint     hal_timer_claim_unused();
+uint32_t hal_timer_now_us();
+void     hal_timer_set_handler(uint timer, irq_handler_t handler);
+void     hal_timer_acknowledge(uint timer);
+void     hal_timer_set_target_us(uint timer, uint32_t target_us);
+
+// Holds the current device's interrupts, edges and alarms that come due wait for the restore
+uint32_t hal_save_and_disable_interrupts();
+void     hal_restore_interrupts(uint32_t status);
+
+// Cycle timing, the simulated clock runs at SIM_CLK_SYS_HZ and pins cost nothing
+uint32_t hal_clock_sys_hz();
+void     hal_busy_wait_cycles(uint32_t cycles);
+
+// Host time at SIM_CLK_SYS_HZ, simulated time does not move inside a handler so this is what it cost the host
+#define HAL_CYCLE_COUNT_MASK 0xffffffffu
+void     hal_cycle_counter_init();
+uint32_t hal_cycle_count();
+
+#define HAL_GPIO_PUT_CYCLES 0
+
+// There is no flash on the host, functions stay where they are
+#define HAL_RAM_FUNC(name) name
+
+
+// ---------------------------------------------------------------------------------------------
+// Simulator control, only available on the host
+// ---------------------------------------------------------------------------------------------
+
+struct sim_device;
+
+// Host time spent inside a device's irq callback
+struct sim_irq_stats {
+    uint64_t calls = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/// @brief create a new simulated device, all of its pins start unconnected and as inputs
+/// @param name name used in diagnostics
+sim_device* sim_device_create(const char* name);
+
+/// @brief connect a pin of a device to a bus net, any number of pins may share a net
+void sim_device_wire(sim_device* device, uint pin, uint net);
+
+/// @brief select the device that hal_* calls act on
+void sim_device_select(sim_device* device);
+sim_device* sim_device_current();
+
+// Hold back a device's interrupts, edges keep latching and are serviced together once released.
+// Stands in for a handler that is late, such as when interrupts are disabled.
+void sim_device_hold_irq(sim_device* device, bool hold);
+
+// Simulated time each interrupt entry of a device takes, 0 by default. Until it is over the device
+// takes no other interrupt, edges keep latching and alarms wait, as on a core busy in its handler.
+void sim_device_set_irq_cost_ns(sim_device* device, uint64_t ns);
+
+// Keep a device from taking interrupts for the next ns of simulated time, as a critical section
+// with interrupts masked would. Unlike sim_device_hold_irq it ends on time without a release.
+void sim_device_mask_irq_ns(sim_device* device, uint64_t ns);
+
+sim_irq_stats sim_device_irq_stats(const sim_device* device);
+void sim_device_reset_irq_stats(sim_device* device);
+
+// Level of a net, high when nothing pulls it low
+bool sim_net_get(uint net);
+
+// Print every net edge to stdout
+void sim_set_trace(bool enabled);
+
+// Number of times a pin drove a net high while another pin was pulling it low
+uint64_t sim_contention_count();
+
+uint64_t sim_time_ns();
+void sim_advance_ns(uint64_t ns);
+
+// Called with the new time whenever simulated time moves forward so clocked peripherals, such as
+// the simulated PIO in host_sim/pio_sim, can catch up
+typedef void (*sim_time_hook)(uint64_t now_ns);
+void sim_add_time_hook(sim_time_hook hook);
+
+// Destroy every device, net and time hook and reset time, used between tests
+void sim_reset();
+
+// Selects a device for the lifetime of the scope, restoring the previous one after
+struct sim_device_scope
+{
+    sim_device* previous;
+
+    sim_device_scope(sim_device* device)
+    {
+        previous = sim_device_current();
+        sim_device_select(device);
+    }
+
+    ~sim_device_scope()
+    {
+        sim_device_select(previous);
+    }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef LED_BAR_H
+#define LED_BAR_H
+
+#include "io_hal.h"
+
+/*
+    A row of LEDs showing the bits of a value, bit i on the i-th pin of the list.
+
+    The pins are template parameters, so the output mask and the position of every bit are
+    constants. show() works out the level of all the pins at once and sets them with a single
+    masked SIO write, it is cheap enough to call from an edge interrupt. When the pins are one
+    ascending run, as on most of the boards, spreading the bits is a shift.
+
+        using data_leds = led_bar<6, 7, 8, 9, 10, 11, 12, 13>;
+
+        data_leds::init();
+        data_leds::show(0x5a);
+*/
+
+template <uint... PINS>
+class led_bar
+{
+    static_assert(sizeof...(PINS) > 0 && sizeof...(PINS) <= 32, "between 1 and 32 leds");
+    static_assert(((PINS < NUM_BANK0_GPIOS) && ...), "the leds must be on bank 0 pins");
+
+    public:
+        static constexpr uint COUNT = sizeof...(PINS);
+        static constexpr uint PIN[COUNT] = {PINS...};
+        static constexpr uint32_t MASK = ((1u << PINS) | ...);
+
+        static_assert(__builtin_popcount(MASK) == COUNT, "a pin is in the list twice");
+
+        // All leds off and driven
+        static void init()
+        {
+            hal_gpio_init_mask(MASK);
+            hal_gpio_clr_mask(MASK);
+            hal_gpio_set_dir_out_masked(MASK);
+        }
+
+        // Bit i of value on PIN[i], bits past the last led are ignored
+        static inline void show(uint32_t value)
+        {
+            hal_gpio_put_masked(MASK, levels(value));
+        }
+
+        // The GPIO levels that show value
+        static constexpr uint32_t levels(uint32_t value)
+        {
+            if constexpr (contiguous())
+                return (value << PIN[0]) & MASK;
+
+            uint32_t out = 0;
+            for (uint i = 0; i < COUNT; i++)
+                out |= ((value >> i) & 1u) << PIN[i];
+            return out;
+        }
+
+    private:
+        static constexpr bool contiguous()
+        {
+            for (uint i = 1; i < COUNT; i++)
+                if (PIN[i] != PIN[0] + i)
+                    return false;
+            return true;
+        }
+};
+
+#endif